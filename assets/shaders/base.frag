@@ -32,7 +32,6 @@ layout (location = 2) in vec3 in_normal;
 layout (location = 0) out vec4 o_color;
 
 layout(set = 0, binding = 1) uniform GlobalUniform {
-    mat4 model;
     mat4 view_proj;
     vec4 light_pos;
     vec4 light_color;
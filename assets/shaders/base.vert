@@ -23,24 +23,60 @@ layout(location = 0) in vec3 position;
 layout(location = 1) in vec2 texcoord_0;
 layout(location = 2) in vec3 normal;
 
+#ifdef INSTANCING
+// World matrix of each instance, replacing the model uniform
+layout(location = 3) in mat4 instance_model;
+#endif
+
 layout(set = 0, binding = 1) uniform GlobalUniform {
-    mat4 model;
     mat4 view_proj;
     vec4 light_pos;
     vec4 light_color;
 } global_uniform;
 
+#ifdef GPU_CULLING
+// World matrix of each instance culled on the GPU
+layout(std430, set = 0, binding = 3) readonly buffer InstanceModelBuffer {
+    mat4 models[];
+} instance_models;
+
+// Visible instances of each draw, packed from its first visible instance by the culling shader
+layout(std430, set = 0, binding = 4) readonly buffer VisibleInstanceBuffer {
+    uint indices[];
+} visible_instances;
+
+// Set for each indirect draw, after the material push constants of the fragment shader
+layout(push_constant, std430) uniform IndirectDrawUniform {
+    layout(offset = 32) uint first_visible_instance;
+} indirect_draw_uniform;
+#endif
+
+#if !defined(INSTANCING) && !defined(GPU_CULLING)
+// World matrix of the node, at a dynamic offset in the matrices of all the draws of the frame
+layout(set = 0, binding = 2) uniform ModelUniform {
+    mat4 model;
+} model_uniform;
+#endif
+
 layout (location = 0) out vec4 o_pos;
 layout (location = 1) out vec2 o_uv;
 layout (location = 2) out vec3 o_normal;
 
 void main(void)
 {
-    o_pos = global_uniform.model * vec4(position, 1.0);
+#ifdef INSTANCING
+    mat4 model = instance_model;
+#elif defined(GPU_CULLING)
+    mat4 model = instance_models.models[visible_instances.indices[indirect_draw_uniform.first_visible_instance + gl_InstanceIndex]];
+#else
+    mat4 model = model_uniform.model;
+#endif
+
+    o_pos = model * vec4(position, 1.0);
 
     o_uv = texcoord_0;
 
-    o_normal = mat3(global_uniform.model) * normal;
+    o_normal = mat3(model) * normal;
 
     gl_Position = global_uniform.view_proj * o_pos;
 }
@@ -33,7 +33,6 @@ layout (location = 0) out vec4 o_albedo;
 layout (location = 1) out vec4 o_normal;
 
 layout(set = 0, binding = 1) uniform GlobalUniform {
-    mat4 model;
     mat4 view_proj;
     vec4 light_pos;
     vec4 light_color;
@@ -120,12 +120,18 @@ BufferAllocation::BufferAllocation(core::Buffer &buffer, VkDeviceSize size, VkDe
 }
 
 void BufferAllocation::update(const std::vector<uint8_t> &data, uint32_t offset)
+{
+	update(data.data(), data.size(), offset);
+}
+
+void BufferAllocation::update(const uint8_t *data, const size_t data_size, const uint32_t offset)
 {
 	assert(buffer && "Invalid buffer pointer");
+	assert(data && "Invalid data pointer");
 
-	if (offset + data.size() <= size)
+	if (offset + data_size <= size)
 	{
-		buffer->update(data, static_cast<size_t>(base_offset) + offset);
+		buffer->update(data, data_size, static_cast<size_t>(base_offset) + offset);
 	}
 	else
 	{
@@ -133,13 +139,6 @@ void BufferAllocation::update(const std::vector<uint8_t> &data, uint32_t offset)
 	}
 }
 
-void BufferAllocation::update(const uint8_t *data, const size_t size, const uint32_t offset)
-{
-	assert(data && "Invalid data pointer");
-
-	buffer->update(data, size, offset);
-}
-
 bool BufferAllocation::empty() const
 {
 	return size == 0 || buffer == nullptr;
@@ -42,11 +42,15 @@ class BufferAllocation : public NonCopyable
 	template <class T>
 	void update(const T &value, uint32_t offset = 0)
 	{
-		update(std::vector<uint8_t>{reinterpret_cast<const uint8_t *>(&value),
-		                            reinterpret_cast<const uint8_t *>(&value) + sizeof(T)},
-		       offset);
+		update(reinterpret_cast<const uint8_t *>(&value), sizeof(T), offset);
 	}
 
+	/**
+	 * @brief Copies bytes from caller memory into the allocation
+	 * @param data Bytes to copy
+	 * @param size Number of bytes to copy
+	 * @param offset Offset from the start of the allocation
+	 */
 	void update(const uint8_t *data, size_t size, uint32_t offset = 0);
 
 	bool empty() const;
@@ -0,0 +1,473 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "common/helpers.h"
+#include "common/vk_common.h"
+
+namespace vkb
+{
+class CommandBuffer;
+
+/**
+ * @brief Command Type Enum
+ * 
+ */
+enum class CommandType : uint32_t
+{
+	Begin,
+	End,
+	BeginRenderPass,
+	NextSubpass,
+	EndRenderPass,
+	BindPipelineLayout,
+	ExecuteCommands,
+	PushConstants,
+	BindBuffer,
+	BindImage,
+	BindVertexBuffers,
+	BindIndexBuffer,
+	SetVertexInputFormat,
+	SetViewportState,
+	SetInputAssemblyState,
+	SetRasterizationState,
+	SetMultisampleState,
+	SetDepthStencilState,
+	SetColorBlendState,
+	SetViewport,
+	SetScissor,
+	SetLineWidth,
+	SetDepthBias,
+	SetBlendConstants,
+	SetDepthBounds,
+	Draw,
+	DrawIndexed,
+	DrawIndexedIndirect,
+	Dispatch,
+	DispatchIndirect,
+	UpdateBuffer,
+	BlitImage,
+	CopyImage,
+	CopyBufferToImage,
+	ImageMemoryBarrier,
+	BufferMemoryBarrier
+};
+
+/**
+ * @brief Header at the start of every command packet
+ */
+struct CommandHeader
+{
+	CommandType type;
+
+	/// Size of the packet in bytes, including the header and any trailing array
+	uint32_t size;
+};
+
+/*
+ * Command packets are fixed-layout structures starting with a CommandHeader.
+ * Commands taking a variable number of elements store a count in the packet
+ * and the elements right after it, see CommandArena::get_trailing.
+ * Commands without parameters (End, NextSubpass, EndRenderPass) are a bare CommandHeader.
+ */
+
+struct BeginCommand
+{
+	CommandHeader header;
+
+	VkCommandBufferUsageFlags flags;
+};
+
+/// Followed by command_buffer_count CommandBuffer pointers
+struct ExecuteCommandsCommand
+{
+	CommandHeader header;
+
+	uint32_t render_pass_binding_index;
+
+	uint32_t command_buffer_count;
+};
+
+/// Followed by size bytes of push constant data
+struct PushConstantsCommand
+{
+	CommandHeader header;
+
+	VkPipelineLayout pipeline_layout;
+
+	VkShaderStageFlags shader_stage;
+
+	uint32_t offset;
+
+	uint32_t size;
+};
+
+/// Followed by binding_count VkBuffer handles and then binding_count VkDeviceSize offsets
+struct BindVertexBuffersCommand
+{
+	CommandHeader header;
+
+	uint32_t first_binding;
+
+	uint32_t binding_count;
+};
+
+struct BindIndexBufferCommand
+{
+	CommandHeader header;
+
+	VkBuffer buffer;
+
+	VkDeviceSize offset;
+
+	VkIndexType index_type;
+};
+
+/// Followed by viewport_count VkViewport structures
+struct SetViewportCommand
+{
+	CommandHeader header;
+
+	uint32_t first_viewport;
+
+	uint32_t viewport_count;
+};
+
+/// Followed by scissor_count VkRect2D structures
+struct SetScissorCommand
+{
+	CommandHeader header;
+
+	uint32_t first_scissor;
+
+	uint32_t scissor_count;
+};
+
+struct SetLineWidthCommand
+{
+	CommandHeader header;
+
+	float line_width;
+};
+
+struct SetDepthBiasCommand
+{
+	CommandHeader header;
+
+	float depth_bias_constant_factor;
+
+	float depth_bias_clamp;
+
+	float depth_bias_slope_factor;
+};
+
+struct SetBlendConstantsCommand
+{
+	CommandHeader header;
+
+	float blend_constants[4];
+};
+
+struct SetDepthBoundsCommand
+{
+	CommandHeader header;
+
+	float min_depth_bounds;
+
+	float max_depth_bounds;
+};
+
+struct DrawCommand
+{
+	CommandHeader header;
+
+	uint32_t vertex_count;
+
+	uint32_t instance_count;
+
+	uint32_t first_vertex;
+
+	uint32_t first_instance;
+};
+
+struct DrawIndexedCommand
+{
+	CommandHeader header;
+
+	uint32_t index_count;
+
+	uint32_t instance_count;
+
+	uint32_t first_index;
+
+	int32_t vertex_offset;
+
+	uint32_t first_instance;
+};
+
+struct DrawIndexedIndirectCommand
+{
+	CommandHeader header;
+
+	VkBuffer buffer;
+
+	VkDeviceSize offset;
+
+	uint32_t draw_count;
+
+	uint32_t stride;
+};
+
+struct DispatchCommand
+{
+	CommandHeader header;
+
+	uint32_t group_count_x;
+
+	uint32_t group_count_y;
+
+	uint32_t group_count_z;
+};
+
+struct DispatchIndirectCommand
+{
+	CommandHeader header;
+
+	VkBuffer buffer;
+
+	VkDeviceSize offset;
+};
+
+/// Followed by size bytes of data
+struct UpdateBufferCommand
+{
+	CommandHeader header;
+
+	VkBuffer buffer;
+
+	VkDeviceSize offset;
+
+	VkDeviceSize size;
+};
+
+/// Followed by region_count VkImageBlit structures
+struct BlitImageCommand
+{
+	CommandHeader header;
+
+	VkImage src_image;
+
+	VkImage dst_image;
+
+	uint32_t region_count;
+};
+
+/// Followed by region_count VkImageCopy structures
+struct CopyImageCommand
+{
+	CommandHeader header;
+
+	VkImage src_image;
+
+	VkImage dst_image;
+
+	uint32_t region_count;
+};
+
+/// Followed by region_count VkBufferImageCopy structures
+struct CopyBufferToImageCommand
+{
+	CommandHeader header;
+
+	VkBuffer buffer;
+
+	VkImage image;
+
+	uint32_t region_count;
+};
+
+struct ImageMemoryBarrierCommand
+{
+	CommandHeader header;
+
+	VkImage image;
+
+	VkImageSubresourceRange subresource_range;
+
+	ImageMemoryBarrier memory_barrier;
+};
+
+struct BufferMemoryBarrierCommand
+{
+	CommandHeader header;
+
+	VkBuffer buffer;
+
+	VkDeviceSize offset;
+
+	VkDeviceSize size;
+
+	BufferMemoryBarrier memory_barrier;
+};
+
+/**
+ * @brief Linear buffer of command packets
+ *
+ * Packets are appended back to back and aligned to CommandArena::ALIGNMENT.
+ * Resetting the arena keeps its memory, so once it has grown to the size
+ * of a frame recording does not allocate any more.
+ */
+class CommandArena
+{
+  public:
+	/// Alignment of every packet and of its trailing array
+	static constexpr size_t ALIGNMENT = 8;
+
+	/**
+	 * @brief Rounds a size up to the packet alignment
+	 */
+	static constexpr size_t align(size_t size)
+	{
+		return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+	}
+
+	/**
+	 * @brief Gets the array stored right after a packet
+	 */
+	template <class D, class T>
+	static D *get_trailing(T &packet)
+	{
+		static_assert(alignof(D) <= ALIGNMENT, "Trailing data is over-aligned");
+
+		return reinterpret_cast<D *>(reinterpret_cast<uint8_t *>(&packet) + align(sizeof(T)));
+	}
+
+	template <class D, class T>
+	static const D *get_trailing(const T &packet)
+	{
+		static_assert(alignof(D) <= ALIGNMENT, "Trailing data is over-aligned");
+
+		return reinterpret_cast<const D *>(reinterpret_cast<const uint8_t *>(&packet) + align(sizeof(T)));
+	}
+
+	/**
+	 * @brief Appends a zero-initialized packet to the arena
+	 * @param type Command type written in the packet header
+	 * @param trailing_size Bytes to reserve after the packet for its trailing array
+	 * @return The packet, valid until the next packet is appended
+	 */
+	template <class T>
+	T &append(CommandType type, size_t trailing_size = 0)
+	{
+		static_assert(std::is_trivially_copyable<T>::value && std::is_standard_layout<T>::value, "Command packets must be POD");
+		static_assert(alignof(T) <= ALIGNMENT, "Command packet is over-aligned");
+
+		size_t packet_size = align(sizeof(T)) + align(trailing_size);
+
+		if (size + packet_size > data.size())
+		{
+			// Grow geometrically, the memory is kept across resets
+			data.resize(std::max(data.size() * 2, size + packet_size));
+		}
+
+		uint8_t *packet = data.data() + size;
+		std::memset(packet, 0, packet_size);
+
+		auto &header = *reinterpret_cast<CommandHeader *>(packet);
+		header.type  = type;
+		header.size  = to_u32(packet_size);
+
+		size += packet_size;
+		++count;
+
+		return *reinterpret_cast<T *>(packet);
+	}
+
+	/**
+	 * @brief Replaces the packets with a copy of serialized ones, e.g. read from a frame capture
+	 * @param packets Packets laid out as appended to an arena
+	 * @param packets_size Size of the packets in bytes
+	 * @param packet_count Number of packets
+	 */
+	void assign(const uint8_t *packets, size_t packets_size, size_t packet_count)
+	{
+		if (packets_size > data.size())
+		{
+			data.resize(packets_size);
+		}
+
+		std::memcpy(data.data(), packets, packets_size);
+
+		size  = packets_size;
+		count = packet_count;
+	}
+
+	/**
+	 * @brief Discards all packets while keeping the memory
+	 */
+	void reset()
+	{
+		size  = 0;
+		count = 0;
+	}
+
+	const uint8_t *get_data() const
+	{
+		return data.data();
+	}
+
+	/**
+	 * @return Size in bytes of the recorded packets, which is also the offset of the next packet
+	 */
+	size_t get_size() const
+	{
+		return size;
+	}
+
+	/**
+	 * @return Number of recorded packets
+	 */
+	size_t get_count() const
+	{
+		return count;
+	}
+
+	/**
+	 * @return Bytes reserved by the arena
+	 */
+	size_t get_capacity() const
+	{
+		return data.size();
+	}
+
+  private:
+	std::vector<uint8_t> data;
+
+	size_t size{0};
+
+	size_t count{0};
+};
+}        // namespace vkb
@@ -25,6 +25,7 @@
 #include "core/descriptor_set_layout.h"
 #include "core/device.h"
 #include "core/shader_module.h"
+#include "frozen_commands.h"
 #include "rendering/render_context.h"
 
 namespace vkb
@@ -35,8 +36,8 @@ CommandRecord::CommandRecord(Device &device) :
 
 void CommandRecord::reset()
 {
-	// Clear stream content
-	stream.str("");
+	// Discard recorded packets, the arena keeps its memory for the next frame
+	arena.reset();
 
 	pipeline_state.reset();
 	resource_binding_state.reset();
@@ -45,6 +46,9 @@ void CommandRecord::reset()
 	render_pass_bindings.clear();
 	descriptor_set_bindings.clear();
 	pipeline_bindings.clear();
+
+	pipeline_states.clear();
+	pipeline_state_ids.clear();
 }
 
 Device &CommandRecord::get_device()
@@ -52,9 +56,9 @@ Device &CommandRecord::get_device()
 	return device;
 }
 
-const std::ostringstream &CommandRecord::get_stream() const
+const CommandArena &CommandRecord::get_arena() const
 {
-	return stream;
+	return arena;
 }
 
 std::vector<RenderPassBinding> &CommandRecord::get_render_pass_bindings()
@@ -62,6 +66,11 @@ std::vector<RenderPassBinding> &CommandRecord::get_render_pass_bindings()
 	return render_pass_bindings;
 }
 
+PipelineState &CommandRecord::get_pipeline_state()
+{
+	return pipeline_state;
+}
+
 const std::vector<PipelineBinding> &CommandRecord::get_pipeline_bindings() const
 {
 	return pipeline_bindings;
@@ -72,16 +81,40 @@ const std::vector<DescriptorSetBinding> &CommandRecord::get_descriptor_set_bindi
 	return descriptor_set_bindings;
 }
 
+void CommandRecord::load(const CommandArena &                     arena,
+                         const std::vector<RenderPassBinding> &   render_pass_bindings,
+                         const std::vector<PipelineBinding> &     pipeline_bindings,
+                         const std::vector<DescriptorSetBinding> &descriptor_set_bindings)
+{
+	reset();
+
+	this->arena = arena;
+
+	this->pipeline_bindings = pipeline_bindings;
+
+	// Bindings hold references, so they are copied one by one rather than assigned
+	for (auto &render_pass_binding : render_pass_bindings)
+	{
+		this->render_pass_bindings.push_back(render_pass_binding);
+	}
+
+	for (auto &descriptor_set_binding : descriptor_set_bindings)
+	{
+		this->descriptor_set_bindings.push_back(descriptor_set_binding);
+	}
+}
+
 void CommandRecord::begin(VkCommandBufferUsageFlags flags)
 {
 	// Write command parameters
-	write(stream, CommandType::Begin, flags);
+	auto &command = arena.append<BeginCommand>(CommandType::Begin);
+	command.flags = flags;
 }
 
 void CommandRecord::end()
 {
 	// Write command parameters
-	write(stream, CommandType::End);
+	arena.append<CommandHeader>(CommandType::End);
 }
 
 void vkb::CommandRecord::begin_render_pass(const RenderTarget &              render_target,
@@ -94,15 +127,15 @@ void vkb::CommandRecord::begin_render_pass(const RenderTarget &              ren
 	resource_binding_state.reset();
 	descriptor_set_layout_state.clear();
 
-	RenderPassBinding render_pass_binding{stream.tellp(), render_target};
+	RenderPassBinding render_pass_binding{arena.get_size(), render_target};
 	render_pass_binding.load_store_infos = load_store_infos;
 	render_pass_binding.clear_values     = clear_values;
-	render_pass_binding.contents         = contents;
 
 	// Add first subpass to render pass
-	auto &subpass              = render_pass_binding.subpasses.emplace_back(SubpassDesc{stream.tellp()});
+	auto &subpass              = render_pass_binding.subpasses.emplace_back(SubpassDesc{arena.get_size()});
 	subpass.input_attachments  = render_target.get_input_attachments();
 	subpass.output_attachments = render_target.get_output_attachments();
+	subpass.contents           = contents;
 
 	// Update blend state attachments
 	auto blend_state = pipeline_state.get_color_blend_state();
@@ -120,7 +153,7 @@ void CommandRecord::next_subpass()
 
 	// Add subpass to render pass
 	auto &render_pass_desc     = render_pass_bindings.back();
-	auto &subpass              = render_pass_desc.subpasses.emplace_back(SubpassDesc{stream.tellp()});
+	auto &subpass              = render_pass_desc.subpasses.emplace_back(SubpassDesc{arena.get_size()});
 	subpass.input_attachments  = render_pass_desc.render_target.get_input_attachments();
 	subpass.output_attachments = render_pass_desc.render_target.get_output_attachments();
 
@@ -134,21 +167,58 @@ void CommandRecord::next_subpass()
 	resource_binding_state.reset();
 
 	// Write command parameters
-	write(stream, CommandType::NextSubpass);
+	arena.append<CommandHeader>(CommandType::NextSubpass);
+}
+
+uint32_t CommandRecord::intern_pipeline_state()
+{
+	auto hash = pipeline_state.get_hash();
+
+	auto range = pipeline_state_ids.equal_range(hash);
+
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		if (pipeline_states[it->second] == pipeline_state)
+		{
+			return it->second;
+		}
+	}
+
+	auto id = to_u32(pipeline_states.size());
+
+	pipeline_state_ids.emplace(hash, id);
+
+	pipeline_states.push_back(pipeline_state);
+
+	return id;
 }
 
 void CommandRecord::prepare_pipeline_bindings(CommandRecord &recorder, RenderPassBinding &render_pass_desc)
 {
+	// Each interned state is requested once, however many draws use it
+	std::vector<GraphicsPipeline *> pipelines(recorder.pipeline_states.size(), nullptr);
+	std::vector<bool>               requested(recorder.pipeline_states.size(), false);
+
 	// Iterate over each graphics state that was bound within the subpass
 	for (auto &subpass_desc : render_pass_desc.subpasses)
 	{
 		for (auto &pipeline_desc : subpass_desc.pipeline_descs)
 		{
-			pipeline_desc.pipeline_state.set_render_pass(*render_pass_desc.render_pass);
+			auto id = pipeline_desc.pipeline_state_id;
+
+			if (!requested[id])
+			{
+				auto &pipeline_state = recorder.pipeline_states[id];
+
+				pipeline_state.set_render_pass(*render_pass_desc.render_pass);
+
+				// Does not block when pipelines are compiled asynchronously, the pipeline is null until it is ready
+				pipelines[id] = device.get_resource_cache().request_graphics_pipeline_async(pipeline_state);
 
-			auto &pipeline = device.get_resource_cache().request_graphics_pipeline(pipeline_desc.pipeline_state);
+				requested[id] = true;
+			}
 
-			recorder.pipeline_bindings.push_back({pipeline_desc.event_id, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline});
+			recorder.pipeline_bindings.push_back({pipeline_desc.event_id, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[id]});
 		}
 	}
 }
@@ -173,28 +243,76 @@ void CommandRecord::resolve_subpasses()
 	render_pass_desc.framebuffer = &device.get_resource_cache().request_framebuffer(render_pass_desc.render_target, *render_pass_desc.render_pass);
 
 	prepare_pipeline_bindings(*this, render_pass_desc);
+
+	prepare_secondary_pipeline_bindings(render_pass_desc, render_pass_desc.pending_secondary_command_buffers);
+
+	render_pass_desc.pending_secondary_command_buffers.clear();
 }
 
-void CommandRecord::execute_commands(std::vector<vkb::CommandBuffer *> &sec_cmd_bufs)
+void CommandRecord::prepare_secondary_pipeline_bindings(RenderPassBinding &render_pass_desc, const std::vector<CommandBuffer *> &sec_cmd_bufs)
 {
-	auto &render_pass_desc = render_pass_bindings.back();
-
-	// Also update render pass and pipeline descriptions for every secondary command buffer
+	// Update render pass and pipeline descriptions for every secondary command buffer
 	for (auto &cmd_buf : sec_cmd_bufs)
 	{
-		auto &sec_render_pass_desc       = cmd_buf->get_recorder().render_pass_bindings.back();
+		auto frozen_commands = cmd_buf->get_frozen_commands();
+
+		auto &sec_recorder = frozen_commands ? frozen_commands->get_record() : cmd_buf->get_recorder();
+
+		auto &sec_render_pass_desc = sec_recorder.render_pass_bindings.back();
+
+		if (frozen_commands)
+		{
+			// Frozen pipelines stay valid as long as they are used within the same render pass
+			if (sec_render_pass_desc.render_pass == render_pass_desc.render_pass)
+			{
+				sec_render_pass_desc.framebuffer = render_pass_desc.framebuffer;
+				continue;
+			}
+
+			frozen_commands->unpin_pipelines();
+
+			sec_recorder.pipeline_bindings.clear();
+		}
+
 		sec_render_pass_desc.render_pass = render_pass_desc.render_pass;
 		sec_render_pass_desc.framebuffer = render_pass_desc.framebuffer;
 
-		prepare_pipeline_bindings(cmd_buf->get_recorder(), sec_render_pass_desc);
+		prepare_pipeline_bindings(sec_recorder, sec_render_pass_desc);
+
+		if (frozen_commands)
+		{
+			frozen_commands->pin_pipelines();
+		}
+	}
+}
+
+void CommandRecord::execute_commands(std::vector<vkb::CommandBuffer *> &sec_cmd_bufs)
+{
+	auto &render_pass_desc = render_pass_bindings.back();
+
+	// The subpass must begin with secondary command buffer contents for them to be executed
+	render_pass_desc.subpasses.back().contents = VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS;
+
+	if (render_pass_desc.render_pass)
+	{
+		prepare_secondary_pipeline_bindings(render_pass_desc, sec_cmd_bufs);
 	}
+	else
+	{
+		// The render pass is only known once all its subpasses are recorded
+		render_pass_desc.pending_secondary_command_buffers.insert(render_pass_desc.pending_secondary_command_buffers.end(), sec_cmd_bufs.begin(), sec_cmd_bufs.end());
+	}
+
+	auto &command = arena.append<ExecuteCommandsCommand>(CommandType::ExecuteCommands, sec_cmd_bufs.size() * sizeof(CommandBuffer *));
 
-	write(stream, CommandType::ExecuteCommands, to_u32(render_pass_bindings.size() - 1), sec_cmd_bufs);
+	command.render_pass_binding_index = to_u32(render_pass_bindings.size() - 1);
+	command.command_buffer_count      = to_u32(sec_cmd_bufs.size());
+	std::copy(sec_cmd_bufs.begin(), sec_cmd_bufs.end(), CommandArena::get_trailing<CommandBuffer *>(command));
 }
 
 void CommandRecord::end_render_pass()
 {
-	write(stream, CommandType::EndRenderPass);
+	arena.append<CommandHeader>(CommandType::EndRenderPass);
 }
 
 void CommandRecord::bind_pipeline_layout(PipelineLayout &pipeline_layout)
@@ -208,19 +326,30 @@ void CommandRecord::set_specialization_constant(uint32_t constant_id, const std:
 }
 
 void CommandRecord::push_constants(uint32_t offset, const std::vector<uint8_t> &values)
+{
+	push_constants(offset, values.data(), to_u32(values.size()));
+}
+
+void CommandRecord::push_constants(uint32_t offset, const uint8_t *data, uint32_t size)
 {
 	const PipelineLayout &pipeline_layout = pipeline_state.get_pipeline_layout();
 
-	VkShaderStageFlags shader_stage = pipeline_layout.get_push_constant_range_stage(offset, to_u32(values.size()));
+	VkShaderStageFlags shader_stage = pipeline_layout.get_push_constant_range_stage(offset, size);
 
 	if (shader_stage)
 	{
 		// Write command parameters
-		write(stream, CommandType::PushConstants, pipeline_layout.get_handle(), shader_stage, offset, values);
+		auto &command = arena.append<PushConstantsCommand>(CommandType::PushConstants, size);
+
+		command.pipeline_layout = pipeline_layout.get_handle();
+		command.shader_stage    = shader_stage;
+		command.offset          = offset;
+		command.size            = size;
+		std::copy(data, data + size, CommandArena::get_trailing<uint8_t>(command));
 	}
 	else
 	{
-		LOGW("Push constant range [{}, {}] not found", offset, values.size());
+		LOGW("Push constant range [{}, {}] not found", offset, size);
 	}
 }
 
@@ -241,17 +370,27 @@ void CommandRecord::bind_input(const core::ImageView &image_view, uint32_t set,
 
 void CommandRecord::bind_vertex_buffers(uint32_t first_binding, const std::vector<std::reference_wrapper<const vkb::core::Buffer>> &buffers, const std::vector<VkDeviceSize> &offsets)
 {
-	std::vector<VkBuffer> native_buffers(buffers.size(), VK_NULL_HANDLE);
-	std::transform(buffers.begin(), buffers.end(), native_buffers.begin(),
+	assert(buffers.size() == offsets.size() && "Each vertex buffer needs an offset");
+
+	// Write command parameters, handles and offsets follow the packet
+	auto &command = arena.append<BindVertexBuffersCommand>(CommandType::BindVertexBuffers, buffers.size() * (sizeof(VkBuffer) + sizeof(VkDeviceSize)));
+
+	command.first_binding = first_binding;
+	command.binding_count = to_u32(buffers.size());
+
+	auto native_buffers = CommandArena::get_trailing<VkBuffer>(command);
+	std::transform(buffers.begin(), buffers.end(), native_buffers,
 	               [](const core::Buffer &buffer) { return buffer.get_handle(); });
-	// Write command parameters
-	write(stream, CommandType::BindVertexBuffers, first_binding, native_buffers, offsets);
+	std::copy(offsets.begin(), offsets.end(), reinterpret_cast<VkDeviceSize *>(native_buffers + buffers.size()));
 }
 
 void CommandRecord::bind_index_buffer(const core::Buffer &buffer, VkDeviceSize offset, VkIndexType index_type)
 {
 	// Write command parameters
-	write(stream, CommandType::BindIndexBuffer, buffer.get_handle(), offset, index_type);
+	auto &command      = arena.append<BindIndexBufferCommand>(CommandType::BindIndexBuffer);
+	command.buffer     = buffer.get_handle();
+	command.offset     = offset;
+	command.index_type = index_type;
 }
 
 void CommandRecord::set_viewport_state(const ViewportState &state_info)
@@ -292,37 +431,52 @@ void CommandRecord::set_color_blend_state(const ColorBlendState &state_info)
 void CommandRecord::set_viewport(uint32_t first_viewport, const std::vector<VkViewport> &viewports)
 {
 	// Write command parameters
-	write(stream, CommandType::SetViewport, first_viewport, viewports);
+	auto &command = arena.append<SetViewportCommand>(CommandType::SetViewport, viewports.size() * sizeof(VkViewport));
+
+	command.first_viewport = first_viewport;
+	command.viewport_count = to_u32(viewports.size());
+	std::copy(viewports.begin(), viewports.end(), CommandArena::get_trailing<VkViewport>(command));
 }
 
 void CommandRecord::set_scissor(uint32_t first_scissor, const std::vector<VkRect2D> &scissors)
 {
 	// Write command parameters
-	write(stream, CommandType::SetScissor, first_scissor, scissors);
+	auto &command = arena.append<SetScissorCommand>(CommandType::SetScissor, scissors.size() * sizeof(VkRect2D));
+
+	command.first_scissor = first_scissor;
+	command.scissor_count = to_u32(scissors.size());
+	std::copy(scissors.begin(), scissors.end(), CommandArena::get_trailing<VkRect2D>(command));
 }
 
 void CommandRecord::set_line_width(float line_width)
 {
 	// Write command parameters
-	write(stream, CommandType::SetLineWidth, line_width);
+	auto &command      = arena.append<SetLineWidthCommand>(CommandType::SetLineWidth);
+	command.line_width = line_width;
 }
 
 void CommandRecord::set_depth_bias(float depth_bias_constant_factor, float depth_bias_clamp, float depth_bias_slope_factor)
 {
 	// Write command parameters
-	write(stream, CommandType::SetDepthBias, depth_bias_constant_factor, depth_bias_clamp, depth_bias_slope_factor);
+	auto &command                      = arena.append<SetDepthBiasCommand>(CommandType::SetDepthBias);
+	command.depth_bias_constant_factor = depth_bias_constant_factor;
+	command.depth_bias_clamp           = depth_bias_clamp;
+	command.depth_bias_slope_factor    = depth_bias_slope_factor;
 }
 
 void CommandRecord::set_blend_constants(const std::array<float, 4> &blend_constants)
 {
 	// Write command parameters
-	write(stream, CommandType::SetBlendConstants, blend_constants);
+	auto &command = arena.append<SetBlendConstantsCommand>(CommandType::SetBlendConstants);
+	std::copy(blend_constants.begin(), blend_constants.end(), command.blend_constants);
 }
 
 void CommandRecord::set_depth_bounds(float min_depth_bounds, float max_depth_bounds)
 {
 	// Write command parameters
-	write(stream, CommandType::SetDepthBounds, min_depth_bounds, max_depth_bounds);
+	auto &command            = arena.append<SetDepthBoundsCommand>(CommandType::SetDepthBounds);
+	command.min_depth_bounds = min_depth_bounds;
+	command.max_depth_bounds = max_depth_bounds;
 }
 
 void CommandRecord::draw(uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance)
@@ -332,7 +486,11 @@ void CommandRecord::draw(uint32_t vertex_count, uint32_t instance_count, uint32_
 	flush_descriptor_state(VK_PIPELINE_BIND_POINT_GRAPHICS);
 
 	// Write command parameters
-	write(stream, CommandType::Draw, vertex_count, instance_count, first_vertex, first_instance);
+	auto &command          = arena.append<DrawCommand>(CommandType::Draw);
+	command.vertex_count   = vertex_count;
+	command.instance_count = instance_count;
+	command.first_vertex   = first_vertex;
+	command.first_instance = first_instance;
 }
 
 void CommandRecord::draw_indexed(uint32_t index_count, uint32_t instance_count, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance)
@@ -342,7 +500,12 @@ void CommandRecord::draw_indexed(uint32_t index_count, uint32_t instance_count,
 	flush_descriptor_state(VK_PIPELINE_BIND_POINT_GRAPHICS);
 
 	// Write command parameters
-	write(stream, CommandType::DrawIndexed, index_count, instance_count, first_index, vertex_offset, first_instance);
+	auto &command          = arena.append<DrawIndexedCommand>(CommandType::DrawIndexed);
+	command.index_count    = index_count;
+	command.instance_count = instance_count;
+	command.first_index    = first_index;
+	command.vertex_offset  = vertex_offset;
+	command.first_instance = first_instance;
 }
 
 void CommandRecord::draw_indexed_indirect(const core::Buffer &buffer, VkDeviceSize offset, uint32_t draw_count, uint32_t stride)
@@ -352,7 +515,11 @@ void CommandRecord::draw_indexed_indirect(const core::Buffer &buffer, VkDeviceSi
 	flush_descriptor_state(VK_PIPELINE_BIND_POINT_GRAPHICS);
 
 	// Write command parameters
-	write(stream, CommandType::DrawIndexedIndirect, buffer.get_handle(), offset, draw_count, stride);
+	auto &command      = arena.append<DrawIndexedIndirectCommand>(CommandType::DrawIndexedIndirect);
+	command.buffer     = buffer.get_handle();
+	command.offset     = offset;
+	command.draw_count = draw_count;
+	command.stride     = stride;
 }
 
 void CommandRecord::dispatch(uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
@@ -362,7 +529,10 @@ void CommandRecord::dispatch(uint32_t group_count_x, uint32_t group_count_y, uin
 	flush_descriptor_state(VK_PIPELINE_BIND_POINT_COMPUTE);
 
 	// Write command parameters
-	write(stream, CommandType::Dispatch, group_count_x, group_count_y, group_count_z);
+	auto &command         = arena.append<DispatchCommand>(CommandType::Dispatch);
+	command.group_count_x = group_count_x;
+	command.group_count_y = group_count_y;
+	command.group_count_z = group_count_z;
 }
 
 void CommandRecord::dispatch_indirect(const core::Buffer &buffer, VkDeviceSize offset)
@@ -372,48 +542,82 @@ void CommandRecord::dispatch_indirect(const core::Buffer &buffer, VkDeviceSize o
 	flush_descriptor_state(VK_PIPELINE_BIND_POINT_COMPUTE);
 
 	// Write command parameters
-	write(stream, CommandType::DispatchIndirect, buffer.get_handle(), offset);
+	auto &command  = arena.append<DispatchIndirectCommand>(CommandType::DispatchIndirect);
+	command.buffer = buffer.get_handle();
+	command.offset = offset;
 }
 
 void CommandRecord::update_buffer(const core::Buffer &buffer, VkDeviceSize offset, const std::vector<uint8_t> &data)
+{
+	update_buffer(buffer, offset, data.data(), data.size());
+}
+
+void CommandRecord::update_buffer(const core::Buffer &buffer, VkDeviceSize offset, const uint8_t *data, VkDeviceSize size)
 {
 	// Write command parameters
-	write(stream, CommandType::UpdateBuffer, buffer.get_handle(), offset, data);
+	auto &command = arena.append<UpdateBufferCommand>(CommandType::UpdateBuffer, static_cast<size_t>(size));
+
+	command.buffer = buffer.get_handle();
+	command.offset = offset;
+	command.size   = size;
+	std::copy(data, data + size, CommandArena::get_trailing<uint8_t>(command));
 }
 
 void CommandRecord::blit_image(const core::Image &src_img, const core::Image &dst_img, const std::vector<VkImageBlit> &regions)
 {
 	// Write command parameters
-	write(stream, CommandType::BlitImage, src_img.get_handle(), dst_img.get_handle(), regions);
+	auto &command = arena.append<BlitImageCommand>(CommandType::BlitImage, regions.size() * sizeof(VkImageBlit));
+
+	command.src_image    = src_img.get_handle();
+	command.dst_image    = dst_img.get_handle();
+	command.region_count = to_u32(regions.size());
+	std::copy(regions.begin(), regions.end(), CommandArena::get_trailing<VkImageBlit>(command));
 }
 
 void CommandRecord::copy_image(const core::Image &src_img, const core::Image &dst_img, const std::vector<VkImageCopy> &regions)
 {
 	// Write command parameters
-	write(stream, CommandType::CopyImage, src_img.get_handle(), dst_img.get_handle(), regions);
+	auto &command = arena.append<CopyImageCommand>(CommandType::CopyImage, regions.size() * sizeof(VkImageCopy));
+
+	command.src_image    = src_img.get_handle();
+	command.dst_image    = dst_img.get_handle();
+	command.region_count = to_u32(regions.size());
+	std::copy(regions.begin(), regions.end(), CommandArena::get_trailing<VkImageCopy>(command));
 }
 
 void CommandRecord::copy_buffer_to_image(const core::Buffer &buffer, const core::Image &image, const std::vector<VkBufferImageCopy> &regions)
 {
 	// Write command parameters
-	write(stream, CommandType::CopyBufferToImage, buffer.get_handle(), image.get_handle(), regions);
+	auto &command = arena.append<CopyBufferToImageCommand>(CommandType::CopyBufferToImage, regions.size() * sizeof(VkBufferImageCopy));
+
+	command.buffer       = buffer.get_handle();
+	command.image        = image.get_handle();
+	command.region_count = to_u32(regions.size());
+	std::copy(regions.begin(), regions.end(), CommandArena::get_trailing<VkBufferImageCopy>(command));
 }
 
 void CommandRecord::image_memory_barrier(const core::ImageView &image_view, const ImageMemoryBarrier &memory_barrier)
 {
 	// Write command parameters
-	write(stream, CommandType::ImageMemoryBarrier, image_view.get_image().get_handle(), image_view.get_subresource_range(), memory_barrier);
+	auto &command             = arena.append<ImageMemoryBarrierCommand>(CommandType::ImageMemoryBarrier);
+	command.image             = image_view.get_image().get_handle();
+	command.subresource_range = image_view.get_subresource_range();
+	command.memory_barrier    = memory_barrier;
 }
 
 void CommandRecord::buffer_memory_barrier(const core::Buffer &buffer, VkDeviceSize offset, VkDeviceSize size, const BufferMemoryBarrier &memory_barrier)
 {
 	// Write command parameters
-	write(stream, CommandType::BufferMemoryBarrier, buffer.get_handle(), offset, size, memory_barrier);
+	auto &command          = arena.append<BufferMemoryBarrierCommand>(CommandType::BufferMemoryBarrier);
+	command.buffer         = buffer.get_handle();
+	command.offset         = offset;
+	command.size           = size;
+	command.memory_barrier = memory_barrier;
 }
 
 void CommandRecord::flush_pipeline_state(VkPipelineBindPoint pipeline_bind_point)
 {
-	// Create a new pipeline in the command stream only if the graphics state changed
+	// Create a new pipeline in the command arena only if the graphics state changed
 	if (!pipeline_state.is_dirty())
 	{
 		return;
@@ -428,14 +632,22 @@ void CommandRecord::flush_pipeline_state(VkPipelineBindPoint pipeline_bind_point
 
 		SubpassDesc &subpass = render_pass_bindings.back().subpasses.back();
 
+		auto pipeline_state_id = intern_pipeline_state();
+
+		// A state changed and then restored before the next draw needs no new binding
+		if (!subpass.pipeline_descs.empty() && subpass.pipeline_descs.back().pipeline_state_id == pipeline_state_id)
+		{
+			return;
+		}
+
 		// Add graphics state to the current subpass
-		subpass.pipeline_descs.push_back({stream.tellp(), pipeline_state});
+		subpass.pipeline_descs.push_back({arena.get_size(), pipeline_state_id});
 	}
 	else if (pipeline_bind_point == VK_PIPELINE_BIND_POINT_COMPUTE)
 	{
 		auto &pipeline = device.get_resource_cache().request_compute_pipeline(pipeline_state);
 
-		pipeline_bindings.push_back({stream.tellp(), pipeline_bind_point, pipeline});
+		pipeline_bindings.push_back({arena.get_size(), pipeline_bind_point, &pipeline});
 	}
 	else
 	{
@@ -588,7 +800,7 @@ void CommandRecord::flush_descriptor_state(VkPipelineBindPoint pipeline_bind_poi
 
 			auto &descriptor_set = device.get_resource_cache().request_descriptor_set(descriptor_set_layout, buffer_infos, image_infos);
 
-			descriptor_set_bindings.push_back({stream.tellp(), pipeline_bind_point, pipeline_layout, set_it.first, descriptor_set, dynamic_offsets});
+			descriptor_set_bindings.push_back({arena.get_size(), pipeline_bind_point, pipeline_layout, set_it.first, descriptor_set, dynamic_offsets});
 		}
 	}
 }
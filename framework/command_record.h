@@ -20,8 +20,9 @@
 
 #pragma once
 
-#include <list>
+#include <vector>
 
+#include "command_arena.h"
 #include "common/vk_common.h"
 #include "core/descriptor_set.h"
 #include "core/framebuffer.h"
@@ -45,9 +46,10 @@ class CommandBuffer;
  */
 struct PipelineDesc
 {
-	std::streampos event_id{};
+	size_t event_id{};
 
-	PipelineState pipeline_state;
+	/// Index of the state in the pipeline states interned by the recorder
+	uint32_t pipeline_state_id{};
 };
 
 /*
@@ -56,13 +58,16 @@ struct PipelineDesc
  */
 struct SubpassDesc
 {
-	std::streampos event_id{};
+	size_t event_id{};
 
 	std::vector<uint32_t> input_attachments;
 
 	std::vector<uint32_t> output_attachments;
 
-	std::list<PipelineDesc> pipeline_descs;
+	std::vector<PipelineDesc> pipeline_descs;
+
+	/// Set to secondary command buffers when commands are executed within the subpass
+	VkSubpassContents contents{VK_SUBPASS_CONTENTS_INLINE};
 };
 
 /*
@@ -70,7 +75,7 @@ struct SubpassDesc
  */
 struct RenderPassBinding
 {
-	std::streampos event_id;
+	size_t event_id;
 
 	const RenderTarget &render_target;
 
@@ -84,7 +89,8 @@ struct RenderPassBinding
 
 	const Framebuffer *framebuffer;
 
-	VkSubpassContents contents{VK_SUBPASS_CONTENTS_INLINE};
+	/// Secondary command buffers executed before the render pass was resolved, their pipelines are prepared with it
+	std::vector<CommandBuffer *> pending_secondary_command_buffers;
 };
 
 /*
@@ -92,11 +98,12 @@ struct RenderPassBinding
  */
 struct PipelineBinding
 {
-	std::streampos event_id;
+	size_t event_id;
 
 	VkPipelineBindPoint pipeline_bind_point;
 
-	const Pipeline &pipeline;
+	/// Null if the pipeline is still being compiled asynchronously, draws are skipped until the next binding
+	const Pipeline *pipeline;
 };
 
 /*
@@ -104,7 +111,7 @@ struct PipelineBinding
  */
 struct DescriptorSetBinding
 {
-	std::streampos event_id;
+	size_t event_id;
 
 	VkPipelineBindPoint pipeline_bind_point;
 
@@ -117,52 +124,8 @@ struct DescriptorSetBinding
 	std::vector<uint32_t> dynamic_offsets;
 };
 
-/**
- * @brief Command Type Enum
- * 
- */
-enum class CommandType
-{
-	Begin,
-	End,
-	BeginRenderPass,
-	NextSubpass,
-	EndRenderPass,
-	BindPipelineLayout,
-	ExecuteCommands,
-	PushConstants,
-	BindBuffer,
-	BindImage,
-	BindVertexBuffers,
-	BindIndexBuffer,
-	SetVertexInputFormat,
-	SetViewportState,
-	SetInputAssemblyState,
-	SetRasterizationState,
-	SetMultisampleState,
-	SetDepthStencilState,
-	SetColorBlendState,
-	SetViewport,
-	SetScissor,
-	SetLineWidth,
-	SetDepthBias,
-	SetBlendConstants,
-	SetDepthBounds,
-	Draw,
-	DrawIndexed,
-	DrawIndexedIndirect,
-	Dispatch,
-	DispatchIndirect,
-	UpdateBuffer,
-	BlitImage,
-	CopyImage,
-	CopyBufferToImage,
-	ImageMemoryBarrier,
-	BufferMemoryBarrier
-};
-
 /*
- * @brief Writes Vulkan commands in a memory stream while building 
+ * @brief Writes Vulkan commands as packets in an arena while building 
  *        Vulkan pipelines and descriptor sets for each draw only if state changes.
  */
 class CommandRecord
@@ -174,14 +137,31 @@ class CommandRecord
 
 	Device &get_device();
 
-	const std::ostringstream &get_stream() const;
+	/**
+	 * @brief Gets the recorded command packets, binding event ids are offsets in this arena
+	 */
+	const CommandArena &get_arena() const;
 
 	std::vector<RenderPassBinding> &get_render_pass_bindings();
 
+	/**
+	 * @brief Gets the pipeline state the next draws will use, secondary command buffers start from the one of their primary
+	 */
+	PipelineState &get_pipeline_state();
+
 	const std::vector<PipelineBinding> &get_pipeline_bindings() const;
 
 	const std::vector<DescriptorSetBinding> &get_descriptor_set_bindings() const;
 
+	/**
+	 * @brief Replaces the recorded commands with commands which were recorded and resolved elsewhere,
+	 *        e.g. loaded from a frame capture
+	 */
+	void load(const CommandArena &                     arena,
+	          const std::vector<RenderPassBinding> &   render_pass_bindings,
+	          const std::vector<PipelineBinding> &     pipeline_bindings,
+	          const std::vector<DescriptorSetBinding> &descriptor_set_bindings);
+
 	void begin(VkCommandBufferUsageFlags flags);
 
 	void end();
@@ -202,6 +182,11 @@ class CommandRecord
 
 	void push_constants(uint32_t offset, const std::vector<uint8_t> &values);
 
+	/**
+	 * @brief Copies the constants from caller memory into the packet payload
+	 */
+	void push_constants(uint32_t offset, const uint8_t *data, uint32_t size);
+
 	/**
 	 * @brief It binds a buffer to an uniform
 	 * @param buffer Buffer to bind
@@ -344,6 +329,8 @@ class CommandRecord
 
 	void update_buffer(const core::Buffer &buffer, VkDeviceSize offset, const std::vector<uint8_t> &data);
 
+	void update_buffer(const core::Buffer &buffer, VkDeviceSize offset, const uint8_t *data, VkDeviceSize size);
+
 	void blit_image(const core::Image &src_img, const core::Image &dst_img, const std::vector<VkImageBlit> &regions);
 
 	void copy_image(const core::Image &src_img, const core::Image &dst_img, const std::vector<VkImageCopy> &regions);
@@ -357,7 +344,7 @@ class CommandRecord
   private:
 	Device &device;
 
-	std::ostringstream stream;
+	CommandArena arena;
 
 	std::vector<RenderPassBinding> render_pass_bindings;
 
@@ -371,8 +358,26 @@ class CommandRecord
 
 	std::unordered_map<uint32_t, DescriptorSetLayout *> descriptor_set_layout_state;
 
+	/// Graphics states used by the recorded draws, identical states are stored once
+	std::vector<PipelineState> pipeline_states;
+
+	/// Indices of the interned states in pipeline_states, by state hash.
+	/// States sharing a hash are told apart by comparing them.
+	std::unordered_multimap<uint64_t, uint32_t> pipeline_state_ids;
+
+	/**
+	 * @brief Adds the current pipeline state to the interned states if it is not there yet
+	 * @return Index of the state in the interned states
+	 */
+	uint32_t intern_pipeline_state();
+
 	void prepare_pipeline_bindings(CommandRecord &recorder, RenderPassBinding &render_pass_desc);
 
+	/**
+	 * @brief Prepares the pipelines of secondary command buffers for the render pass they are executed in
+	 */
+	void prepare_secondary_pipeline_bindings(RenderPassBinding &render_pass_desc, const std::vector<CommandBuffer *> &sec_cmd_bufs);
+
 	/**
 	 * @brief Flush the piplines state
 	 * 
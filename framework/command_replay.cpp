@@ -20,67 +20,86 @@
 
 #include "command_replay.h"
 
+#include <exception>
+
+#include <ctpl_stl.h>
+
 #include "common/logging.h"
 #include "common/vk_common.h"
 #include "core/command_buffer.h"
 #include "core/descriptor_set.h"
 #include "core/device.h"
+#include "frozen_commands.h"
 
 namespace vkb
 {
-CommandReplay::CommandReplay()
-{
-	stream_commands[CommandType::Begin]               = std::bind(&CommandReplay::begin, this, std::placeholders::_1, std::placeholders::_2);
-	stream_commands[CommandType::End]                 = std::bind(&CommandReplay::end, this, std::placeholders::_1, std::placeholders::_2);
-	stream_commands[CommandType::NextSubpass]         = std::bind(&CommandReplay::next_subpass, this, std::placeholders::_1, std::placeholders::_2);
-	stream_commands[CommandType::EndRenderPass]       = std::bind(&CommandReplay::end_render_pass, this, std::placeholders::_1, std::placeholders::_2);
-	stream_commands[CommandType::ExecuteCommands]     = std::bind(&CommandReplay::execute_commands, this, std::placeholders::_1, std::placeholders::_2);
-	stream_commands[CommandType::PushConstants]       = std::bind(&CommandReplay::push_constants, this, std::placeholders::_1, std::placeholders::_2);
-	stream_commands[CommandType::BindVertexBuffers]   = std::bind(&CommandReplay::bind_vertex_buffers, this, std::placeholders::_1, std::placeholders::_2);
-	stream_commands[CommandType::BindIndexBuffer]     = std::bind(&CommandReplay::bind_index_buffer, this, std::placeholders::_1, std::placeholders::_2);
-	stream_commands[CommandType::SetViewport]         = std::bind(&CommandReplay::set_viewport, this, std::placeholders::_1, std::placeholders::_2);
-	stream_commands[CommandType::SetScissor]          = std::bind(&CommandReplay::set_scissor, this, std::placeholders::_1, std::placeholders::_2);
-	stream_commands[CommandType::SetLineWidth]        = std::bind(&CommandReplay::set_line_width, this, std::placeholders::_1, std::placeholders::_2);
-	stream_commands[CommandType::SetDepthBias]        = std::bind(&CommandReplay::set_depth_bias, this, std::placeholders::_1, std::placeholders::_2);
-	stream_commands[CommandType::SetBlendConstants]   = std::bind(&CommandReplay::set_blend_constants, this, std::placeholders::_1, std::placeholders::_2);
-	stream_commands[CommandType::SetDepthBounds]      = std::bind(&CommandReplay::set_depth_bounds, this, std::placeholders::_1, std::placeholders::_2);
-	stream_commands[CommandType::Draw]                = std::bind(&CommandReplay::draw, this, std::placeholders::_1, std::placeholders::_2);
-	stream_commands[CommandType::DrawIndexed]         = std::bind(&CommandReplay::draw_indexed, this, std::placeholders::_1, std::placeholders::_2);
-	stream_commands[CommandType::DrawIndexedIndirect] = std::bind(&CommandReplay::draw_indexed_indirect, this, std::placeholders::_1, std::placeholders::_2);
-	stream_commands[CommandType::Dispatch]            = std::bind(&CommandReplay::dispatch, this, std::placeholders::_1, std::placeholders::_2);
-	stream_commands[CommandType::DispatchIndirect]    = std::bind(&CommandReplay::dispatch_indirect, this, std::placeholders::_1, std::placeholders::_2);
-	stream_commands[CommandType::UpdateBuffer]        = std::bind(&CommandReplay::update_buffer, this, std::placeholders::_1, std::placeholders::_2);
-	stream_commands[CommandType::BlitImage]           = std::bind(&CommandReplay::blit_image, this, std::placeholders::_1, std::placeholders::_2);
-	stream_commands[CommandType::CopyImage]           = std::bind(&CommandReplay::copy_image, this, std::placeholders::_1, std::placeholders::_2);
-	stream_commands[CommandType::CopyBufferToImage]   = std::bind(&CommandReplay::copy_buffer_to_image, this, std::placeholders::_1, std::placeholders::_2);
-	stream_commands[CommandType::ImageMemoryBarrier]  = std::bind(&CommandReplay::image_memory_barrier, this, std::placeholders::_1, std::placeholders::_2);
-	stream_commands[CommandType::BufferMemoryBarrier] = std::bind(&CommandReplay::buffer_memory_barrier, this, std::placeholders::_1, std::placeholders::_2);
-}
-
 void CommandReplay::play(CommandBuffer &command_buffer, CommandRecord &recorder)
 {
-	std::istringstream stream{recorder.get_stream().str()};
+	// Walk the packets in place, the recorder keeps them alive until it is reset
+	const CommandArena &arena = recorder.get_arena();
+
+	const uint8_t *data = arena.get_data();
+
+	const size_t size = arena.get_size();
+
+	size_t offset = 0;
 
-	// Get the first render pass to bind
-	auto render_pass_binding_it = recorder.get_render_pass_bindings().cbegin();
+	const auto &render_pass_bindings    = recorder.get_render_pass_bindings();
+	const auto &pipeline_bindings       = recorder.get_pipeline_bindings();
+	const auto &descriptor_set_bindings = recorder.get_descriptor_set_bindings();
+
+	// Get the first render pass to bind, secondary command buffers inherit it from their primary
+	auto render_pass_binding_it = command_buffer.level == VK_COMMAND_BUFFER_LEVEL_PRIMARY ? render_pass_bindings.cbegin() : render_pass_bindings.cend();
 
 	// Get the first pipeline bindings to bind.
-	auto pipeline_binding_it = recorder.get_pipeline_bindings().cbegin();
+	auto pipeline_binding_it = pipeline_bindings.cbegin();
 
 	// Get the first descriptor set to bind
-	auto descriptor_set_binding_it = recorder.get_descriptor_set_bindings().cbegin();
+	auto descriptor_set_binding_it = descriptor_set_bindings.cbegin();
+
+	// Event id of the closest pending binding, packets before it are replayed without looking at the bindings
+	auto get_next_event_id = [&]() {
+		size_t event_id = std::numeric_limits<size_t>::max();
+
+		if (render_pass_binding_it != render_pass_bindings.cend())
+		{
+			event_id = std::min(event_id, render_pass_binding_it->event_id);
+		}
+
+		if (pipeline_binding_it != pipeline_bindings.cend())
+		{
+			event_id = std::min(event_id, pipeline_binding_it->event_id);
+		}
+
+		if (descriptor_set_binding_it != descriptor_set_bindings.cend())
+		{
+			event_id = std::min(event_id, descriptor_set_binding_it->event_id);
+		}
+
+		return event_id;
+	};
+
+	size_t next_event_id = get_next_event_id();
+
+	skip_draws = false;
+
+	state_filter_enabled = command_buffer.get_device().is_state_filter_enabled();
+
+	removed_call_count = 0;
+
+	pipeline_bind_count = 0;
+
+	descriptor_set_switch_count = 0;
+
+	reset_state_filter();
 
 	while (true)
 	{
-		// Get current event id
-		std::streampos event_id = stream.tellg();
-
-		// Check to see if there are any render passes left
-		if (command_buffer.level == VK_COMMAND_BUFFER_LEVEL_PRIMARY &&
-		    render_pass_binding_it != recorder.get_render_pass_bindings().cend())
+		if (offset == next_event_id)
 		{
-			// Current render pass event id must be equal to the current event id
-			if (render_pass_binding_it->event_id == event_id)
+			// Check to see if there are any render passes left
+			if (render_pass_binding_it != render_pass_bindings.cend() &&
+			    render_pass_binding_it->event_id == offset)
 			{
 				VkRenderPassBeginInfo begin_info{VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
 
@@ -91,122 +110,313 @@ void CommandReplay::play(CommandBuffer &command_buffer, CommandRecord &recorder)
 				begin_info.pClearValues      = render_pass_binding_it->clear_values.data();
 
 				// Begin render pass
-				vkCmdBeginRenderPass(command_buffer.get_handle(), &begin_info, render_pass_binding_it->contents);
+				vkCmdBeginRenderPass(command_buffer.get_handle(), &begin_info, render_pass_binding_it->subpasses.front().contents);
+
+				// Kept to begin the following subpasses with their own contents
+				current_render_pass_binding = &*render_pass_binding_it;
+				current_subpass_index       = 0;
 
 				// Move to the next render pass
 				++render_pass_binding_it;
 			}
-		}
 
-		// Check to see if there are any pipeline bindings left
-		if (pipeline_binding_it != recorder.get_pipeline_bindings().cend())
-		{
-			// The next pipeline binding's event id must be equal to the current read position.
-			if (pipeline_binding_it->event_id == event_id)
+			// Check to see if there are any pipeline bindings left
+			if (pipeline_binding_it != pipeline_bindings.cend() &&
+			    pipeline_binding_it->event_id == offset)
 			{
-				// Bind pipeline.
-				vkCmdBindPipeline(command_buffer.get_handle(),
-				                  pipeline_binding_it->pipeline_bind_point,
-				                  pipeline_binding_it->pipeline.get_handle());
+				// A pipeline which is still compiling skips the draws until the next pipeline binding
+				skip_draws = pipeline_binding_it->pipeline == nullptr;
+
+				if (!skip_draws && !is_redundant(*pipeline_binding_it))
+				{
+					// Bind pipeline.
+					vkCmdBindPipeline(command_buffer.get_handle(),
+					                  pipeline_binding_it->pipeline_bind_point,
+					                  pipeline_binding_it->pipeline->get_handle());
+
+					++pipeline_bind_count;
+				}
 
 				// Move to the next pipeline binding
 				++pipeline_binding_it;
 			}
-		}
 
-		// Check to see if there are any descriptor set bindings left
-		if (descriptor_set_binding_it != recorder.get_descriptor_set_bindings().cend())
-		{
-			// The next descriptor set binding's event id must be equal to the current read position.
-			while (descriptor_set_binding_it->event_id == event_id)
+			// The next descriptor set bindings' event id must be equal to the current read position.
+			while (descriptor_set_binding_it != descriptor_set_bindings.cend() &&
+			       descriptor_set_binding_it->event_id == offset)
 			{
-				VkDescriptorSet descriptor_set = descriptor_set_binding_it->descriptor_set.get_handle();
-
-				// Bind descriptor set
-				vkCmdBindDescriptorSets(command_buffer.get_handle(),
-				                        descriptor_set_binding_it->pipeline_bind_point,
-				                        descriptor_set_binding_it->pipeline_layout.get_handle(),
-				                        descriptor_set_binding_it->set_index,
-				                        1, &descriptor_set,
-				                        to_u32(descriptor_set_binding_it->dynamic_offsets.size()),
-				                        descriptor_set_binding_it->dynamic_offsets.data());
-
-				// Move to the next descriptor set binding
-				if (++descriptor_set_binding_it == recorder.get_descriptor_set_bindings().cend())
+				if (!is_redundant(*descriptor_set_binding_it))
 				{
-					break;
+					VkDescriptorSet descriptor_set = descriptor_set_binding_it->descriptor_set.get_handle();
+
+					// Bind descriptor set
+					vkCmdBindDescriptorSets(command_buffer.get_handle(),
+					                        descriptor_set_binding_it->pipeline_bind_point,
+					                        descriptor_set_binding_it->pipeline_layout.get_handle(),
+					                        descriptor_set_binding_it->set_index,
+					                        1, &descriptor_set,
+					                        to_u32(descriptor_set_binding_it->dynamic_offsets.size()),
+					                        descriptor_set_binding_it->dynamic_offsets.data());
+
+					// Only a change of dynamic offsets is not counted as a switch
+					if (descriptor_set_binding_it->set_index < MAX_FILTERED_SETS)
+					{
+						auto &last_descriptor_set = last_descriptor_sets[descriptor_set_binding_it->pipeline_bind_point][descriptor_set_binding_it->set_index];
+
+						descriptor_set_switch_count += last_descriptor_set != descriptor_set;
+
+						last_descriptor_set = descriptor_set;
+					}
 				}
+
+				// Move to the next descriptor set binding
+				++descriptor_set_binding_it;
 			}
-		}
 
-		// Read command id
-		CommandType cmd;
-		read(stream, cmd);
+			next_event_id = get_next_event_id();
+		}
 
-		if (stream.eof())
+		if (offset >= size)
 		{
 			break;
 		}
 
-		// Find command function for the given command id
-		auto cmd_it = stream_commands.find(cmd);
+		// Read command header
+		auto &header = *reinterpret_cast<const CommandHeader *>(data + offset);
 
-		// Check if command replayer supports the given command
-		if (cmd_it != stream_commands.end())
-		{
-			// Run command function
-			stream_commands.at(cmd)(command_buffer, stream);
-		}
-		else
+		offset += header.size;
+
+		// The handlers are defined below in this file so that they can be inlined in the switch
+		switch (header.type)
 		{
-			LOGE("Replay command not supported.");
+			case CommandType::Begin:
+				begin(command_buffer, reinterpret_cast<const BeginCommand &>(header));
+				break;
+			case CommandType::End:
+				end(command_buffer);
+				break;
+			case CommandType::NextSubpass:
+				next_subpass(command_buffer);
+				break;
+			case CommandType::EndRenderPass:
+				end_render_pass(command_buffer);
+				break;
+			case CommandType::ExecuteCommands:
+				execute_commands(command_buffer, reinterpret_cast<const ExecuteCommandsCommand &>(header));
+				break;
+			case CommandType::PushConstants:
+				push_constants(command_buffer, reinterpret_cast<const PushConstantsCommand &>(header));
+				break;
+			case CommandType::BindVertexBuffers:
+				bind_vertex_buffers(command_buffer, reinterpret_cast<const BindVertexBuffersCommand &>(header));
+				break;
+			case CommandType::BindIndexBuffer:
+				bind_index_buffer(command_buffer, reinterpret_cast<const BindIndexBufferCommand &>(header));
+				break;
+			case CommandType::SetViewport:
+				set_viewport(command_buffer, reinterpret_cast<const SetViewportCommand &>(header));
+				break;
+			case CommandType::SetScissor:
+				set_scissor(command_buffer, reinterpret_cast<const SetScissorCommand &>(header));
+				break;
+			case CommandType::SetLineWidth:
+				set_line_width(command_buffer, reinterpret_cast<const SetLineWidthCommand &>(header));
+				break;
+			case CommandType::SetDepthBias:
+				set_depth_bias(command_buffer, reinterpret_cast<const SetDepthBiasCommand &>(header));
+				break;
+			case CommandType::SetBlendConstants:
+				set_blend_constants(command_buffer, reinterpret_cast<const SetBlendConstantsCommand &>(header));
+				break;
+			case CommandType::SetDepthBounds:
+				set_depth_bounds(command_buffer, reinterpret_cast<const SetDepthBoundsCommand &>(header));
+				break;
+			case CommandType::Draw:
+				draw(command_buffer, reinterpret_cast<const DrawCommand &>(header));
+				break;
+			case CommandType::DrawIndexed:
+				draw_indexed(command_buffer, reinterpret_cast<const DrawIndexedCommand &>(header));
+				break;
+			case CommandType::DrawIndexedIndirect:
+				draw_indexed_indirect(command_buffer, reinterpret_cast<const DrawIndexedIndirectCommand &>(header));
+				break;
+			case CommandType::Dispatch:
+				dispatch(command_buffer, reinterpret_cast<const DispatchCommand &>(header));
+				break;
+			case CommandType::DispatchIndirect:
+				dispatch_indirect(command_buffer, reinterpret_cast<const DispatchIndirectCommand &>(header));
+				break;
+			case CommandType::UpdateBuffer:
+				update_buffer(command_buffer, reinterpret_cast<const UpdateBufferCommand &>(header));
+				break;
+			case CommandType::BlitImage:
+				blit_image(command_buffer, reinterpret_cast<const BlitImageCommand &>(header));
+				break;
+			case CommandType::CopyImage:
+				copy_image(command_buffer, reinterpret_cast<const CopyImageCommand &>(header));
+				break;
+			case CommandType::CopyBufferToImage:
+				copy_buffer_to_image(command_buffer, reinterpret_cast<const CopyBufferToImageCommand &>(header));
+				break;
+			case CommandType::ImageMemoryBarrier:
+				image_memory_barrier(command_buffer, reinterpret_cast<const ImageMemoryBarrierCommand &>(header));
+				break;
+			case CommandType::BufferMemoryBarrier:
+				buffer_memory_barrier(command_buffer, reinterpret_cast<const BufferMemoryBarrierCommand &>(header));
+				break;
+			default:
+				LOGE("Replay command not supported.");
+				break;
 		}
 	}
 }
 
-void CommandReplay::begin(CommandBuffer &command_buffer, std::istringstream &stream)
+size_t CommandReplay::get_removed_call_count() const
 {
-	VkCommandBufferBeginInfo begin_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+	return removed_call_count;
+}
+
+size_t CommandReplay::get_pipeline_bind_count() const
+{
+	return pipeline_bind_count;
+}
+
+size_t CommandReplay::get_descriptor_set_switch_count() const
+{
+	return descriptor_set_switch_count;
+}
+
+void CommandReplay::reset_state_filter()
+{
+	last_state_packets.fill(nullptr);
+
+	for (auto &descriptor_sets : last_descriptor_sets)
+	{
+		descriptor_sets.fill(VK_NULL_HANDLE);
+	}
+
+	bound_pipelines.fill(VK_NULL_HANDLE);
+
+	bound_pipeline_layouts.fill(VK_NULL_HANDLE);
+
+	for (auto &descriptor_sets : bound_descriptor_sets)
+	{
+		descriptor_sets.fill(nullptr);
+	}
+}
+
+bool CommandReplay::is_redundant(const CommandHeader &header)
+{
+	if (!state_filter_enabled)
+	{
+		return false;
+	}
+
+	auto &last_packet = last_state_packets[static_cast<size_t>(header.type)];
+
+	// Packets are zero-initialized, so identical parameters give identical bytes
+	bool redundant = last_packet && last_packet->size == header.size && std::memcmp(last_packet, &header, header.size) == 0;
+
+	last_packet = &header;
+
+	removed_call_count += redundant;
+
+	return redundant;
+}
+
+bool CommandReplay::is_redundant(const PipelineBinding &binding)
+{
+	if (!state_filter_enabled)
+	{
+		return false;
+	}
+
+	auto &bound_pipeline = bound_pipelines[binding.pipeline_bind_point];
+
+	bool redundant = bound_pipeline == binding.pipeline->get_handle();
+
+	bound_pipeline = binding.pipeline->get_handle();
+
+	removed_call_count += redundant;
+
+	return redundant;
+}
+
+bool CommandReplay::is_redundant(const DescriptorSetBinding &binding)
+{
+	if (!state_filter_enabled)
+	{
+		return false;
+	}
+
+	auto &descriptor_sets = bound_descriptor_sets[binding.pipeline_bind_point];
+
+	// Binding with another layout may disturb the sets bound so far, assume it does
+	auto &bound_pipeline_layout = bound_pipeline_layouts[binding.pipeline_bind_point];
+
+	if (bound_pipeline_layout != binding.pipeline_layout.get_handle())
+	{
+		descriptor_sets.fill(nullptr);
+
+		bound_pipeline_layout = binding.pipeline_layout.get_handle();
+	}
+
+	if (binding.set_index >= MAX_FILTERED_SETS)
+	{
+		return false;
+	}
+
+	auto &bound_binding = descriptor_sets[binding.set_index];
+
+	bool redundant = bound_binding &&
+	                 bound_binding->descriptor_set.get_handle() == binding.descriptor_set.get_handle() &&
+	                 bound_binding->dynamic_offsets == binding.dynamic_offsets;
+
+	bound_binding = &binding;
+
+	removed_call_count += redundant;
+
+	return redundant;
+}
 
-	// Read command parameters
-	read(stream, begin_info.flags);
+void CommandReplay::begin(CommandBuffer &command_buffer, const BeginCommand &command)
+{
+	VkCommandBufferBeginInfo begin_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+	begin_info.flags = command.flags;
 
 	// Call Vulkan function
 	vkBeginCommandBuffer(command_buffer.get_handle(), &begin_info);
 }
 
-void CommandReplay::end(CommandBuffer &command_buffer, std::istringstream & /*stream*/)
+void CommandReplay::end(CommandBuffer &command_buffer)
 {
 	// Call Vulkan function
 	vkEndCommandBuffer(command_buffer.get_handle());
 }
 
-void CommandReplay::next_subpass(CommandBuffer &command_buffer, std::istringstream & /*stream*/)
+void CommandReplay::next_subpass(CommandBuffer &command_buffer)
 {
+	auto &subpass = current_render_pass_binding->subpasses.at(++current_subpass_index);
+
 	// Call Vulkan function
-	vkCmdNextSubpass(command_buffer.get_handle(), VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdNextSubpass(command_buffer.get_handle(), subpass.contents);
 }
 
-void CommandReplay::end_render_pass(CommandBuffer &command_buffer, std::istringstream & /*stream*/)
+void CommandReplay::end_render_pass(CommandBuffer &command_buffer)
 {
 	// Call Vulkan function
 	vkCmdEndRenderPass(command_buffer.get_handle());
 }
 
-void CommandReplay::execute_commands(CommandBuffer &command_buffer, std::istringstream &stream)
+void CommandReplay::execute_commands(CommandBuffer &command_buffer, const ExecuteCommandsCommand &command)
 {
-	int render_pass_binding_index;
-	read(stream, render_pass_binding_index);
+	auto command_buffers = CommandArena::get_trailing<CommandBuffer *>(command);
 
-	std::vector<CommandBuffer *> command_buffers;
-	read(stream, command_buffers);
+	auto &render_pass_binding = command_buffer.get_recorder().get_render_pass_bindings()[command.render_pass_binding_index];
 
-	auto render_pass_binding = command_buffer.get_recorder().get_render_pass_bindings()[render_pass_binding_index];
-
-	for (auto &cmd_buf : command_buffers)
-	{
+	auto play_secondary = [&render_pass_binding](CommandBuffer &cmd_buf) {
 		VkCommandBufferBeginInfo begin_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
-		begin_info.flags = cmd_buf->get_usage_flags();
+		begin_info.flags = cmd_buf.get_usage_flags();
 
 		VkCommandBufferInheritanceInfo inheritance = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
 		begin_info.pInheritanceInfo                = &inheritance;
@@ -214,259 +424,288 @@ void CommandReplay::execute_commands(CommandBuffer &command_buffer, std::istring
 		inheritance.framebuffer                    = render_pass_binding.framebuffer->get_handle();
 		inheritance.subpass                        = to_u32(render_pass_binding.subpasses.size()) - 1;
 
-		vkBeginCommandBuffer(cmd_buf->get_handle(), &begin_info);
+		vkBeginCommandBuffer(cmd_buf.get_handle(), &begin_info);
+
+		auto frozen_commands = cmd_buf.get_frozen_commands();
+
+		cmd_buf.get_replayer().play(cmd_buf, frozen_commands ? frozen_commands->get_record() : cmd_buf.get_recorder());
+	};
+
+	// Command buffers allocated from the same pool must not be recorded at the same time,
+	// so each group of them is replayed by a single task
+	std::vector<std::vector<CommandBuffer *>> pool_groups;
+
+	auto thread_pool = command_buffer.get_device().get_replay_thread_pool();
+
+	if (thread_pool)
+	{
+		std::unordered_map<const CommandPool *, size_t> pool_group_indices;
+
+		for (uint32_t i = 0; i < command.command_buffer_count; ++i)
+		{
+			auto res_ins_it = pool_group_indices.emplace(&command_buffers[i]->get_command_pool(), pool_groups.size());
+
+			if (res_ins_it.second)
+			{
+				pool_groups.emplace_back();
+			}
+
+			pool_groups[res_ins_it.first->second].push_back(command_buffers[i]);
+		}
+	}
+
+	if (pool_groups.size() > 1)
+	{
+		std::vector<std::future<void>> futures;
+
+		for (size_t i = 1; i < pool_groups.size(); ++i)
+		{
+			futures.push_back(thread_pool->push([&play_secondary, &pool_group = pool_groups[i]](size_t) {
+				for (auto cmd_buf : pool_group)
+				{
+					play_secondary(*cmd_buf);
+				}
+			}));
+		}
+
+		std::exception_ptr exception;
+
+		// The calling thread replays the first group while waiting for the workers
+		try
+		{
+			for (auto cmd_buf : pool_groups[0])
+			{
+				play_secondary(*cmd_buf);
+			}
+		}
+		catch (...)
+		{
+			exception = std::current_exception();
+		}
+
+		// The tasks refer to this stack frame, so all of them are joined before any exception is propagated
+		for (auto &future : futures)
+		{
+			try
+			{
+				future.get();
+			}
+			catch (...)
+			{
+				if (!exception)
+				{
+					exception = std::current_exception();
+				}
+			}
+		}
 
-		cmd_buf->get_replayer().play(*cmd_buf, cmd_buf->get_recorder());
+		if (exception)
+		{
+			std::rethrow_exception(exception);
+		}
 	}
+	else
+	{
+		for (uint32_t i = 0; i < command.command_buffer_count; ++i)
+		{
+			play_secondary(*command_buffers[i]);
+		}
+	}
+
+	// Counters of the secondary replayers are only read once all of them are done
+	for (uint32_t i = 0; i < command.command_buffer_count; ++i)
+	{
+		auto &replayer = command_buffers[i]->get_replayer();
 
-	std::vector<VkCommandBuffer> sec_cmd_buffers(command_buffers.size(), VK_NULL_HANDLE);
-	std::transform(command_buffers.begin(), command_buffers.end(), sec_cmd_buffers.begin(), [](const vkb::CommandBuffer *sec_cmd_buf) { return sec_cmd_buf->get_handle(); });
+		removed_call_count += replayer.get_removed_call_count();
+		pipeline_bind_count += replayer.get_pipeline_bind_count();
+		descriptor_set_switch_count += replayer.get_descriptor_set_switch_count();
+	}
+
+	std::vector<VkCommandBuffer> sec_cmd_buffers(command.command_buffer_count, VK_NULL_HANDLE);
+	std::transform(command_buffers, command_buffers + command.command_buffer_count, sec_cmd_buffers.begin(), [](const vkb::CommandBuffer *sec_cmd_buf) { return sec_cmd_buf->get_handle(); });
 	vkCmdExecuteCommands(command_buffer.get_handle(), to_u32(sec_cmd_buffers.size()), sec_cmd_buffers.data());
+
+	// The state of the primary command buffer is undefined after executing secondary ones
+	reset_state_filter();
 }
 
-void CommandReplay::push_constants(CommandBuffer &command_buffer, std::istringstream &stream)
+void CommandReplay::push_constants(CommandBuffer &command_buffer, const PushConstantsCommand &command)
 {
-	VkPipelineLayout     pipeline_layout;
-	VkShaderStageFlags   shader_stage;
-	uint32_t             offset;
-	std::vector<uint8_t> values;
-
-	// Read command parameters
-	read(stream, pipeline_layout, shader_stage, offset, values);
-
 	// Call Vulkan function
-	vkCmdPushConstants(command_buffer.get_handle(), pipeline_layout, shader_stage, offset, to_u32(values.size()), values.data());
+	vkCmdPushConstants(command_buffer.get_handle(), command.pipeline_layout, command.shader_stage, command.offset, command.size, CommandArena::get_trailing<uint8_t>(command));
 }
 
-void CommandReplay::bind_vertex_buffers(CommandBuffer &command_buffer, std::istringstream &stream)
+void CommandReplay::bind_vertex_buffers(CommandBuffer &command_buffer, const BindVertexBuffersCommand &command)
 {
-	uint32_t                  first_binding;
-	std::vector<VkBuffer>     buffers;
-	std::vector<VkDeviceSize> offsets;
+	if (is_redundant(command.header))
+	{
+		return;
+	}
 
-	// Read command parameters
-	read(stream, first_binding, buffers, offsets);
+	auto buffers = CommandArena::get_trailing<VkBuffer>(command);
+	auto offsets = reinterpret_cast<const VkDeviceSize *>(buffers + command.binding_count);
 
 	// Call Vulkan function
-	vkCmdBindVertexBuffers(command_buffer.get_handle(), first_binding, to_u32(buffers.size()), buffers.data(), offsets.data());
+	vkCmdBindVertexBuffers(command_buffer.get_handle(), command.first_binding, command.binding_count, buffers, offsets);
 }
 
-void CommandReplay::bind_index_buffer(CommandBuffer &command_buffer, std::istringstream &stream)
+void CommandReplay::bind_index_buffer(CommandBuffer &command_buffer, const BindIndexBufferCommand &command)
 {
-	VkBuffer     buffer;
-	VkDeviceSize offset;
-	VkIndexType  index_type;
-
-	// Read command parameters
-	read(stream, buffer, offset, index_type);
+	if (is_redundant(command.header))
+	{
+		return;
+	}
 
 	// Call Vulkan function
-	vkCmdBindIndexBuffer(command_buffer.get_handle(), buffer, offset, index_type);
+	vkCmdBindIndexBuffer(command_buffer.get_handle(), command.buffer, command.offset, command.index_type);
 }
 
-void CommandReplay::set_viewport(CommandBuffer &command_buffer, std::istringstream &stream)
+void CommandReplay::set_viewport(CommandBuffer &command_buffer, const SetViewportCommand &command)
 {
-	uint32_t                first_viewport;
-	std::vector<VkViewport> viewports;
-
-	// Read command parameters
-	read(stream, first_viewport, viewports);
+	if (is_redundant(command.header))
+	{
+		return;
+	}
 
 	// Call Vulkan function
-	vkCmdSetViewport(command_buffer.get_handle(), first_viewport, to_u32(viewports.size()), viewports.data());
+	vkCmdSetViewport(command_buffer.get_handle(), command.first_viewport, command.viewport_count, CommandArena::get_trailing<VkViewport>(command));
 }
 
-void CommandReplay::set_scissor(CommandBuffer &command_buffer, std::istringstream &stream)
+void CommandReplay::set_scissor(CommandBuffer &command_buffer, const SetScissorCommand &command)
 {
-	uint32_t              first_scissor;
-	std::vector<VkRect2D> scissors;
-
-	// Read command parameters
-	read(stream, first_scissor, scissors);
+	if (is_redundant(command.header))
+	{
+		return;
+	}
 
 	// Call Vulkan function
-	vkCmdSetScissor(command_buffer.get_handle(), first_scissor, to_u32(scissors.size()), scissors.data());
+	vkCmdSetScissor(command_buffer.get_handle(), command.first_scissor, command.scissor_count, CommandArena::get_trailing<VkRect2D>(command));
 }
 
-void CommandReplay::set_line_width(CommandBuffer &command_buffer, std::istringstream &stream)
+void CommandReplay::set_line_width(CommandBuffer &command_buffer, const SetLineWidthCommand &command)
 {
-	float line_width;
-
-	// Read command parameters
-	read(stream, line_width);
+	if (is_redundant(command.header))
+	{
+		return;
+	}
 
 	// Call Vulkan function
-	vkCmdSetLineWidth(command_buffer.get_handle(), line_width);
+	vkCmdSetLineWidth(command_buffer.get_handle(), command.line_width);
 }
 
-void CommandReplay::set_depth_bias(CommandBuffer &command_buffer, std::istringstream &stream)
+void CommandReplay::set_depth_bias(CommandBuffer &command_buffer, const SetDepthBiasCommand &command)
 {
-	float depth_bias_constant_factor, depth_bias_clamp, depth_bias_slope_factor;
-
-	// Read command parameters
-	read(stream, depth_bias_constant_factor, depth_bias_clamp, depth_bias_slope_factor);
+	if (is_redundant(command.header))
+	{
+		return;
+	}
 
 	// Call Vulkan function
-	vkCmdSetDepthBias(command_buffer.get_handle(), depth_bias_constant_factor, depth_bias_clamp, depth_bias_slope_factor);
+	vkCmdSetDepthBias(command_buffer.get_handle(), command.depth_bias_constant_factor, command.depth_bias_clamp, command.depth_bias_slope_factor);
 }
 
-void CommandReplay::set_blend_constants(CommandBuffer &command_buffer, std::istringstream &stream)
+void CommandReplay::set_blend_constants(CommandBuffer &command_buffer, const SetBlendConstantsCommand &command)
 {
-	std::array<float, 4> blend_constants;
-
-	// Read command parameters
-	read(stream, blend_constants);
+	if (is_redundant(command.header))
+	{
+		return;
+	}
 
 	// Call Vulkan function
-	vkCmdSetBlendConstants(command_buffer.get_handle(), blend_constants.data());
+	vkCmdSetBlendConstants(command_buffer.get_handle(), command.blend_constants);
 }
 
-void CommandReplay::set_depth_bounds(CommandBuffer &command_buffer, std::istringstream &stream)
+void CommandReplay::set_depth_bounds(CommandBuffer &command_buffer, const SetDepthBoundsCommand &command)
 {
-	float min_depth_bounds, max_depth_bounds;
-
-	// Read command parameters
-	read(stream, min_depth_bounds, max_depth_bounds);
+	if (is_redundant(command.header))
+	{
+		return;
+	}
 
 	// Call Vulkan function
-	vkCmdSetDepthBounds(command_buffer.get_handle(), min_depth_bounds, max_depth_bounds);
+	vkCmdSetDepthBounds(command_buffer.get_handle(), command.min_depth_bounds, command.max_depth_bounds);
 }
 
-void CommandReplay::draw(CommandBuffer &command_buffer, std::istringstream &stream)
+void CommandReplay::draw(CommandBuffer &command_buffer, const DrawCommand &command)
 {
-	uint32_t vertex_count;
-	uint32_t instance_count;
-	uint32_t first_vertex;
-	uint32_t first_instance;
-
-	// Read command parameters
-	read(stream, vertex_count, instance_count, first_vertex, first_instance);
+	if (skip_draws)
+	{
+		return;
+	}
 
 	// Call Vulkan function
-	vkCmdDraw(command_buffer.get_handle(), vertex_count, instance_count, first_vertex, first_instance);
+	vkCmdDraw(command_buffer.get_handle(), command.vertex_count, command.instance_count, command.first_vertex, command.first_instance);
 }
 
-void CommandReplay::draw_indexed(CommandBuffer &command_buffer, std::istringstream &stream)
+void CommandReplay::draw_indexed(CommandBuffer &command_buffer, const DrawIndexedCommand &command)
 {
-	uint32_t index_count;
-	uint32_t instance_count;
-	uint32_t first_index;
-	uint32_t vertex_offset;
-	uint32_t first_instance;
-
-	// Read command parameters
-	read(stream, index_count, instance_count, first_index, vertex_offset, first_instance);
+	if (skip_draws)
+	{
+		return;
+	}
 
 	// Call Vulkan function
-	vkCmdDrawIndexed(command_buffer.get_handle(), index_count, instance_count, first_index, vertex_offset, first_instance);
+	vkCmdDrawIndexed(command_buffer.get_handle(), command.index_count, command.instance_count, command.first_index, command.vertex_offset, command.first_instance);
 }
 
-void CommandReplay::draw_indexed_indirect(CommandBuffer &command_buffer, std::istringstream &stream)
+void CommandReplay::draw_indexed_indirect(CommandBuffer &command_buffer, const DrawIndexedIndirectCommand &command)
 {
-	VkBuffer     buffer;
-	VkDeviceSize offset;
-	uint32_t     draw_count;
-	uint32_t     stride;
-
-	// Read command parameters
-	read(stream, buffer, offset, draw_count, stride);
+	if (skip_draws)
+	{
+		return;
+	}
 
 	// Call Vulkan function
-	vkCmdDrawIndexedIndirect(command_buffer.get_handle(), buffer, offset, draw_count, stride);
+	vkCmdDrawIndexedIndirect(command_buffer.get_handle(), command.buffer, command.offset, command.draw_count, command.stride);
 }
 
-void CommandReplay::dispatch(CommandBuffer &command_buffer, std::istringstream &stream)
+void CommandReplay::dispatch(CommandBuffer &command_buffer, const DispatchCommand &command)
 {
-	uint32_t group_count_x;
-	uint32_t group_count_y;
-	uint32_t group_count_z;
-
-	// Read command parameters
-	read(stream, group_count_x, group_count_y, group_count_z);
-
 	// Call Vulkan function
-	vkCmdDispatch(command_buffer.get_handle(), group_count_x, group_count_y, group_count_z);
+	vkCmdDispatch(command_buffer.get_handle(), command.group_count_x, command.group_count_y, command.group_count_z);
 }
 
-void CommandReplay::dispatch_indirect(CommandBuffer &command_buffer, std::istringstream &stream)
+void CommandReplay::dispatch_indirect(CommandBuffer &command_buffer, const DispatchIndirectCommand &command)
 {
-	VkBuffer     buffer;
-	VkDeviceSize offset;
-
-	// Read command parameters
-	read(stream, buffer, offset);
-
 	// Call Vulkan function
-	vkCmdDispatchIndirect(command_buffer.get_handle(), buffer, offset);
+	vkCmdDispatchIndirect(command_buffer.get_handle(), command.buffer, command.offset);
 }
 
-void CommandReplay::update_buffer(CommandBuffer &command_buffer, std::istringstream &stream)
+void CommandReplay::update_buffer(CommandBuffer &command_buffer, const UpdateBufferCommand &command)
 {
-	VkBuffer             buffer;
-	VkDeviceSize         offset;
-	std::vector<uint8_t> data;
-
-	// Read command parameters
-	read(stream, buffer, offset, data);
-
 	// Call Vulkan function
-	vkCmdUpdateBuffer(command_buffer.get_handle(), buffer, offset, data.size(), data.data());
+	vkCmdUpdateBuffer(command_buffer.get_handle(), command.buffer, command.offset, command.size, CommandArena::get_trailing<uint8_t>(command));
 }
 
-void CommandReplay::blit_image(CommandBuffer &command_buffer, std::istringstream &stream)
+void CommandReplay::blit_image(CommandBuffer &command_buffer, const BlitImageCommand &command)
 {
-	VkImage                  src_image;
-	VkImage                  dst_image;
-	std::vector<VkImageBlit> regions;
-
-	// Read command parameters
-	read(stream, src_image, dst_image, regions);
-
 	// Call Vulkan function
-	vkCmdBlitImage(command_buffer.get_handle(), src_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dst_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, to_u32(regions.size()), regions.data(), VK_FILTER_NEAREST);
+	vkCmdBlitImage(command_buffer.get_handle(), command.src_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, command.dst_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, command.region_count, CommandArena::get_trailing<VkImageBlit>(command), VK_FILTER_NEAREST);
 }
 
-void CommandReplay::copy_image(CommandBuffer &command_buffer, std::istringstream &stream)
+void CommandReplay::copy_image(CommandBuffer &command_buffer, const CopyImageCommand &command)
 {
-	VkImage                  src_image;
-	VkImage                  dst_image;
-	std::vector<VkImageCopy> regions;
-
-	// Read command parameters
-	read(stream, src_image, dst_image, regions);
-
 	// Call Vulkan function
-	vkCmdCopyImage(command_buffer.get_handle(), src_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dst_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, to_u32(regions.size()), regions.data());
+	vkCmdCopyImage(command_buffer.get_handle(), command.src_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, command.dst_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, command.region_count, CommandArena::get_trailing<VkImageCopy>(command));
 }
 
-void CommandReplay::copy_buffer_to_image(CommandBuffer &command_buffer, std::istringstream &stream)
+void CommandReplay::copy_buffer_to_image(CommandBuffer &command_buffer, const CopyBufferToImageCommand &command)
 {
-	VkBuffer                       buffer;
-	VkImage                        image;
-	std::vector<VkBufferImageCopy> regions;
-
-	// Read command parameters
-	read(stream, buffer, image, regions);
-
 	// Call Vulkan function
-	vkCmdCopyBufferToImage(command_buffer.get_handle(), buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, to_u32(regions.size()), regions.data());
+	vkCmdCopyBufferToImage(command_buffer.get_handle(), command.buffer, command.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, command.region_count, CommandArena::get_trailing<VkBufferImageCopy>(command));
 }
 
-void CommandReplay::image_memory_barrier(CommandBuffer &command_buffer, std::istringstream &stream)
+void CommandReplay::image_memory_barrier(CommandBuffer &command_buffer, const ImageMemoryBarrierCommand &command)
 {
-	VkImage                 image;
-	VkImageSubresourceRange subresource_range;
-	ImageMemoryBarrier      memory_barrier;
-
-	// Read command parameters
-	read(stream, image, subresource_range, memory_barrier);
+	auto &memory_barrier = command.memory_barrier;
 
 	VkImageMemoryBarrier image_memory_barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
 
 	image_memory_barrier.oldLayout        = memory_barrier.old_layout;
 	image_memory_barrier.newLayout        = memory_barrier.new_layout;
-	image_memory_barrier.image            = image;
-	image_memory_barrier.subresourceRange = subresource_range;
+	image_memory_barrier.image            = command.image;
+	image_memory_barrier.subresourceRange = command.subresource_range;
 	image_memory_barrier.srcAccessMask    = memory_barrier.src_access_mask;
 	image_memory_barrier.dstAccessMask    = memory_barrier.dst_access_mask;
 
@@ -485,22 +724,16 @@ void CommandReplay::image_memory_barrier(CommandBuffer &command_buffer, std::ist
 	    &image_memory_barrier);
 }
 
-void CommandReplay::buffer_memory_barrier(CommandBuffer &command_buffer, std::istringstream &stream)
+void CommandReplay::buffer_memory_barrier(CommandBuffer &command_buffer, const BufferMemoryBarrierCommand &command)
 {
-	VkBuffer            buffer;
-	VkDeviceSize        offset;
-	VkDeviceSize        size;
-	BufferMemoryBarrier memory_barrier;
-
-	// Read command parameters
-	read(stream, buffer, offset, size, memory_barrier);
+	auto &memory_barrier = command.memory_barrier;
 
 	VkBufferMemoryBarrier buffer_memory_barrier{VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
 	buffer_memory_barrier.srcAccessMask = memory_barrier.src_access_mask;
 	buffer_memory_barrier.dstAccessMask = memory_barrier.dst_access_mask;
-	buffer_memory_barrier.buffer        = buffer;
-	buffer_memory_barrier.offset        = offset;
-	buffer_memory_barrier.size          = size;
+	buffer_memory_barrier.buffer        = command.buffer;
+	buffer_memory_barrier.offset        = command.offset;
+	buffer_memory_barrier.size          = command.size;
 
 	VkPipelineStageFlags src_stage_mask = memory_barrier.src_stage_mask;
 	VkPipelineStageFlags dst_stage_mask = memory_barrier.dst_stage_mask;
@@ -27,73 +27,137 @@ namespace vkb
 class CommandBuffer;
 
 /*
- * @brief Reads Vulkan commands from a memory stream and runs them in a Vulkan command buffer.
+ * @brief Reads Vulkan command packets from a CommandRecord arena and runs them in a Vulkan command buffer.
  */
 class CommandReplay
 {
   public:
-	CommandReplay();
-
 	/*
 	 * @brief Reads Vulkan commands from a CommandRecord object and calls the 
 	 *        corresponding Vulkan function to record the command in a Vulkan command buffer object.
 	 */
 	void play(CommandBuffer &command_buffer, CommandRecord &recorder);
 
-  protected:
-	using CommandFunc = std::function<void(CommandBuffer &, std::istringstream &)>;
+	/**
+	 * @return Number of Vulkan calls dropped by the state filter during the last play,
+	 *         including the ones of the secondary command buffers it executed
+	 */
+	size_t get_removed_call_count() const;
+
+	/**
+	 * @return Number of pipelines bound during the last play, including the secondary command buffers it executed
+	 */
+	size_t get_pipeline_bind_count() const;
+
+	/**
+	 * @return Number of descriptor set binds during the last play which bound another set than the one
+	 *         bound to the same index before, including the secondary command buffers it executed
+	 */
+	size_t get_descriptor_set_switch_count() const;
 
-	std::unordered_map<CommandType, CommandFunc> stream_commands;
+  protected:
+	/// Set while the bound graphics pipeline is not compiled yet
+	bool skip_draws{false};
 
   private:
-	void begin(CommandBuffer &command_buffer, std::istringstream &stream);
+	/// Number of descriptor sets for each bind point tracked by the state filter
+	static constexpr uint32_t MAX_FILTERED_SETS = 8;
+
+	/// Number of command types, used to track the last packet of each type
+	static constexpr size_t COMMAND_TYPE_COUNT = static_cast<size_t>(CommandType::BufferMemoryBarrier) + 1;
+
+	/// Set when the device enables the filter, see Device::set_state_filter_enabled
+	bool state_filter_enabled{false};
+
+	size_t removed_call_count{0};
+
+	size_t pipeline_bind_count{0};
+
+	size_t descriptor_set_switch_count{0};
+
+	/// Descriptor set last bound to each set index of each bind point, to count the switches
+	std::array<std::array<VkDescriptorSet, MAX_FILTERED_SETS>, 2> last_descriptor_sets{};
+
+	/// Render pass being replayed, which describes the contents of its subpasses
+	const RenderPassBinding *current_render_pass_binding{nullptr};
+
+	uint32_t current_subpass_index{0};
+
+	/// Last packet of each dynamic state and buffer binding command, a packet identical to it sets the same state again
+	std::array<const CommandHeader *, COMMAND_TYPE_COUNT> last_state_packets{};
+
+	/// Pipeline bound to the graphics and compute bind points
+	std::array<VkPipeline, 2> bound_pipelines{};
+
+	/// Layout used to bind the descriptor sets of each bind point
+	std::array<VkPipelineLayout, 2> bound_pipeline_layouts{};
+
+	/// Descriptor set bindings in effect for each bind point
+	std::array<std::array<const DescriptorSetBinding *, MAX_FILTERED_SETS>, 2> bound_descriptor_sets{};
+
+	/**
+	 * @brief Forgets the state tracked by the filter and the state counters,
+	 *        when the Vulkan command buffer state becomes undefined
+	 */
+	void reset_state_filter();
+
+	/**
+	 * @brief Checks if a dynamic state or buffer binding packet is identical to the last one of its type
+	 */
+	bool is_redundant(const CommandHeader &header);
+
+	bool is_redundant(const PipelineBinding &binding);
+
+	bool is_redundant(const DescriptorSetBinding &binding);
+
+	void begin(CommandBuffer &command_buffer, const BeginCommand &command);
 
-	void end(CommandBuffer &command_buffer, std::istringstream &stream);
+	void end(CommandBuffer &command_buffer);
 
-	void next_subpass(CommandBuffer &command_buffer, std::istringstream &stream);
+	void next_subpass(CommandBuffer &command_buffer);
 
-	void end_render_pass(CommandBuffer &command_buffer, std::istringstream &stream);
+	void end_render_pass(CommandBuffer &command_buffer);
 
-	void execute_commands(CommandBuffer &command_buffer, std::istringstream &stream);
+	void execute_commands(CommandBuffer &command_buffer, const ExecuteCommandsCommand &command);
 
-	void push_constants(CommandBuffer &command_buffer, std::istringstream &stream);
+	void push_constants(CommandBuffer &command_buffer, const PushConstantsCommand &command);
 
-	void bind_vertex_buffers(CommandBuffer &command_buffer, std::istringstream &stream);
+	void bind_vertex_buffers(CommandBuffer &command_buffer, const BindVertexBuffersCommand &command);
 
-	void bind_index_buffer(CommandBuffer &command_buffer, std::istringstream &stream);
+	void bind_index_buffer(CommandBuffer &command_buffer, const BindIndexBufferCommand &command);
 
-	void set_viewport(CommandBuffer &command_buffer, std::istringstream &stream);
+	void set_viewport(CommandBuffer &command_buffer, const SetViewportCommand &command);
 
-	void set_scissor(CommandBuffer &command_buffer, std::istringstream &stream);
+	void set_scissor(CommandBuffer &command_buffer, const SetScissorCommand &command);
 
-	void set_line_width(CommandBuffer &command_buffer, std::istringstream &stream);
+	void set_line_width(CommandBuffer &command_buffer, const SetLineWidthCommand &command);
 
-	void set_depth_bias(CommandBuffer &command_buffer, std::istringstream &stream);
+	void set_depth_bias(CommandBuffer &command_buffer, const SetDepthBiasCommand &command);
 
-	void set_blend_constants(CommandBuffer &command_buffer, std::istringstream &stream);
+	void set_blend_constants(CommandBuffer &command_buffer, const SetBlendConstantsCommand &command);
 
-	void set_depth_bounds(CommandBuffer &command_buffer, std::istringstream &stream);
+	void set_depth_bounds(CommandBuffer &command_buffer, const SetDepthBoundsCommand &command);
 
-	void draw(CommandBuffer &command_buffer, std::istringstream &stream);
+	void draw(CommandBuffer &command_buffer, const DrawCommand &command);
 
-	void draw_indexed(CommandBuffer &command_buffer, std::istringstream &stream);
+	void draw_indexed(CommandBuffer &command_buffer, const DrawIndexedCommand &command);
 
-	void draw_indexed_indirect(CommandBuffer &command_buffer, std::istringstream &stream);
+	void draw_indexed_indirect(CommandBuffer &command_buffer, const DrawIndexedIndirectCommand &command);
 
-	void dispatch(CommandBuffer &command_buffer, std::istringstream &stream);
+	void dispatch(CommandBuffer &command_buffer, const DispatchCommand &command);
 
-	void dispatch_indirect(CommandBuffer &command_buffer, std::istringstream &stream);
+	void dispatch_indirect(CommandBuffer &command_buffer, const DispatchIndirectCommand &command);
 
-	void update_buffer(CommandBuffer &command_buffer, std::istringstream &stream);
+	void update_buffer(CommandBuffer &command_buffer, const UpdateBufferCommand &command);
 
-	void blit_image(CommandBuffer &command_buffer, std::istringstream &stream);
+	void blit_image(CommandBuffer &command_buffer, const BlitImageCommand &command);
 
-	void copy_image(CommandBuffer &command_buffer, std::istringstream &stream);
+	void copy_image(CommandBuffer &command_buffer, const CopyImageCommand &command);
 
-	void copy_buffer_to_image(CommandBuffer &command_buffer, std::istringstream &stream);
+	void copy_buffer_to_image(CommandBuffer &command_buffer, const CopyBufferToImageCommand &command);
 
-	void image_memory_barrier(CommandBuffer &command_buffer, std::istringstream &stream);
+	void image_memory_barrier(CommandBuffer &command_buffer, const ImageMemoryBarrierCommand &command);
 
-	void buffer_memory_barrier(CommandBuffer &command_buffer, std::istringstream &stream);
+	void buffer_memory_barrier(CommandBuffer &command_buffer, const BufferMemoryBarrierCommand &command);
 };
 }        // namespace vkb
@@ -22,8 +22,10 @@
 
 #include <algorithm>
 #include <array>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <functional>
 #include <iterator>
@@ -53,12 +55,12 @@ VKBP_ENABLE_WARNINGS()
 namespace vkb
 {
 template <typename T>
-inline void read(std::istringstream &is, T &value)
+inline void read(std::istream &is, T &value)
 {
 	is.read(reinterpret_cast<char *>(&value), sizeof(T));
 }
 
-inline void read(std::istringstream &is, std::string &value)
+inline void read(std::istream &is, std::string &value)
 {
 	std::size_t size;
 	read(is, size);
@@ -67,7 +69,7 @@ inline void read(std::istringstream &is, std::string &value)
 }
 
 template <class T>
-inline void read(std::istringstream &is, std::set<T> &value)
+inline void read(std::istream &is, std::set<T> &value)
 {
 	std::size_t size;
 	read(is, size);
@@ -80,7 +82,7 @@ inline void read(std::istringstream &is, std::set<T> &value)
 }
 
 template <class T>
-inline void read(std::istringstream &is, std::vector<T> &value)
+inline void read(std::istream &is, std::vector<T> &value)
 {
 	std::size_t size;
 	read(is, size);
@@ -89,7 +91,7 @@ inline void read(std::istringstream &is, std::vector<T> &value)
 }
 
 template <class T, class S>
-inline void read(std::istringstream &is, std::map<T, S> &value)
+inline void read(std::istream &is, std::map<T, S> &value)
 {
 	std::size_t size;
 	read(is, size);
@@ -105,13 +107,13 @@ inline void read(std::istringstream &is, std::map<T, S> &value)
 }
 
 template <class T, uint32_t N>
-inline void read(std::istringstream &is, std::array<T, N> &value)
+inline void read(std::istream &is, std::array<T, N> &value)
 {
 	is.read(reinterpret_cast<char *>(value.data()), N * sizeof(T));
 }
 
 template <typename T, typename... Args>
-inline void read(std::istringstream &is, T &first_arg, Args &... args)
+inline void read(std::istream &is, T &first_arg, Args &... args)
 {
 	read(is, first_arg);
 
@@ -119,19 +121,19 @@ inline void read(std::istringstream &is, T &first_arg, Args &... args)
 }
 
 template <typename T>
-inline void write(std::ostringstream &os, const T &value)
+inline void write(std::ostream &os, const T &value)
 {
 	os.write(reinterpret_cast<const char *>(&value), sizeof(T));
 }
 
-inline void write(std::ostringstream &os, const std::string &value)
+inline void write(std::ostream &os, const std::string &value)
 {
 	write(os, value.size());
 	os.write(value.data(), value.size());
 }
 
 template <class T>
-inline void write(std::ostringstream &os, const std::set<T> &value)
+inline void write(std::ostream &os, const std::set<T> &value)
 {
 	write(os, value.size());
 	for (const T &item : value)
@@ -141,14 +143,14 @@ inline void write(std::ostringstream &os, const std::set<T> &value)
 }
 
 template <class T>
-inline void write(std::ostringstream &os, const std::vector<T> &value)
+inline void write(std::ostream &os, const std::vector<T> &value)
 {
 	write(os, value.size());
 	os.write(reinterpret_cast<const char *>(value.data()), value.size() * sizeof(T));
 }
 
 template <class T, class S>
-inline void write(std::ostringstream &os, const std::map<T, S> &value)
+inline void write(std::ostream &os, const std::map<T, S> &value)
 {
 	write(os, value.size());
 
@@ -160,19 +162,65 @@ inline void write(std::ostringstream &os, const std::map<T, S> &value)
 }
 
 template <class T, uint32_t N>
-inline void write(std::ostringstream &os, const std::array<T, N> &value)
+inline void write(std::ostream &os, const std::array<T, N> &value)
 {
 	os.write(reinterpret_cast<const char *>(value.data()), N * sizeof(T));
 }
 
 template <typename T, typename... Args>
-inline void write(std::ostringstream &os, const T &first_arg, const Args &... args)
+inline void write(std::ostream &os, const T &first_arg, const Args &... args)
 {
 	write(os, first_arg);
 
 	write(os, args...);
 }
 
+/**
+ * @brief Read-only stream buffer over memory owned by the caller, e.g. a mapped file,
+ *        so that it can be read with the helpers above without copying it
+ */
+class MemoryStreamBuffer : public std::streambuf
+{
+  public:
+	MemoryStreamBuffer(const uint8_t *data, size_t size)
+	{
+		auto begin = reinterpret_cast<char *>(const_cast<uint8_t *>(data));
+		setg(begin, begin, begin + size);
+	}
+};
+
+/**
+ * @brief Stream buffer appending to a byte vector, so that written data can be used without copying it
+ */
+class VectorStreamBuffer : public std::streambuf
+{
+  public:
+	VectorStreamBuffer(std::vector<uint8_t> &data) :
+	    data{data}
+	{}
+
+  protected:
+	int_type overflow(int_type c) override
+	{
+		if (!traits_type::eq_int_type(c, traits_type::eof()))
+		{
+			data.push_back(static_cast<uint8_t>(c));
+		}
+
+		return traits_type::not_eof(c);
+	}
+
+	std::streamsize xsputn(const char *s, std::streamsize count) override
+	{
+		data.insert(data.end(), reinterpret_cast<const uint8_t *>(s), reinterpret_cast<const uint8_t *>(s) + count);
+
+		return count;
+	}
+
+  private:
+	std::vector<uint8_t> &data;
+};
+
 /**
  * @brief Helper function to combine a given hash
  *        with a generated hash for the input param.
@@ -184,6 +232,124 @@ inline void hash_combine(size_t &seed, const T &v)
 	glm::detail::hash_combine(seed, hasher(v));
 }
 
+namespace detail
+{
+constexpr uint64_t HASH_PRIME_1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t HASH_PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t HASH_PRIME_3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t HASH_PRIME_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t HASH_PRIME_5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t hash_rotl(uint64_t value, uint32_t bits)
+{
+	return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t hash_read_u64(const uint8_t *data)
+{
+	uint64_t value;
+	std::memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+inline uint32_t hash_read_u32(const uint8_t *data)
+{
+	uint32_t value;
+	std::memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+inline uint64_t hash_round(uint64_t acc, uint64_t input)
+{
+	acc += input * HASH_PRIME_2;
+	acc = hash_rotl(acc, 31);
+	return acc * HASH_PRIME_1;
+}
+
+inline uint64_t hash_merge_round(uint64_t acc, uint64_t value)
+{
+	acc ^= hash_round(0, value);
+	return acc * HASH_PRIME_1 + HASH_PRIME_4;
+}
+}        // namespace detail
+
+/**
+ * @brief Computes a 64-bit hash of a block of memory, following the XXH64 algorithm.
+ *        It is much stronger than chaining hash_combine over each field of a structure,
+ *        and fast enough to hash packed keys on every lookup.
+ * @param data Pointer to the bytes to hash
+ * @param size Number of bytes to hash
+ * @param seed Optional seed of the hash
+ * @return The 64-bit hash of the data
+ */
+inline uint64_t hash_bytes(const uint8_t *data, size_t size, uint64_t seed = 0)
+{
+	using namespace detail;
+
+	const uint8_t *end = data + size;
+
+	uint64_t result;
+
+	if (size >= 32)
+	{
+		uint64_t v1 = seed + HASH_PRIME_1 + HASH_PRIME_2;
+		uint64_t v2 = seed + HASH_PRIME_2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - HASH_PRIME_1;
+
+		const uint8_t *limit = end - 32;
+
+		do
+		{
+			v1 = hash_round(v1, hash_read_u64(data));
+			v2 = hash_round(v2, hash_read_u64(data + 8));
+			v3 = hash_round(v3, hash_read_u64(data + 16));
+			v4 = hash_round(v4, hash_read_u64(data + 24));
+			data += 32;
+		} while (data <= limit);
+
+		result = hash_rotl(v1, 1) + hash_rotl(v2, 7) + hash_rotl(v3, 12) + hash_rotl(v4, 18);
+		result = hash_merge_round(result, v1);
+		result = hash_merge_round(result, v2);
+		result = hash_merge_round(result, v3);
+		result = hash_merge_round(result, v4);
+	}
+	else
+	{
+		result = seed + HASH_PRIME_5;
+	}
+
+	result += static_cast<uint64_t>(size);
+
+	for (; data + 8 <= end; data += 8)
+	{
+		result ^= hash_round(0, hash_read_u64(data));
+		result = hash_rotl(result, 27) * HASH_PRIME_1 + HASH_PRIME_4;
+	}
+
+	if (data + 4 <= end)
+	{
+		result ^= static_cast<uint64_t>(hash_read_u32(data)) * HASH_PRIME_1;
+		result = hash_rotl(result, 23) * HASH_PRIME_2 + HASH_PRIME_3;
+		data += 4;
+	}
+
+	for (; data < end; ++data)
+	{
+		result ^= static_cast<uint64_t>(*data) * HASH_PRIME_5;
+		result = hash_rotl(result, 11) * HASH_PRIME_1;
+	}
+
+	// Final avalanche
+	result ^= result >> 33;
+	result *= HASH_PRIME_2;
+	result ^= result >> 29;
+	result *= HASH_PRIME_3;
+	result ^= result >> 32;
+
+	return result;
+}
+
 /**
  * @brief Helper function to convert a data type
  *        to string using output stream operator.
@@ -61,7 +61,8 @@ CommandBuffer::CommandBuffer(CommandBuffer &&other) :
     handle{other.handle},
     recorder{std::move(other.recorder)},
     replayer{std::move(other.replayer)},
-    state{other.state}
+    state{other.state},
+    frozen_commands{other.frozen_commands}
 {
 	other.handle = VK_NULL_HANDLE;
 	other.state  = State::Invalid;
@@ -72,6 +73,24 @@ Device &CommandBuffer::get_device()
 	return command_pool.get_device();
 }
 
+CommandPool &CommandBuffer::get_command_pool()
+{
+	return command_pool;
+}
+
+void CommandBuffer::replay_frozen(FrozenCommands &frozen_commands)
+{
+	assert(level == VK_COMMAND_BUFFER_LEVEL_SECONDARY && "Only secondary command buffers can replay frozen commands");
+	assert(is_recording() && "Command buffer is not recording, please call begin before replaying frozen commands");
+
+	this->frozen_commands = &frozen_commands;
+}
+
+FrozenCommands *CommandBuffer::get_frozen_commands() const
+{
+	return frozen_commands;
+}
+
 CommandRecord &CommandBuffer::get_recorder()
 {
 	return recorder;
@@ -103,6 +122,8 @@ VkResult CommandBuffer::begin(VkCommandBufferUsageFlags flags, CommandBuffer *pr
 
 	recorder.reset();
 
+	frozen_commands = nullptr;
+
 	state = State::Recording;
 
 	usage_flags = flags;
@@ -117,7 +138,20 @@ VkResult CommandBuffer::begin(VkCommandBufferUsageFlags flags, CommandBuffer *pr
 		// to set up inheritance information is known
 		assert(primary_cmd_buf && "A primary command buffer pointer must be provided when calling begin from a secondary one");
 
-		recorder.get_render_pass_bindings().push_back(primary_cmd_buf->get_recorder().get_render_pass_bindings().back());
+		auto &render_pass_binding = recorder.get_render_pass_bindings().emplace_back(primary_cmd_buf->get_recorder().get_render_pass_bindings().back());
+
+		// Only the layout of the render pass is inherited, the pipeline states of the primary draws are interned by its own recorder
+		for (auto &subpass : render_pass_binding.subpasses)
+		{
+			subpass.pipeline_descs.clear();
+		}
+
+		render_pass_binding.pending_secondary_command_buffers.clear();
+
+		// Inherit the subpass index and the states set for the subpass, a pipeline is bound by the first draw
+		auto &pipeline_state = recorder.get_pipeline_state();
+		pipeline_state       = primary_cmd_buf->get_recorder().get_pipeline_state();
+		pipeline_state.set_dirty();
 	}
 
 	return VK_SUCCESS;
@@ -132,6 +166,13 @@ VkResult CommandBuffer::end()
 		return VK_NOT_READY;
 	}
 
+	// Only the frozen commands are replayed, the ones recorded before or after replay_frozen would be lost
+	if (frozen_commands && recorder.get_arena().get_size() != 0)
+	{
+		LOGE("Commands recorded into a command buffer replaying frozen commands are ignored");
+		assert(false && "No command must be recorded into a command buffer replaying frozen commands");
+	}
+
 	recorder.end();
 
 	if (level != VK_COMMAND_BUFFER_LEVEL_SECONDARY)
@@ -182,7 +223,12 @@ void CommandBuffer::set_specialization_constant(uint32_t constant_id, const std:
 
 void CommandBuffer::push_constants(uint32_t offset, const std::vector<uint8_t> &values)
 {
-	recorder.push_constants(offset, values);
+	recorder.push_constants(offset, values.data(), to_u32(values.size()));
+}
+
+void CommandBuffer::push_constants(uint32_t offset, const uint8_t *data, uint32_t size)
+{
+	recorder.push_constants(offset, data, size);
 }
 
 void CommandBuffer::bind_buffer(const core::Buffer &buffer, VkDeviceSize offset, VkDeviceSize range, uint32_t set, uint32_t binding, uint32_t array_element)
@@ -302,7 +348,12 @@ void CommandBuffer::dispatch_indirect(const core::Buffer &buffer, VkDeviceSize o
 
 void CommandBuffer::update_buffer(const core::Buffer &buffer, VkDeviceSize offset, const std::vector<uint8_t> &data)
 {
-	recorder.update_buffer(buffer, offset, data);
+	recorder.update_buffer(buffer, offset, data.data(), data.size());
+}
+
+void CommandBuffer::update_buffer(const core::Buffer &buffer, VkDeviceSize offset, const uint8_t *data, VkDeviceSize size)
+{
+	recorder.update_buffer(buffer, offset, data, size);
 }
 
 void CommandBuffer::blit_image(const core::Image &src_img, const core::Image &dst_img, const std::vector<VkImageBlit> &regions)
@@ -340,6 +391,11 @@ const VkCommandBufferUsageFlags CommandBuffer::get_usage_flags() const
 	return usage_flags;
 }
 
+const CommandBuffer::ResetMode CommandBuffer::get_reset_mode() const
+{
+	return command_pool.get_reset_mode();
+}
+
 VkResult CommandBuffer::reset(ResetMode reset_mode)
 {
 	VkResult result = VK_SUCCESS;
@@ -348,6 +404,8 @@ VkResult CommandBuffer::reset(ResetMode reset_mode)
 
 	state = State::Initial;
 
+	frozen_commands = nullptr;
+
 	if (reset_mode == ResetMode::ResetIndividually)
 	{
 		result = vkResetCommandBuffer(handle, VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT);
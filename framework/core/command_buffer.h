@@ -34,6 +34,7 @@
 namespace vkb
 {
 class CommandPool;
+class FrozenCommands;
 
 /**
  * @brief Records Vulkan commands after begin function and replays them before end function is called.
@@ -68,6 +69,11 @@ class CommandBuffer : public NonCopyable
 
 	Device &get_device();
 
+	/**
+	 * @return The pool the command buffer was allocated from
+	 */
+	CommandPool &get_command_pool();
+
 	CommandRecord &get_recorder();
 
 	CommandReplay &get_replayer();
@@ -86,6 +92,19 @@ class CommandBuffer : public NonCopyable
 
 	VkResult end();
 
+	/**
+	 * @brief Makes a secondary command buffer replay frozen commands instead of the ones recorded into it
+	 *        The command buffer must be recording, and is then ended and executed as usual.
+	 *        Nothing else may be recorded into it, which end() reports as an error.
+	 * @param frozen_commands Commands to replay, which must outlive the frame
+	 */
+	void replay_frozen(FrozenCommands &frozen_commands);
+
+	/**
+	 * @return The frozen commands this command buffer replays, or null if it replays its own commands
+	 */
+	FrozenCommands *get_frozen_commands() const;
+
 	void begin_render_pass(const RenderTarget &render_target, const std::vector<LoadStoreInfo> &load_store_infos, const std::vector<VkClearValue> &clear_values, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
 
 	void next_subpass();
@@ -105,12 +124,18 @@ class CommandBuffer : public NonCopyable
 
 	void push_constants(uint32_t offset, const std::vector<uint8_t> &values);
 
+	/**
+	 * @brief Pushes constants straight from caller memory, without an intermediate copy
+	 * @param offset Offset of the range in the push constant block
+	 * @param data Bytes to push
+	 * @param size Number of bytes to push
+	 */
+	void push_constants(uint32_t offset, const uint8_t *data, uint32_t size);
+
 	template <typename T>
 	void push_constants(uint32_t offset, const T &value)
 	{
-		push_constants(offset,
-		               std::vector<uint8_t>{reinterpret_cast<const uint8_t *>(&value),
-		                                    reinterpret_cast<const uint8_t *>(&value) + sizeof(T)});
+		push_constants(offset, reinterpret_cast<const uint8_t *>(&value), to_u32(sizeof(T)));
 	}
 
 	void bind_buffer(const core::Buffer &buffer, VkDeviceSize offset, VkDeviceSize range, uint32_t set, uint32_t binding, uint32_t array_element);
@@ -161,6 +186,8 @@ class CommandBuffer : public NonCopyable
 
 	void update_buffer(const core::Buffer &buffer, VkDeviceSize offset, const std::vector<uint8_t> &data);
 
+	void update_buffer(const core::Buffer &buffer, VkDeviceSize offset, const uint8_t *data, VkDeviceSize size);
+
 	void blit_image(const core::Image &src_img, const core::Image &dst_img, const std::vector<VkImageBlit> &regions);
 
 	void copy_image(const core::Image &src_img, const core::Image &dst_img, const std::vector<VkImageCopy> &regions);
@@ -175,6 +202,11 @@ class CommandBuffer : public NonCopyable
 
 	const VkCommandBufferUsageFlags get_usage_flags() const;
 
+	/**
+	 * @return The reset mode of the pool the command buffer was allocated from
+	 */
+	const ResetMode get_reset_mode() const;
+
 	/**
 	 * @brief Reset the command buffer to a state where it can be recorded to
 	 * @param reset_mode How to reset the buffer, should match the one used by the pool to allocate it
@@ -195,6 +227,8 @@ class CommandBuffer : public NonCopyable
 	CommandReplay replayer;
 
 	VkCommandBufferUsageFlags usage_flags{};
+
+	FrozenCommands *frozen_commands{nullptr};
 };
 
 template <class T>
@@ -88,6 +88,8 @@ void DescriptorPool::set_descriptor_set_layout(const DescriptorSetLayout &set_la
 
 VkDescriptorSet DescriptorPool::allocate()
 {
+	std::lock_guard<std::mutex> guard{mutex};
+
 	pool_index = find_available_pool(pool_index);
 
 	// Increment allocated set count for the current pool
@@ -122,6 +124,8 @@ VkDescriptorSet DescriptorPool::allocate()
 
 VkResult DescriptorPool::free(VkDescriptorSet descriptor_set)
 {
+	std::lock_guard<std::mutex> guard{mutex};
+
 	// Get the pool index of the descriptor set
 	auto it = set_pool_mapping.find(descriptor_set);
 
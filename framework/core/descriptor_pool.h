@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include <mutex>
 #include <unordered_map>
 
 #include "common/helpers.h"
@@ -31,6 +32,7 @@ class Device;
 class DescriptorSetLayout;
 
 // Manages an array of fixed size VkDescriptorPool and is able to allocate descriptor sets
+// Allocations and frees are synchronized, as descriptor sets may be requested from multiple threads
 class DescriptorPool : public NonCopyable
 {
   public:
@@ -40,7 +42,7 @@ class DescriptorPool : public NonCopyable
 	               const DescriptorSetLayout &descriptor_set_layout,
 	               uint32_t                   pool_size = MAX_SETS_PER_POOL);
 
-	DescriptorPool(DescriptorPool &&) = default;
+	DescriptorPool(DescriptorPool &&) = delete;
 
 	~DescriptorPool();
 
@@ -75,6 +77,9 @@ class DescriptorPool : public NonCopyable
 	// Map between descriptor set and pool index
 	std::unordered_map<VkDescriptorSet, uint32_t> set_pool_mapping;
 
+	// Guards the Vulkan pools and the bookkeeping above
+	std::mutex mutex;
+
 	// Find next pool index or create new pool
 	uint32_t find_available_pool(uint32_t pool_index);
 };
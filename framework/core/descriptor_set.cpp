@@ -65,6 +65,8 @@ void DescriptorSet::update(const BindingMap<VkDescriptorBufferInfo> &buffer_info
 			auto  arrayElement = element_it.first;
 			auto &buffer_info  = element_it.second;
 
+			this->buffer_infos[binding][arrayElement] = buffer_info;
+
 			VkWriteDescriptorSet write_descriptor_set{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
 
 			write_descriptor_set.dstBinding      = binding;
@@ -98,6 +100,8 @@ void DescriptorSet::update(const BindingMap<VkDescriptorBufferInfo> &buffer_info
 			auto  arrayElement = element_it.first;
 			auto &image_info   = element_it.second;
 
+			this->image_infos[binding_index][arrayElement] = image_info;
+
 			VkWriteDescriptorSet write_descriptor_set{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
 
 			write_descriptor_set.dstBinding      = binding_index;
@@ -117,7 +121,9 @@ void DescriptorSet::update(const BindingMap<VkDescriptorBufferInfo> &buffer_info
 DescriptorSet::DescriptorSet(DescriptorSet &&other) :
     device{other.device},
     descriptor_set_layout{other.descriptor_set_layout},
-    handle{other.handle}
+    handle{other.handle},
+    buffer_infos{std::move(other.buffer_infos)},
+    image_infos{std::move(other.image_infos)}
 {
 	other.handle = VK_NULL_HANDLE;
 }
@@ -135,4 +141,14 @@ VkDescriptorSet DescriptorSet::get_handle() const
 {
 	return handle;
 }
+
+const BindingMap<VkDescriptorBufferInfo> &DescriptorSet::get_buffer_infos() const
+{
+	return buffer_infos;
+}
+
+const BindingMap<VkDescriptorImageInfo> &DescriptorSet::get_image_infos() const
+{
+	return image_infos;
+}
 }        // namespace vkb
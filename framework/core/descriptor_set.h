@@ -45,11 +45,25 @@ class DescriptorSet : public NonCopyable
 
 	VkDescriptorSet get_handle() const;
 
+	/**
+	 * @brief Gets the buffers written in the set, by binding and array element
+	 */
+	const BindingMap<VkDescriptorBufferInfo> &get_buffer_infos() const;
+
+	/**
+	 * @brief Gets the images written in the set, by binding and array element
+	 */
+	const BindingMap<VkDescriptorImageInfo> &get_image_infos() const;
+
   private:
 	Device &device;
 
 	DescriptorSetLayout &descriptor_set_layout;
 
 	VkDescriptorSet handle{VK_NULL_HANDLE};
+
+	BindingMap<VkDescriptorBufferInfo> buffer_infos;
+
+	BindingMap<VkDescriptorImageInfo> image_infos;
 };
 }        // namespace vkb
@@ -20,6 +20,8 @@
 
 #include "device.h"
 
+#include <ctpl_stl.h>
+
 VKBP_DISABLE_WARNINGS()
 #define VMA_IMPLEMENTATION
 #include <vk_mem_alloc.h>
@@ -283,4 +285,31 @@ ResourceCache &Device::get_resource_cache()
 {
 	return resource_cache;
 }
+
+void Device::set_state_filter_enabled(bool enabled)
+{
+	state_filter_enabled = enabled;
+}
+
+bool Device::is_state_filter_enabled() const
+{
+	return state_filter_enabled;
+}
+
+void Device::set_replay_thread_count(size_t thread_count)
+{
+	if (thread_count > 0)
+	{
+		replay_thread_pool = std::make_unique<ctpl::thread_pool>(static_cast<int>(thread_count));
+	}
+	else
+	{
+		replay_thread_pool.reset();
+	}
+}
+
+ctpl::thread_pool *Device::get_replay_thread_pool()
+{
+	return replay_thread_pool.get();
+}
 }        // namespace vkb
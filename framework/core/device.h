@@ -103,6 +103,26 @@ class Device : public NonCopyable
 
 	ResourceCache &get_resource_cache();
 
+	/**
+	 * @brief Enables the filter which drops redundant pipeline, descriptor set, vertex and index buffer
+	 *        binds and dynamic state sets when command buffers are replayed
+	 */
+	void set_state_filter_enabled(bool enabled);
+
+	bool is_state_filter_enabled() const;
+
+	/**
+	 * @brief Replays the secondary command buffers executed by a primary one on worker threads,
+	 *        instead of one after another on the thread ending the primary command buffer
+	 * @param thread_count Number of worker threads, 0 to replay on the calling thread only
+	 */
+	void set_replay_thread_count(size_t thread_count);
+
+	/**
+	 * @return Workers replaying secondary command buffers, or null if they are replayed on the calling thread
+	 */
+	ctpl::thread_pool *get_replay_thread_pool();
+
   private:
 	VkPhysicalDevice physical_device{VK_NULL_HANDLE};
 
@@ -127,5 +147,9 @@ class Device : public NonCopyable
 	std::unique_ptr<FencePool> fence_pool;
 
 	ResourceCache resource_cache;
+
+	bool state_filter_enabled{false};
+
+	std::unique_ptr<ctpl::thread_pool> replay_thread_pool;
 };
 }        // namespace vkb
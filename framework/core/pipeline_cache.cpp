@@ -0,0 +1,191 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "pipeline_cache.h"
+
+#include "common/logging.h"
+#include "device.h"
+#include "platform/filesystem.h"
+
+namespace vkb
+{
+PipelineCache::PipelineCache(Device &device, const std::string &filename) :
+    device{device},
+    filename{filename}
+{
+}
+
+PipelineCache::~PipelineCache()
+{
+	clear();
+}
+
+VkPipelineCache PipelineCache::get_handle()
+{
+	std::lock_guard<std::mutex> guard{mutex};
+
+	auto it = thread_caches.find(std::this_thread::get_id());
+
+	if (it != thread_caches.end())
+	{
+		return it->second;
+	}
+
+	if (!loaded)
+	{
+		load();
+	}
+
+	VkPipelineCacheCreateInfo create_info{VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+	create_info.initialDataSize = initial_data.size();
+	create_info.pInitialData    = initial_data.data();
+
+	VkPipelineCache handle{VK_NULL_HANDLE};
+
+	VK_CHECK(vkCreatePipelineCache(device.get_handle(), &create_info, nullptr, &handle));
+
+	thread_caches.emplace(std::this_thread::get_id(), handle);
+
+	return handle;
+}
+
+void PipelineCache::save()
+{
+	std::lock_guard<std::mutex> save_guard{save_mutex};
+
+	std::vector<VkPipelineCache> src_caches;
+
+	{
+		std::lock_guard<std::mutex> guard{mutex};
+
+		for (auto &thread_cache : thread_caches)
+		{
+			src_caches.push_back(thread_cache.second);
+		}
+	}
+
+	if (src_caches.empty())
+	{
+		return;
+	}
+
+	// The source caches are only read by the merge, which is allowed while other threads
+	// create pipelines with them, so the handle list is all that needs the lock
+	VkPipelineCacheCreateInfo create_info{VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+
+	VkPipelineCache merged_cache{VK_NULL_HANDLE};
+
+	VK_CHECK(vkCreatePipelineCache(device.get_handle(), &create_info, nullptr, &merged_cache));
+
+	std::vector<uint8_t> data;
+
+	VkResult result = vkMergePipelineCaches(device.get_handle(), merged_cache, to_u32(src_caches.size()), src_caches.data());
+
+	if (result == VK_SUCCESS)
+	{
+		size_t size{};
+		result = vkGetPipelineCacheData(device.get_handle(), merged_cache, &size, nullptr);
+
+		if (result == VK_SUCCESS)
+		{
+			data.resize(size);
+			result = vkGetPipelineCacheData(device.get_handle(), merged_cache, &size, data.data());
+		}
+	}
+
+	vkDestroyPipelineCache(device.get_handle(), merged_cache, nullptr);
+
+	if (result != VK_SUCCESS)
+	{
+		LOGW("Failed to merge pipeline caches: error {}", static_cast<int>(result));
+		return;
+	}
+
+	try
+	{
+		fs::write_temp(data, filename);
+	}
+	catch (const std::runtime_error &e)
+	{
+		LOGW("Failed to save pipeline cache: {}", e.what());
+	}
+
+	std::lock_guard<std::mutex> guard{mutex};
+
+	initial_data.swap(data);
+}
+
+void PipelineCache::clear()
+{
+	std::lock_guard<std::mutex> save_guard{save_mutex};
+
+	std::lock_guard<std::mutex> guard{mutex};
+
+	for (auto &thread_cache : thread_caches)
+	{
+		vkDestroyPipelineCache(device.get_handle(), thread_cache.second, nullptr);
+	}
+
+	thread_caches.clear();
+}
+
+void PipelineCache::load()
+{
+	loaded = true;
+
+	std::vector<uint8_t> data;
+
+	try
+	{
+		data = fs::read_temp(filename);
+	}
+	catch (const std::runtime_error &)
+	{
+		LOGI("No pipeline cache found, starting with an empty one");
+		return;
+	}
+
+	// The data starts with a VkPipelineCacheHeaderVersionOne, drivers should ignore foreign data
+	// but checking it here is cheap and avoids relying on it
+	const size_t header_size = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+
+	if (data.size() < header_size)
+	{
+		LOGW("Pipeline cache {} is truncated, ignoring it", filename);
+		return;
+	}
+
+	uint32_t header[4];
+	std::memcpy(header, data.data(), sizeof(header));
+
+	auto &properties = device.get_properties();
+
+	if (header[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+	    header[2] != properties.vendorID ||
+	    header[3] != properties.deviceID ||
+	    std::memcmp(data.data() + sizeof(header), properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+	{
+		LOGW("Pipeline cache {} was created by another device or driver, ignoring it", filename);
+		return;
+	}
+
+	initial_data = std::move(data);
+}
+}        // namespace vkb
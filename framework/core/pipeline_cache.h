@@ -0,0 +1,99 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <thread>
+
+#include "common/helpers.h"
+#include "common/vk_common.h"
+
+namespace vkb
+{
+class Device;
+
+/**
+ * @brief Owns the Vulkan pipeline caches of a device and persists them in the temporary storage directory.
+ * Each thread creating pipelines gets its own VkPipelineCache, created from the saved data,
+ * so that parallel compilations do not contend on a single cache. They are merged when saved.
+ */
+class PipelineCache : public NonCopyable
+{
+  public:
+	PipelineCache(Device &device, const std::string &filename = "pipeline_cache.data");
+
+	~PipelineCache();
+
+	/**
+	 * @brief Gets the cache of the calling thread, creating it on first use
+	 */
+	VkPipelineCache get_handle();
+
+	/**
+	 * @brief Merges the caches of all threads and writes them to disk.
+	 *        Threads may keep getting their caches and creating pipelines meanwhile.
+	 */
+	void save();
+
+	/**
+	 * @brief Destroys all the caches, the next requests create them again from the saved data
+	 */
+	void clear();
+
+  private:
+	Device &device;
+
+	std::string filename;
+
+	/// Guards the thread caches and the initial data
+	std::mutex mutex;
+
+	/// Held for a whole save, so that clear does not destroy the caches being merged
+	std::mutex save_mutex;
+
+	bool loaded{false};
+
+	/// Data read from disk or saved last, every new cache starts with it
+	std::vector<uint8_t> initial_data;
+
+	std::unordered_map<std::thread::id, VkPipelineCache> thread_caches;
+
+	/**
+	 * @brief Reads the saved data, unless it was written by another device or driver
+	 */
+	void load();
+};
+
+/**
+ * @brief Stands for the VkPipelineCache of the thread converting it.
+ * Pipelines are built with it in place of a VkPipelineCache, so that the cache is picked
+ * by the thread building the pipeline, which is not always the thread requesting it.
+ */
+struct ThreadPipelineCache
+{
+	PipelineCache *pipeline_cache;
+
+	operator VkPipelineCache() const
+	{
+		return pipeline_cache->get_handle();
+	}
+};
+}        // namespace vkb
@@ -23,6 +23,7 @@
 #include "common/logging.h"
 #include "device.h"
 #include "glsl_compiler.h"
+#include "shader_cache.h"
 #include "spirv_reflection.h"
 
 namespace vkb
@@ -44,20 +45,33 @@ ShaderModule::ShaderModule(Device &device, VkShaderStageFlagBits stage, const Sh
 		throw VulkanException{VK_ERROR_INITIALIZATION_FAILED};
 	}
 
-	GLSLCompiler glsl_compiler;
+	ShaderCache shader_cache;
 
-	// Compile the GLSL source
-	if (!glsl_compiler.compile_to_spirv(stage, glsl_source.get_data(), entry_point, shader_variant, spirv, info_log))
+	auto cache_key = shader_cache.get_key(stage, glsl_source.get_data(), entry_point, shader_variant);
+
+	// Reuse SPIRV and reflection from a previous run when available
+	if (!shader_cache.load(cache_key, spirv, resources))
 	{
-		throw VulkanException{VK_ERROR_INITIALIZATION_FAILED};
-	}
+		spirv.clear();
+		resources.clear();
 
-	SPIRVReflection spirv_reflection;
+		GLSLCompiler glsl_compiler;
 
-	// Reflect all shader resouces
-	if (!spirv_reflection.reflect_shader_resources(stage, spirv, resources, shader_variant))
-	{
-		throw VulkanException{VK_ERROR_INITIALIZATION_FAILED};
+		// Compile the GLSL source
+		if (!glsl_compiler.compile_to_spirv(stage, glsl_source.get_data(), entry_point, shader_variant, spirv, info_log))
+		{
+			throw VulkanException{VK_ERROR_INITIALIZATION_FAILED};
+		}
+
+		SPIRVReflection spirv_reflection;
+
+		// Reflect all shader resouces
+		if (!spirv_reflection.reflect_shader_resources(stage, spirv, resources, shader_variant))
+		{
+			throw VulkanException{VK_ERROR_INITIALIZATION_FAILED};
+		}
+
+		shader_cache.store(cache_key, spirv, resources);
 	}
 
 	// Generate a unique id, determined by source and variant
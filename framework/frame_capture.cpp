@@ -0,0 +1,716 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "frame_capture.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+#include "common/logging.h"
+#include "core/command_buffer.h"
+#include "core/device.h"
+#include "frozen_commands.h"
+#include "resource_cache.h"
+
+namespace vkb
+{
+namespace
+{
+/// Largest size of a texel, used to size the buffers copied to images as their format is unknown
+constexpr VkDeviceSize MAX_TEXEL_SIZE = 16;
+
+inline void write_render_pass_bindings(std::ostream &os, const std::vector<CapturedRenderPassBinding> &value)
+{
+	write(os, value.size());
+	for (const CapturedRenderPassBinding &binding : value)
+	{
+		write(os, binding.event_id, binding.render_target, binding.load_store_infos, binding.clear_values);
+
+		write(os, binding.subpasses.size());
+		for (const SubpassDesc &subpass : binding.subpasses)
+		{
+			write(os, subpass.event_id, subpass.input_attachments, subpass.output_attachments, subpass.contents);
+		}
+	}
+}
+
+inline void read_render_pass_bindings(std::istream &is, std::vector<CapturedRenderPassBinding> &value)
+{
+	std::size_t size;
+	read(is, size);
+	value.resize(size);
+	for (CapturedRenderPassBinding &binding : value)
+	{
+		read(is, binding.event_id, binding.render_target, binding.load_store_infos, binding.clear_values);
+
+		std::size_t subpass_count;
+		read(is, subpass_count);
+		binding.subpasses.resize(subpass_count);
+		for (SubpassDesc &subpass : binding.subpasses)
+		{
+			read(is, subpass.event_id, subpass.input_attachments, subpass.output_attachments, subpass.contents);
+		}
+	}
+}
+
+inline void write_descriptor_set_bindings(std::ostream &os, const std::vector<CapturedDescriptorSetBinding> &value)
+{
+	write(os, value.size());
+	for (const CapturedDescriptorSetBinding &binding : value)
+	{
+		write(os, binding.event_id, binding.pipeline_bind_point, binding.set_index, binding.pipeline_layout, binding.descriptor_set, binding.dynamic_offsets);
+	}
+}
+
+inline void read_descriptor_set_bindings(std::istream &is, std::vector<CapturedDescriptorSetBinding> &value)
+{
+	std::size_t size;
+	read(is, size);
+	value.resize(size);
+	for (CapturedDescriptorSetBinding &binding : value)
+	{
+		read(is, binding.event_id, binding.pipeline_bind_point, binding.set_index, binding.pipeline_layout, binding.descriptor_set, binding.dynamic_offsets);
+	}
+}
+
+/**
+ * @brief Gets the extent of the base mip level needed for a region of a mip level
+ */
+inline VkExtent3D get_required_extent(const VkOffset3D &offset, const VkExtent3D &extent, uint32_t mip_level)
+{
+	return {(to_u32(offset.x) + extent.width) << mip_level,
+	        (to_u32(offset.y) + extent.height) << mip_level,
+	        std::max(1u, to_u32(offset.z) + extent.depth)};
+}
+
+/**
+ * @brief Gets the extent of the base mip level needed for a blit region, whose corners may be in any order
+ */
+inline VkExtent3D get_required_extent(const VkOffset3D (&offsets)[2], uint32_t mip_level)
+{
+	return {to_u32(std::max(offsets[0].x, offsets[1].x)) << mip_level,
+	        to_u32(std::max(offsets[0].y, offsets[1].y)) << mip_level,
+	        std::max(1u, to_u32(std::max(offsets[0].z, offsets[1].z)))};
+}
+
+inline uint32_t get_required_count(uint32_t base, uint32_t count)
+{
+	return count == VK_REMAINING_MIP_LEVELS ? base + 1 : base + count;
+}
+}        // namespace
+
+std::vector<uint8_t> FrameCapture::capture(CommandBuffer &command_buffer)
+{
+	assert(command_buffer.level == VK_COMMAND_BUFFER_LEVEL_PRIMARY && "Only primary command buffers can be captured");
+
+	device = &command_buffer.get_device();
+
+	frame = {};
+
+	buffer_indices.clear();
+	image_indices.clear();
+	image_view_indices.clear();
+	sampler_indices.clear();
+	pipeline_layout_indices.clear();
+	render_target_indices.clear();
+	descriptor_set_indices.clear();
+	stream_indices.clear();
+
+	capture_stream(command_buffer);
+
+	// Pipelines and layouts are looked up before serializing, so that all of them are part of the serialized resources
+	frame.resources = device->get_resource_cache().serialize();
+
+	std::vector<uint8_t> data(sizeof(FrameCaptureHeader));
+
+	VectorStreamBuffer buffer{data};
+	std::ostream       stream{&buffer};
+
+	write(stream, frame.resources, frame.images, frame.buffer_sizes, frame.image_views, frame.sampler_count, frame.render_target_count);
+
+	write(stream, frame.descriptor_sets.size());
+	for (const CapturedDescriptorSet &descriptor_set : frame.descriptor_sets)
+	{
+		write(stream, descriptor_set.pipeline_layout, descriptor_set.set_index, descriptor_set.buffer_infos, descriptor_set.image_infos);
+	}
+
+	size_t command_count = 0;
+
+	write(stream, frame.streams.size());
+	for (const CapturedStream &captured_stream : frame.streams)
+	{
+		write(stream, captured_stream.usage_flags, captured_stream.packets, captured_stream.packet_count, captured_stream.pipeline_bindings);
+
+		write_render_pass_bindings(stream, captured_stream.render_pass_bindings);
+
+		write_descriptor_set_bindings(stream, captured_stream.descriptor_set_bindings);
+
+		command_count += captured_stream.packet_count;
+	}
+
+	const uint8_t *payload_data = data.data() + sizeof(FrameCaptureHeader);
+
+	FrameCaptureHeader header{};
+	header.magic        = FrameCaptureHeader::MAGIC;
+	header.version      = FrameCaptureHeader::VERSION;
+	header.payload_size = data.size() - sizeof(FrameCaptureHeader);
+	header.checksum     = hash_bytes(payload_data, static_cast<size_t>(header.payload_size));
+	std::memcpy(header.pipeline_cache_uuid, device->get_properties().pipelineCacheUUID, VK_UUID_SIZE);
+
+	std::memcpy(data.data(), &header, sizeof(header));
+
+	LOGI("Captured {} command buffers with {} commands, {} buffers, {} images and {} descriptor sets ({:.1f} KiB)",
+	     frame.streams.size(), command_count, frame.buffer_sizes.size(), frame.images.size(), frame.descriptor_sets.size(), data.size() / 1024.0f);
+
+	return data;
+}
+
+bool FrameCapture::load(const uint8_t *data, size_t size, const uint8_t *pipeline_cache_uuid, CapturedFrame &frame)
+{
+	if (size < sizeof(FrameCaptureHeader))
+	{
+		LOGW("Frame capture rejected: truncated header");
+		return false;
+	}
+
+	// The data may not be aligned, e.g. when read from a file
+	FrameCaptureHeader header;
+	std::memcpy(&header, data, sizeof(header));
+
+	if (header.magic != FrameCaptureHeader::MAGIC || header.version != FrameCaptureHeader::VERSION)
+	{
+		LOGW("Frame capture rejected: unknown format or version {}", header.version);
+		return false;
+	}
+
+	if (std::memcmp(header.pipeline_cache_uuid, pipeline_cache_uuid, VK_UUID_SIZE) != 0)
+	{
+		LOGW("Frame capture rejected: captured with a different device or driver");
+		return false;
+	}
+
+	if (header.payload_size != size - sizeof(FrameCaptureHeader))
+	{
+		LOGW("Frame capture rejected: size mismatch");
+		return false;
+	}
+
+	const uint8_t *payload_data = data + sizeof(FrameCaptureHeader);
+
+	if (hash_bytes(payload_data, static_cast<size_t>(header.payload_size)) != header.checksum)
+	{
+		LOGW("Frame capture rejected: checksum mismatch");
+		return false;
+	}
+
+	frame = {};
+
+	MemoryStreamBuffer buffer{payload_data, static_cast<size_t>(header.payload_size)};
+	std::istream       stream{&buffer};
+
+	read(stream, frame.resources, frame.images, frame.buffer_sizes, frame.image_views, frame.sampler_count, frame.render_target_count);
+
+	std::size_t descriptor_set_count;
+	read(stream, descriptor_set_count);
+	frame.descriptor_sets.resize(descriptor_set_count);
+	for (CapturedDescriptorSet &descriptor_set : frame.descriptor_sets)
+	{
+		read(stream, descriptor_set.pipeline_layout, descriptor_set.set_index, descriptor_set.buffer_infos, descriptor_set.image_infos);
+	}
+
+	std::size_t stream_count;
+	read(stream, stream_count);
+	frame.streams.resize(stream_count);
+	for (CapturedStream &captured_stream : frame.streams)
+	{
+		read(stream, captured_stream.usage_flags, captured_stream.packets, captured_stream.packet_count, captured_stream.pipeline_bindings);
+
+		read_render_pass_bindings(stream, captured_stream.render_pass_bindings);
+
+		read_descriptor_set_bindings(stream, captured_stream.descriptor_set_bindings);
+	}
+
+	if (!stream || frame.streams.empty())
+	{
+		LOGW("Frame capture rejected: invalid payload");
+		return false;
+	}
+
+	return true;
+}
+
+uint32_t FrameCapture::capture_stream(CommandBuffer &command_buffer)
+{
+	auto stream_it = stream_indices.find(&command_buffer);
+
+	if (stream_it != stream_indices.end())
+	{
+		return stream_it->second;
+	}
+
+	uint32_t index = to_u32(frame.streams.size());
+
+	stream_indices.emplace(&command_buffer, index);
+
+	// Reserve the slot of the stream, the secondary command buffers it executes are captured after it
+	frame.streams.emplace_back();
+
+	auto frozen_commands = command_buffer.get_frozen_commands();
+
+	auto &record = frozen_commands ? frozen_commands->get_record() : command_buffer.get_recorder();
+
+	const CommandArena &arena = record.get_arena();
+
+	// Find the end command, the last packet of an ended command buffer
+	size_t end_offset = 0;
+
+	for (size_t offset = 0; offset < arena.get_size(); offset += reinterpret_cast<const CommandHeader *>(arena.get_data() + offset)->size)
+	{
+		end_offset = offset;
+	}
+
+	if (arena.get_count() == 0 || reinterpret_cast<const CommandHeader *>(arena.get_data() + end_offset)->type != CommandType::End)
+	{
+		throw std::runtime_error{"Command buffers must be ended before they are captured"};
+	}
+
+	CapturedStream stream;
+	stream.usage_flags  = command_buffer.get_usage_flags();
+	stream.packets      = std::vector<uint8_t>(arena.get_data(), arena.get_data() + end_offset);
+	stream.packet_count = arena.get_count() - 1;
+
+	// Attachments are captured first, so that commands using their images do not describe them again
+	for (auto &render_pass_binding : record.get_render_pass_bindings())
+	{
+		CapturedRenderPassBinding binding{render_pass_binding.event_id, capture_render_target(render_pass_binding.render_target)};
+		binding.load_store_infos = render_pass_binding.load_store_infos;
+		binding.clear_values     = render_pass_binding.clear_values;
+		binding.subpasses        = render_pass_binding.subpasses;
+
+		for (auto &subpass : binding.subpasses)
+		{
+			subpass.pipeline_descs.clear();
+		}
+
+		stream.render_pass_bindings.push_back(std::move(binding));
+	}
+
+	for (auto &pipeline_binding : record.get_pipeline_bindings())
+	{
+		if (pipeline_binding.pipeline_bind_point != VK_PIPELINE_BIND_POINT_GRAPHICS)
+		{
+			throw std::runtime_error{"Frames using compute pipelines cannot be captured"};
+		}
+
+		if (!pipeline_binding.pipeline)
+		{
+			throw std::runtime_error{"Frames using pipelines which are still compiling cannot be captured"};
+		}
+
+		auto &graphics_pipeline = static_cast<const GraphicsPipeline &>(*pipeline_binding.pipeline);
+
+		stream.pipeline_bindings.push_back({pipeline_binding.event_id,
+		                                    pipeline_binding.pipeline_bind_point,
+		                                    to_u32(device->get_resource_cache().get_serialized_index(graphics_pipeline))});
+	}
+
+	for (auto &descriptor_set_binding : record.get_descriptor_set_bindings())
+	{
+		CapturedDescriptorSetBinding binding{descriptor_set_binding.event_id,
+		                                     descriptor_set_binding.pipeline_bind_point,
+		                                     descriptor_set_binding.set_index,
+		                                     capture_pipeline_layout(descriptor_set_binding.pipeline_layout.get_handle()),
+		                                     capture_descriptor_set(descriptor_set_binding),
+		                                     descriptor_set_binding.dynamic_offsets};
+
+		if (!binding.dynamic_offsets.empty())
+		{
+			// Dynamic offsets are added to the offsets written in the set
+			VkDeviceSize max_dynamic_offset = *std::max_element(binding.dynamic_offsets.begin(), binding.dynamic_offsets.end());
+
+			for (auto &binding_it : frame.descriptor_sets[binding.descriptor_set].buffer_infos)
+			{
+				for (auto &element_it : binding_it.second)
+				{
+					auto &buffer_info = element_it.second;
+
+					VkDeviceSize range = buffer_info.range == VK_WHOLE_SIZE ? 1 : buffer_info.range;
+
+					auto &buffer_size = frame.buffer_sizes[buffer_info.buffer];
+					buffer_size       = std::max(buffer_size, buffer_info.offset + range + max_dynamic_offset);
+				}
+			}
+		}
+
+		stream.descriptor_set_bindings.push_back(std::move(binding));
+	}
+
+	capture_packets(stream);
+
+	frame.streams[index] = std::move(stream);
+
+	return index;
+}
+
+void FrameCapture::capture_packets(CapturedStream &stream)
+{
+	uint8_t *data = stream.packets.data();
+
+	size_t offset = 0;
+
+	while (offset < stream.packets.size())
+	{
+		auto &header = *reinterpret_cast<CommandHeader *>(data + offset);
+
+		offset += header.size;
+
+		switch (header.type)
+		{
+			case CommandType::ExecuteCommands:
+			{
+				auto &command         = reinterpret_cast<ExecuteCommandsCommand &>(header);
+				auto  command_buffers = CommandArena::get_trailing<CommandBuffer *>(command);
+
+				for (uint32_t i = 0; i < command.command_buffer_count; ++i)
+				{
+					auto stream_index = capture_stream(*command_buffers[i]);
+					set_index(command_buffers[i], stream_index);
+				}
+				break;
+			}
+			case CommandType::PushConstants:
+			{
+				auto &command = reinterpret_cast<PushConstantsCommand &>(header);
+				set_index(command.pipeline_layout, capture_pipeline_layout(command.pipeline_layout));
+				break;
+			}
+			case CommandType::BindVertexBuffers:
+			{
+				auto &command = reinterpret_cast<BindVertexBuffersCommand &>(header);
+				auto  buffers = CommandArena::get_trailing<VkBuffer>(command);
+				auto  offsets = reinterpret_cast<const VkDeviceSize *>(buffers + command.binding_count);
+
+				for (uint32_t i = 0; i < command.binding_count; ++i)
+				{
+					set_index(buffers[i], capture_buffer(buffers[i], offsets[i] + 1));
+				}
+				break;
+			}
+			case CommandType::BindIndexBuffer:
+			{
+				auto &command = reinterpret_cast<BindIndexBufferCommand &>(header);
+				set_index(command.buffer, capture_buffer(command.buffer, command.offset + 1));
+				break;
+			}
+			case CommandType::DrawIndexedIndirect:
+			{
+				auto &command = reinterpret_cast<DrawIndexedIndirectCommand &>(header);
+				auto  size    = sizeof(VkDrawIndexedIndirectCommand) + static_cast<VkDeviceSize>(std::max(command.draw_count, 1u) - 1) * command.stride;
+				set_index(command.buffer, capture_buffer(command.buffer, command.offset + size));
+				break;
+			}
+			case CommandType::DispatchIndirect:
+			{
+				auto &command = reinterpret_cast<DispatchIndirectCommand &>(header);
+				set_index(command.buffer, capture_buffer(command.buffer, command.offset + sizeof(VkDispatchIndirectCommand)));
+				break;
+			}
+			case CommandType::UpdateBuffer:
+			{
+				auto &command = reinterpret_cast<UpdateBufferCommand &>(header);
+				set_index(command.buffer, capture_buffer(command.buffer, command.offset + command.size));
+				break;
+			}
+			case CommandType::BlitImage:
+			{
+				auto &command = reinterpret_cast<BlitImageCommand &>(header);
+				auto  regions = CommandArena::get_trailing<VkImageBlit>(command);
+
+				uint32_t src_index = capture_image(command.src_image, {1, 1, 1}, 1, 1);
+				uint32_t dst_index = capture_image(command.dst_image, {1, 1, 1}, 1, 1);
+
+				for (uint32_t i = 0; i < command.region_count; ++i)
+				{
+					auto &src = regions[i].srcSubresource;
+					auto &dst = regions[i].dstSubresource;
+
+					capture_image(command.src_image, get_required_extent(regions[i].srcOffsets, src.mipLevel), src.mipLevel + 1, src.baseArrayLayer + src.layerCount);
+					capture_image(command.dst_image, get_required_extent(regions[i].dstOffsets, dst.mipLevel), dst.mipLevel + 1, dst.baseArrayLayer + dst.layerCount);
+				}
+
+				set_index(command.src_image, src_index);
+				set_index(command.dst_image, dst_index);
+				break;
+			}
+			case CommandType::CopyImage:
+			{
+				auto &command = reinterpret_cast<CopyImageCommand &>(header);
+				auto  regions = CommandArena::get_trailing<VkImageCopy>(command);
+
+				uint32_t src_index = capture_image(command.src_image, {1, 1, 1}, 1, 1);
+				uint32_t dst_index = capture_image(command.dst_image, {1, 1, 1}, 1, 1);
+
+				for (uint32_t i = 0; i < command.region_count; ++i)
+				{
+					auto &src = regions[i].srcSubresource;
+					auto &dst = regions[i].dstSubresource;
+
+					capture_image(command.src_image, get_required_extent(regions[i].srcOffset, regions[i].extent, src.mipLevel), src.mipLevel + 1, src.baseArrayLayer + src.layerCount);
+					capture_image(command.dst_image, get_required_extent(regions[i].dstOffset, regions[i].extent, dst.mipLevel), dst.mipLevel + 1, dst.baseArrayLayer + dst.layerCount);
+				}
+
+				set_index(command.src_image, src_index);
+				set_index(command.dst_image, dst_index);
+				break;
+			}
+			case CommandType::CopyBufferToImage:
+			{
+				auto &command = reinterpret_cast<CopyBufferToImageCommand &>(header);
+				auto  regions = CommandArena::get_trailing<VkBufferImageCopy>(command);
+
+				uint32_t buffer_index = capture_buffer(command.buffer, 1);
+				uint32_t image_index  = capture_image(command.image, {1, 1, 1}, 1, 1);
+
+				for (uint32_t i = 0; i < command.region_count; ++i)
+				{
+					auto &region      = regions[i];
+					auto &subresource = region.imageSubresource;
+
+					VkDeviceSize texel_count = static_cast<VkDeviceSize>(region.imageExtent.width) * region.imageExtent.height * region.imageExtent.depth * subresource.layerCount;
+
+					capture_buffer(command.buffer, region.bufferOffset + texel_count * MAX_TEXEL_SIZE);
+					capture_image(command.image, get_required_extent(region.imageOffset, region.imageExtent, subresource.mipLevel), subresource.mipLevel + 1, subresource.baseArrayLayer + subresource.layerCount);
+				}
+
+				set_index(command.buffer, buffer_index);
+				set_index(command.image, image_index);
+				break;
+			}
+			case CommandType::ImageMemoryBarrier:
+			{
+				auto &command = reinterpret_cast<ImageMemoryBarrierCommand &>(header);
+				auto &range   = command.subresource_range;
+
+				set_index(command.image, capture_image(command.image, {1, 1, 1},
+				                                       get_required_count(range.baseMipLevel, range.levelCount),
+				                                       get_required_count(range.baseArrayLayer, range.layerCount)));
+				break;
+			}
+			case CommandType::BufferMemoryBarrier:
+			{
+				auto &command = reinterpret_cast<BufferMemoryBarrierCommand &>(header);
+				set_index(command.buffer, capture_buffer(command.buffer, command.size == VK_WHOLE_SIZE ? command.offset + 1 : command.offset + command.size));
+				break;
+			}
+			default:
+				break;
+		}
+	}
+}
+
+uint32_t FrameCapture::capture_render_target(const RenderTarget &render_target)
+{
+	auto render_target_it = render_target_indices.find(&render_target);
+
+	if (render_target_it != render_target_indices.end())
+	{
+		return render_target_it->second;
+	}
+
+	uint32_t index = frame.render_target_count++;
+
+	render_target_indices.emplace(&render_target, index);
+
+	auto &views = render_target.get_views();
+
+	for (uint32_t i = 0; i < to_u32(views.size()); ++i)
+	{
+		auto &image = views[i].get_image();
+
+		CapturedImage captured_image{};
+		captured_image.extent        = image.get_extent();
+		captured_image.format        = image.get_format();
+		captured_image.usage         = image.get_usage();
+		captured_image.samples       = image.get_sample_count();
+		captured_image.mip_levels    = 1;
+		captured_image.array_layers  = 1;
+		captured_image.render_target = index;
+		captured_image.attachment    = i;
+
+		uint32_t image_index = to_u32(frame.images.size());
+
+		image_indices[image.get_handle()] = image_index;
+		frame.images.push_back(captured_image);
+
+		// Views of attachments used as input attachments are replaced with views of the replayed attachments
+		image_view_indices[views[i].get_handle()] = to_u32(frame.image_views.size());
+		frame.image_views.push_back(image_index);
+	}
+
+	return index;
+}
+
+uint32_t FrameCapture::capture_descriptor_set(const DescriptorSetBinding &binding)
+{
+	auto descriptor_set_it = descriptor_set_indices.find(&binding.descriptor_set);
+
+	if (descriptor_set_it != descriptor_set_indices.end())
+	{
+		return descriptor_set_it->second;
+	}
+
+	CapturedDescriptorSet descriptor_set{capture_pipeline_layout(binding.pipeline_layout.get_handle()), binding.set_index};
+
+	for (auto &binding_it : binding.descriptor_set.get_buffer_infos())
+	{
+		for (auto &element_it : binding_it.second)
+		{
+			auto &buffer_info = element_it.second;
+
+			VkDeviceSize range = buffer_info.range == VK_WHOLE_SIZE ? 1 : buffer_info.range;
+
+			descriptor_set.buffer_infos[binding_it.first][element_it.first] = {capture_buffer(buffer_info.buffer, buffer_info.offset + range), 0, buffer_info.offset, buffer_info.range};
+		}
+	}
+
+	for (auto &binding_it : binding.descriptor_set.get_image_infos())
+	{
+		for (auto &element_it : binding_it.second)
+		{
+			auto &image_info = element_it.second;
+
+			descriptor_set.image_infos[binding_it.first][element_it.first] = {image_info.imageView != VK_NULL_HANDLE ? capture_image_view(image_info.imageView) : NO_INDEX,
+			                                                                  image_info.sampler != VK_NULL_HANDLE ? capture_sampler(image_info.sampler) : NO_INDEX,
+			                                                                  image_info.imageLayout,
+			                                                                  0};
+		}
+	}
+
+	uint32_t index = to_u32(frame.descriptor_sets.size());
+
+	descriptor_set_indices.emplace(&binding.descriptor_set, index);
+
+	frame.descriptor_sets.push_back(std::move(descriptor_set));
+
+	return index;
+}
+
+uint32_t FrameCapture::capture_buffer(VkBuffer handle, VkDeviceSize required_size)
+{
+	auto res_ins_it = buffer_indices.emplace(handle, to_u32(frame.buffer_sizes.size()));
+
+	if (res_ins_it.second)
+	{
+		frame.buffer_sizes.push_back(0);
+	}
+
+	auto &buffer_size = frame.buffer_sizes[res_ins_it.first->second];
+	buffer_size       = std::max(buffer_size, required_size);
+
+	return res_ins_it.first->second;
+}
+
+uint32_t FrameCapture::capture_image(VkImage handle, const VkExtent3D &required_extent, uint32_t required_mip_levels, uint32_t required_array_layers)
+{
+	auto res_ins_it = image_indices.emplace(handle, to_u32(frame.images.size()));
+
+	if (res_ins_it.second)
+	{
+		// Not an attachment, the image is described by the commands using it
+		CapturedImage captured_image{};
+		captured_image.extent        = {1, 1, 1};
+		captured_image.format        = VK_FORMAT_R8G8B8A8_UNORM;
+		captured_image.usage         = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		captured_image.samples       = VK_SAMPLE_COUNT_1_BIT;
+		captured_image.mip_levels    = 1;
+		captured_image.array_layers  = 1;
+		captured_image.render_target = NO_INDEX;
+
+		frame.images.push_back(captured_image);
+	}
+
+	auto &captured_image = frame.images[res_ins_it.first->second];
+
+	if (captured_image.render_target == NO_INDEX)
+	{
+		captured_image.extent.width  = std::max(captured_image.extent.width, required_extent.width);
+		captured_image.extent.height = std::max(captured_image.extent.height, required_extent.height);
+		captured_image.extent.depth  = std::max(captured_image.extent.depth, required_extent.depth);
+		captured_image.mip_levels    = std::max(captured_image.mip_levels, required_mip_levels);
+		captured_image.array_layers  = std::max(captured_image.array_layers, required_array_layers);
+	}
+
+	return res_ins_it.first->second;
+}
+
+uint32_t FrameCapture::capture_image_view(VkImageView handle)
+{
+	auto image_view_it = image_view_indices.find(handle);
+
+	if (image_view_it != image_view_indices.end())
+	{
+		return image_view_it->second;
+	}
+
+	// Only the identity of the view is kept, the replay creates a view of a single texel image for it
+	CapturedImage captured_image{};
+	captured_image.extent        = {1, 1, 1};
+	captured_image.format        = VK_FORMAT_R8G8B8A8_UNORM;
+	captured_image.usage         = VK_IMAGE_USAGE_SAMPLED_BIT;
+	captured_image.samples       = VK_SAMPLE_COUNT_1_BIT;
+	captured_image.mip_levels    = 1;
+	captured_image.array_layers  = 1;
+	captured_image.render_target = NO_INDEX;
+
+	uint32_t index = to_u32(frame.image_views.size());
+
+	image_view_indices.emplace(handle, index);
+
+	frame.image_views.push_back(to_u32(frame.images.size()));
+	frame.images.push_back(captured_image);
+
+	return index;
+}
+
+uint32_t FrameCapture::capture_sampler(VkSampler handle)
+{
+	auto res_ins_it = sampler_indices.emplace(handle, frame.sampler_count);
+
+	if (res_ins_it.second)
+	{
+		++frame.sampler_count;
+	}
+
+	return res_ins_it.first->second;
+}
+
+uint32_t FrameCapture::capture_pipeline_layout(VkPipelineLayout handle)
+{
+	auto pipeline_layout_it = pipeline_layout_indices.find(handle);
+
+	if (pipeline_layout_it == pipeline_layout_indices.end())
+	{
+		pipeline_layout_it = pipeline_layout_indices.emplace(handle, to_u32(device->get_resource_cache().get_serialized_index(handle))).first;
+	}
+
+	return pipeline_layout_it->second;
+}
+}        // namespace vkb
@@ -0,0 +1,331 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "command_record.h"
+#include "common/helpers.h"
+#include "common/vk_common.h"
+
+namespace vkb
+{
+class CommandBuffer;
+class Device;
+
+/**
+ * @brief Header of a serialized frame capture, followed by payload_size bytes of payload.
+ *        The checksum covers the payload.
+ */
+struct FrameCaptureHeader
+{
+	static const uint32_t MAGIC = 0x46424B56;        // "VKBF"
+
+	/// Bump whenever the command packets or the serialization of the capture change
+	static const uint32_t VERSION = 1;
+
+	uint32_t magic;
+
+	uint32_t version;
+
+	/// Device and driver the frame was captured with
+	uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+
+	uint64_t payload_size;
+
+	uint64_t checksum;
+};
+
+static_assert(sizeof(FrameCaptureHeader) == 24 + VK_UUID_SIZE, "FrameCaptureHeader must not have padding");
+
+/**
+ * @brief Image used by a captured frame
+ */
+struct CapturedImage
+{
+	VkExtent3D extent;
+
+	VkFormat format;
+
+	VkImageUsageFlags usage;
+
+	VkSampleCountFlagBits samples;
+
+	uint32_t mip_levels;
+
+	uint32_t array_layers;
+
+	/// Render target the image is an attachment of, or FrameCapture::NO_INDEX
+	uint32_t render_target;
+
+	uint32_t attachment;
+};
+
+/**
+ * @brief Buffer written in a captured descriptor set
+ */
+struct CapturedBufferInfo
+{
+	uint32_t buffer;
+
+	uint32_t reserved;
+
+	VkDeviceSize offset;
+
+	VkDeviceSize range;
+};
+
+/**
+ * @brief Image written in a captured descriptor set
+ */
+struct CapturedImageInfo
+{
+	/// Index of the view, or FrameCapture::NO_INDEX for a sampler only
+	uint32_t image_view;
+
+	/// Index of the sampler, or FrameCapture::NO_INDEX for an image only
+	uint32_t sampler;
+
+	VkImageLayout image_layout;
+
+	uint32_t reserved;
+};
+
+/**
+ * @brief Pipeline binding of a captured command stream
+ */
+struct CapturedPipelineBinding
+{
+	uint64_t event_id;
+
+	VkPipelineBindPoint pipeline_bind_point;
+
+	/// Index of the pipeline among the serialized graphics pipelines
+	uint32_t pipeline;
+};
+
+/**
+ * @brief Render pass binding of a captured command stream
+ */
+struct CapturedRenderPassBinding
+{
+	uint64_t event_id;
+
+	uint32_t render_target;
+
+	std::vector<LoadStoreInfo> load_store_infos;
+
+	std::vector<VkClearValue> clear_values;
+
+	/// Attachments and contents of each subpass, without pipeline descriptions
+	std::vector<SubpassDesc> subpasses;
+};
+
+/**
+ * @brief Descriptor set binding of a captured command stream
+ */
+struct CapturedDescriptorSetBinding
+{
+	uint64_t event_id;
+
+	VkPipelineBindPoint pipeline_bind_point;
+
+	uint32_t set_index;
+
+	/// Index of the pipeline layout among the serialized pipeline layouts
+	uint32_t pipeline_layout;
+
+	uint32_t descriptor_set;
+
+	std::vector<uint32_t> dynamic_offsets;
+};
+
+/**
+ * @brief Descriptor set used by a captured frame
+ */
+struct CapturedDescriptorSet
+{
+	/// Index of the pipeline layout the set layout is taken from
+	uint32_t pipeline_layout;
+
+	uint32_t set_index;
+
+	BindingMap<CapturedBufferInfo> buffer_infos;
+
+	BindingMap<CapturedImageInfo> image_infos;
+};
+
+/**
+ * @brief Commands of a captured command buffer, the first stream of a frame is the primary command buffer
+ */
+struct CapturedStream
+{
+	VkCommandBufferUsageFlags usage_flags;
+
+	/// Packets up to the end command, which is recorded again when the stream is replayed
+	std::vector<uint8_t> packets;
+
+	uint64_t packet_count;
+
+	std::vector<CapturedRenderPassBinding> render_pass_bindings;
+
+	std::vector<CapturedPipelineBinding> pipeline_bindings;
+
+	std::vector<CapturedDescriptorSetBinding> descriptor_set_bindings;
+};
+
+/**
+ * @brief Everything needed to replay a frame
+ */
+struct CapturedFrame
+{
+	/// Serialized resource cache, see ResourceCache::serialize
+	std::vector<uint8_t> resources;
+
+	std::vector<CapturedImage> images;
+
+	std::vector<VkDeviceSize> buffer_sizes;
+
+	/// Image of each view used by descriptor sets
+	std::vector<uint32_t> image_views;
+
+	uint32_t sampler_count{0};
+
+	uint32_t render_target_count{0};
+
+	std::vector<CapturedDescriptorSet> descriptor_sets;
+
+	std::vector<CapturedStream> streams;
+};
+
+/**
+ * @brief Serializes the commands of a frame, so that they can be replayed without the scene
+ *        or the sample which recorded them, see FrameReplay.
+ *
+ * A frame is a primary command buffer and the secondary ones it executes. Their command packets are
+ * stored as they are, with the Vulkan handles and command buffer pointers they contain replaced by
+ * indices in the capture. Pipelines and pipeline layouts are indices in the serialized resource cache,
+ * which is stored with the capture.
+ *
+ * The contents of buffers and images are not captured, as the replayed frame is never submitted.
+ * Buffers are sized to cover the ranges the commands use, attachments are described by their render
+ * target and other images by the regions the commands use. Views and samplers written in descriptor
+ * sets only keep their identity, unless they are views of attachments.
+ */
+class FrameCapture
+{
+  public:
+	/// Index of a missing object
+	static constexpr uint32_t NO_INDEX = ~0u;
+
+	/**
+	 * @brief Stores an index in place of a handle or pointer in a command packet
+	 */
+	template <class H>
+	static void set_index(H &handle, uint32_t index)
+	{
+		// Handles are pointers or 64-bit integers depending on the platform, the index is kept in their low bytes
+		uint64_t value = index;
+		std::memcpy(&handle, &value, sizeof(H));
+	}
+
+	/**
+	 * @brief Gets an index stored with set_index
+	 */
+	template <class H>
+	static uint32_t get_index(const H &handle)
+	{
+		uint64_t value = 0;
+		std::memcpy(&value, &handle, sizeof(H));
+		return static_cast<uint32_t>(value);
+	}
+
+	/**
+	 * @brief Captures a primary command buffer, after it is ended and before it is reset
+	 * @return Header and payload, in a single allocation
+	 * @throws std::runtime_error if the frame uses compute pipelines or pipelines which are still compiling
+	 */
+	std::vector<uint8_t> capture(CommandBuffer &command_buffer);
+
+	/**
+	 * @brief Reads a serialized frame capture
+	 * @param data Serialized frame, as returned by capture
+	 * @param size Size of the data in bytes
+	 * @param pipeline_cache_uuid The pipelineCacheUUID of the device the frame is replayed on
+	 * @param frame The frame read from the data
+	 * @return False if the data is invalid or was captured with another device or driver
+	 */
+	static bool load(const uint8_t *data, size_t size, const uint8_t *pipeline_cache_uuid, CapturedFrame &frame);
+
+  private:
+	/**
+	 * @brief Gets the index of a command buffer in the capture, capturing its commands the first time
+	 */
+	uint32_t capture_stream(CommandBuffer &command_buffer);
+
+	/**
+	 * @brief Replaces the handles in command packets with indices in the capture
+	 */
+	void capture_packets(CapturedStream &stream);
+
+	uint32_t capture_render_target(const RenderTarget &render_target);
+
+	uint32_t capture_descriptor_set(const DescriptorSetBinding &binding);
+
+	/**
+	 * @brief Gets the index of a buffer, growing it to cover the range used by a command
+	 */
+	uint32_t capture_buffer(VkBuffer handle, VkDeviceSize required_size);
+
+	/**
+	 * @brief Gets the index of an image, growing images which are not attachments to cover what a command uses
+	 */
+	uint32_t capture_image(VkImage handle, const VkExtent3D &required_extent, uint32_t required_mip_levels, uint32_t required_array_layers);
+
+	uint32_t capture_image_view(VkImageView handle);
+
+	uint32_t capture_sampler(VkSampler handle);
+
+	uint32_t capture_pipeline_layout(VkPipelineLayout handle);
+
+	Device *device{nullptr};
+
+	CapturedFrame frame;
+
+	std::unordered_map<VkBuffer, uint32_t> buffer_indices;
+
+	std::unordered_map<VkImage, uint32_t> image_indices;
+
+	std::unordered_map<VkImageView, uint32_t> image_view_indices;
+
+	std::unordered_map<VkSampler, uint32_t> sampler_indices;
+
+	std::unordered_map<VkPipelineLayout, uint32_t> pipeline_layout_indices;
+
+	std::unordered_map<const RenderTarget *, uint32_t> render_target_indices;
+
+	std::unordered_map<const DescriptorSet *, uint32_t> descriptor_set_indices;
+
+	std::unordered_map<const CommandBuffer *, uint32_t> stream_indices;
+};
+}        // namespace vkb
@@ -0,0 +1,449 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "frame_replay.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "common/logging.h"
+#include "core/command_buffer.h"
+#include "core/device.h"
+#include "resource_cache.h"
+#include "resource_record.h"
+#include "timer.h"
+
+namespace vkb
+{
+FrameReplay::FrameReplay(Device &device) :
+    device{device}
+{
+}
+
+FrameReplay::~FrameReplay()
+{
+	if (!streams.empty())
+	{
+		// The descriptor sets and resources of the frame must not be in use when they are destroyed
+		device.wait_idle();
+
+		for (auto pipeline : resource_replay.get_graphics_pipelines())
+		{
+			device.get_resource_cache().unpin(*pipeline);
+		}
+	}
+
+	if (!render_targets.empty())
+	{
+		// Framebuffers are cached by the handles of their views, which are destroyed with the render targets
+		device.get_resource_cache().clear_framebuffers();
+	}
+}
+
+bool FrameReplay::load(const uint8_t *data, size_t size)
+{
+	assert(streams.empty() && "A frame replay can only load one frame");
+
+	auto pipeline_cache_uuid = device.get_properties().pipelineCacheUUID;
+
+	if (!FrameCapture::load(data, size, pipeline_cache_uuid, frame) ||
+	    !ResourceRecord::validate(frame.resources.data(), frame.resources.size(), pipeline_cache_uuid))
+	{
+		return false;
+	}
+
+	resource_replay.play(device.get_resource_cache(), frame.resources.data(), frame.resources.size());
+
+	create_resources();
+
+	create_streams();
+
+	// The streams bind the cached pipelines in every play without requesting them
+	for (auto pipeline : resource_replay.get_graphics_pipelines())
+	{
+		device.get_resource_cache().pin(*pipeline);
+	}
+
+	LOGI("Loaded a frame of {} command buffers with {} commands", streams.size(), command_count);
+
+	return true;
+}
+
+double FrameReplay::play()
+{
+	assert(!streams.empty() && "A frame must be loaded before it is replayed");
+
+	primary_command_pool->reset_pool();
+	secondary_command_pool->reset_pool();
+
+	// Pools hand out the same command buffers in the same order after a reset, which the packets point to
+	auto &primary_command_buffer = primary_command_pool->request_command_buffer();
+	assert(&primary_command_buffer == command_buffers[0]);
+
+	auto &primary_stream = streams[0];
+
+	primary_command_buffer.begin(primary_stream.usage_flags);
+	primary_command_buffer.get_recorder().load(primary_stream.arena, primary_stream.render_pass_bindings, primary_stream.pipeline_bindings, primary_stream.descriptor_set_bindings);
+
+	// Secondary command buffers inherit the render pass of their primary, so they begin after it is loaded
+	for (size_t i = 1; i < streams.size(); ++i)
+	{
+		auto &command_buffer = secondary_command_pool->request_command_buffer(VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+		assert(&command_buffer == command_buffers[i]);
+
+		auto &stream = streams[i];
+
+		command_buffer.begin(stream.usage_flags, &primary_command_buffer);
+		command_buffer.get_recorder().load(stream.arena, stream.render_pass_bindings, stream.pipeline_bindings, stream.descriptor_set_bindings);
+		command_buffer.end();
+	}
+
+	Timer timer;
+	timer.start();
+
+	// Ending the primary command buffer replays it, along with the secondary command buffers it executes
+	primary_command_buffer.end();
+
+	return timer.stop();
+}
+
+size_t FrameReplay::get_command_count() const
+{
+	return command_count;
+}
+
+void FrameReplay::create_resources()
+{
+	const VkBufferUsageFlags buffer_usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+	                                        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+	                                        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+	                                        VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+
+	buffers.reserve(frame.buffer_sizes.size());
+
+	for (auto buffer_size : frame.buffer_sizes)
+	{
+		buffers.emplace_back(device, std::max<VkDeviceSize>(buffer_size, 1), buffer_usage, VMA_MEMORY_USAGE_GPU_ONLY, 0);
+
+		buffer_handles.push_back(buffers.back().get_handle());
+	}
+
+	// Attachments are moved into their render targets, other images are created on their own
+	std::vector<std::vector<core::Image>> attachments(frame.render_target_count);
+
+	std::vector<core::Image *> image_objects(frame.images.size(), nullptr);
+
+	for (size_t i = 0; i < frame.images.size(); ++i)
+	{
+		auto &captured_image = frame.images[i];
+
+		if (captured_image.render_target == FrameCapture::NO_INDEX)
+		{
+			images.push_back(std::make_unique<core::Image>(device,
+			                                               captured_image.extent,
+			                                               captured_image.format,
+			                                               captured_image.usage,
+			                                               VMA_MEMORY_USAGE_GPU_ONLY,
+			                                               captured_image.samples,
+			                                               captured_image.mip_levels,
+			                                               captured_image.array_layers));
+
+			image_objects[i] = images.back().get();
+		}
+		else
+		{
+			auto &render_target_attachments = attachments.at(captured_image.render_target);
+
+			assert(render_target_attachments.size() == captured_image.attachment && "Attachments are captured in order");
+
+			render_target_attachments.emplace_back(device, captured_image.extent, captured_image.format, captured_image.usage, VMA_MEMORY_USAGE_GPU_ONLY, captured_image.samples);
+		}
+	}
+
+	for (auto &render_target_attachments : attachments)
+	{
+		render_targets.push_back(std::make_unique<RenderTarget>(std::move(render_target_attachments)));
+	}
+
+	image_handles.resize(frame.images.size(), VK_NULL_HANDLE);
+
+	for (size_t i = 0; i < frame.images.size(); ++i)
+	{
+		auto &captured_image = frame.images[i];
+
+		if (captured_image.render_target == FrameCapture::NO_INDEX)
+		{
+			image_handles[i] = image_objects[i]->get_handle();
+		}
+		else
+		{
+			image_handles[i] = render_targets[captured_image.render_target]->get_views().at(captured_image.attachment).get_image().get_handle();
+		}
+	}
+
+	for (auto image_index : frame.image_views)
+	{
+		auto &captured_image = frame.images.at(image_index);
+
+		if (captured_image.render_target == FrameCapture::NO_INDEX)
+		{
+			image_views.push_back(std::make_unique<core::ImageView>(*image_objects[image_index], VK_IMAGE_VIEW_TYPE_2D));
+
+			image_view_handles.push_back(image_views.back()->get_handle());
+		}
+		else
+		{
+			image_view_handles.push_back(render_targets[captured_image.render_target]->get_views().at(captured_image.attachment).get_handle());
+		}
+	}
+
+	VkSamplerCreateInfo sampler_info{VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+	sampler_info.magFilter    = VK_FILTER_LINEAR;
+	sampler_info.minFilter    = VK_FILTER_LINEAR;
+	sampler_info.mipmapMode   = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	sampler_info.maxLod       = VK_LOD_CLAMP_NONE;
+
+	samplers.reserve(frame.sampler_count);
+
+	for (uint32_t i = 0; i < frame.sampler_count; ++i)
+	{
+		samplers.emplace_back(device, sampler_info);
+
+		sampler_handles.push_back(samplers.back().get_handle());
+	}
+
+	auto &pipeline_layouts = resource_replay.get_pipeline_layouts();
+
+	for (auto &captured_descriptor_set : frame.descriptor_sets)
+	{
+		BindingMap<VkDescriptorBufferInfo> buffer_infos;
+		BindingMap<VkDescriptorImageInfo>  image_infos;
+
+		for (auto &binding_it : captured_descriptor_set.buffer_infos)
+		{
+			for (auto &element_it : binding_it.second)
+			{
+				auto &buffer_info = element_it.second;
+
+				buffer_infos[binding_it.first][element_it.first] = {buffer_handles.at(buffer_info.buffer), buffer_info.offset, buffer_info.range};
+			}
+		}
+
+		for (auto &binding_it : captured_descriptor_set.image_infos)
+		{
+			for (auto &element_it : binding_it.second)
+			{
+				auto &image_info = element_it.second;
+
+				image_infos[binding_it.first][element_it.first] = {image_info.sampler != FrameCapture::NO_INDEX ? sampler_handles.at(image_info.sampler) : VK_NULL_HANDLE,
+				                                                   image_info.image_view != FrameCapture::NO_INDEX ? image_view_handles.at(image_info.image_view) : VK_NULL_HANDLE,
+				                                                   image_info.image_layout};
+			}
+		}
+
+		auto &descriptor_set_layout = pipeline_layouts.at(captured_descriptor_set.pipeline_layout)->get_set_layout(captured_descriptor_set.set_index);
+
+		descriptor_sets.push_back(std::make_unique<DescriptorSet>(device, descriptor_set_layout, buffer_infos, image_infos));
+	}
+}
+
+void FrameReplay::create_streams()
+{
+	auto &queue = device.get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT, 0);
+
+	primary_command_pool   = std::make_unique<CommandPool>(device, queue.get_family_index());
+	secondary_command_pool = std::make_unique<CommandPool>(device, queue.get_family_index());
+
+	// Command buffers are requested up front, so that the packets executing them can point to them
+	command_buffers.push_back(&primary_command_pool->request_command_buffer());
+
+	for (size_t i = 1; i < frame.streams.size(); ++i)
+	{
+		command_buffers.push_back(&secondary_command_pool->request_command_buffer(VK_COMMAND_BUFFER_LEVEL_SECONDARY));
+	}
+
+	auto &pipeline_layouts   = resource_replay.get_pipeline_layouts();
+	auto &graphics_pipelines = resource_replay.get_graphics_pipelines();
+
+	auto &resource_cache = device.get_resource_cache();
+
+	for (auto &captured_stream : frame.streams)
+	{
+		Stream stream;
+		stream.usage_flags = captured_stream.usage_flags;
+
+		resolve_packets(captured_stream.packets);
+
+		stream.arena.assign(captured_stream.packets.data(), captured_stream.packets.size(), static_cast<size_t>(captured_stream.packet_count));
+
+		for (auto &captured_binding : captured_stream.render_pass_bindings)
+		{
+			RenderPassBinding render_pass_binding{static_cast<size_t>(captured_binding.event_id), *render_targets.at(captured_binding.render_target)};
+			render_pass_binding.load_store_infos = captured_binding.load_store_infos;
+			render_pass_binding.clear_values     = captured_binding.clear_values;
+			render_pass_binding.subpasses        = captured_binding.subpasses;
+
+			// Resolve the render pass like the recorder does, see CommandRecord::resolve_subpasses
+			std::vector<SubpassInfo> subpasses(render_pass_binding.subpasses.size());
+
+			for (size_t i = 0; i < subpasses.size(); ++i)
+			{
+				subpasses[i].input_attachments  = render_pass_binding.subpasses[i].input_attachments;
+				subpasses[i].output_attachments = render_pass_binding.subpasses[i].output_attachments;
+			}
+
+			render_pass_binding.render_pass = &resource_cache.request_render_pass(render_pass_binding.render_target.get_attachments(), render_pass_binding.load_store_infos, subpasses);
+			render_pass_binding.framebuffer = &resource_cache.request_framebuffer(render_pass_binding.render_target, *render_pass_binding.render_pass);
+
+			stream.render_pass_bindings.push_back(render_pass_binding);
+		}
+
+		for (auto &captured_binding : captured_stream.pipeline_bindings)
+		{
+			stream.pipeline_bindings.push_back({static_cast<size_t>(captured_binding.event_id),
+			                                    captured_binding.pipeline_bind_point,
+			                                    graphics_pipelines.at(captured_binding.pipeline)});
+		}
+
+		for (auto &captured_binding : captured_stream.descriptor_set_bindings)
+		{
+			stream.descriptor_set_bindings.push_back({static_cast<size_t>(captured_binding.event_id),
+			                                          captured_binding.pipeline_bind_point,
+			                                          *pipeline_layouts.at(captured_binding.pipeline_layout),
+			                                          captured_binding.set_index,
+			                                          *descriptor_sets.at(captured_binding.descriptor_set),
+			                                          captured_binding.dynamic_offsets});
+		}
+
+		// Account for the end command, which is recorded again by each play
+		command_count += static_cast<size_t>(captured_stream.packet_count) + 1;
+
+		streams.push_back(std::move(stream));
+	}
+}
+
+void FrameReplay::resolve_packets(std::vector<uint8_t> &packets)
+{
+	uint8_t *data = packets.data();
+
+	size_t offset = 0;
+
+	while (offset < packets.size())
+	{
+		auto &header = *reinterpret_cast<CommandHeader *>(data + offset);
+
+		offset += header.size;
+
+		switch (header.type)
+		{
+			case CommandType::ExecuteCommands:
+			{
+				auto &command                   = reinterpret_cast<ExecuteCommandsCommand &>(header);
+				auto  secondary_command_buffers = CommandArena::get_trailing<CommandBuffer *>(command);
+
+				for (uint32_t i = 0; i < command.command_buffer_count; ++i)
+				{
+					secondary_command_buffers[i] = command_buffers.at(FrameCapture::get_index(secondary_command_buffers[i]));
+				}
+				break;
+			}
+			case CommandType::PushConstants:
+			{
+				auto &command           = reinterpret_cast<PushConstantsCommand &>(header);
+				command.pipeline_layout = resource_replay.get_pipeline_layouts().at(FrameCapture::get_index(command.pipeline_layout))->get_handle();
+				break;
+			}
+			case CommandType::BindVertexBuffers:
+			{
+				auto &command = reinterpret_cast<BindVertexBuffersCommand &>(header);
+				auto  buffers = CommandArena::get_trailing<VkBuffer>(command);
+
+				for (uint32_t i = 0; i < command.binding_count; ++i)
+				{
+					buffers[i] = buffer_handles.at(FrameCapture::get_index(buffers[i]));
+				}
+				break;
+			}
+			case CommandType::BindIndexBuffer:
+			{
+				auto &command  = reinterpret_cast<BindIndexBufferCommand &>(header);
+				command.buffer = buffer_handles.at(FrameCapture::get_index(command.buffer));
+				break;
+			}
+			case CommandType::DrawIndexedIndirect:
+			{
+				auto &command  = reinterpret_cast<DrawIndexedIndirectCommand &>(header);
+				command.buffer = buffer_handles.at(FrameCapture::get_index(command.buffer));
+				break;
+			}
+			case CommandType::DispatchIndirect:
+			{
+				auto &command  = reinterpret_cast<DispatchIndirectCommand &>(header);
+				command.buffer = buffer_handles.at(FrameCapture::get_index(command.buffer));
+				break;
+			}
+			case CommandType::UpdateBuffer:
+			{
+				auto &command  = reinterpret_cast<UpdateBufferCommand &>(header);
+				command.buffer = buffer_handles.at(FrameCapture::get_index(command.buffer));
+				break;
+			}
+			case CommandType::BlitImage:
+			{
+				auto &command     = reinterpret_cast<BlitImageCommand &>(header);
+				command.src_image = image_handles.at(FrameCapture::get_index(command.src_image));
+				command.dst_image = image_handles.at(FrameCapture::get_index(command.dst_image));
+				break;
+			}
+			case CommandType::CopyImage:
+			{
+				auto &command     = reinterpret_cast<CopyImageCommand &>(header);
+				command.src_image = image_handles.at(FrameCapture::get_index(command.src_image));
+				command.dst_image = image_handles.at(FrameCapture::get_index(command.dst_image));
+				break;
+			}
+			case CommandType::CopyBufferToImage:
+			{
+				auto &command  = reinterpret_cast<CopyBufferToImageCommand &>(header);
+				command.buffer = buffer_handles.at(FrameCapture::get_index(command.buffer));
+				command.image  = image_handles.at(FrameCapture::get_index(command.image));
+				break;
+			}
+			case CommandType::ImageMemoryBarrier:
+			{
+				auto &command = reinterpret_cast<ImageMemoryBarrierCommand &>(header);
+				command.image = image_handles.at(FrameCapture::get_index(command.image));
+				break;
+			}
+			case CommandType::BufferMemoryBarrier:
+			{
+				auto &command  = reinterpret_cast<BufferMemoryBarrierCommand &>(header);
+				command.buffer = buffer_handles.at(FrameCapture::get_index(command.buffer));
+				break;
+			}
+			default:
+				break;
+		}
+	}
+}
+}        // namespace vkb
@@ -0,0 +1,143 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "command_arena.h"
+#include "command_record.h"
+#include "core/buffer.h"
+#include "core/command_pool.h"
+#include "core/descriptor_set.h"
+#include "core/image.h"
+#include "core/image_view.h"
+#include "core/sampler.h"
+#include "frame_capture.h"
+#include "rendering/render_target.h"
+#include "resource_replay.h"
+
+namespace vkb
+{
+class Device;
+
+/**
+ * @brief Replays a frame captured with FrameCapture into command buffers which are never submitted,
+ *        to measure the CPU cost of the command replay and of the driver without a scene or a sample.
+ *
+ * Loading creates the resources of the frame: the serialized resource cache is warmed up, buffers
+ * and images are created with undefined contents and descriptor sets are created. The cached pipelines
+ * of the frame are pinned until the replay is destroyed. Each play then records the frame again from
+ * its command packets.
+ */
+class FrameReplay : public NonCopyable
+{
+  public:
+	FrameReplay(Device &device);
+
+	~FrameReplay();
+
+	/**
+	 * @brief Creates the resources of a serialized frame, which can only be loaded once
+	 * @param data Serialized frame, as returned by FrameCapture::capture
+	 * @param size Size of the data in bytes
+	 * @return False if the data is invalid or was captured with another device or driver
+	 */
+	bool load(const uint8_t *data, size_t size);
+
+	/**
+	 * @brief Replays the loaded frame
+	 * @return Time spent replaying the commands into the Vulkan command buffers, in seconds
+	 */
+	double play();
+
+	/**
+	 * @return Number of commands replayed by each play, including the ones of secondary command buffers
+	 */
+	size_t get_command_count() const;
+
+  private:
+	/**
+	 * @brief Commands of a command buffer with their bindings resolved, loaded in its recorder by each play
+	 */
+	struct Stream
+	{
+		VkCommandBufferUsageFlags usage_flags;
+
+		CommandArena arena;
+
+		std::vector<RenderPassBinding> render_pass_bindings;
+
+		std::vector<PipelineBinding> pipeline_bindings;
+
+		std::vector<DescriptorSetBinding> descriptor_set_bindings;
+	};
+
+	void create_resources();
+
+	void create_streams();
+
+	/**
+	 * @brief Replaces the indices in command packets with the handles of the replayed resources
+	 */
+	void resolve_packets(std::vector<uint8_t> &packets);
+
+	Device &device;
+
+	CapturedFrame frame;
+
+	ResourceReplay resource_replay;
+
+	std::vector<core::Buffer> buffers;
+
+	std::vector<std::unique_ptr<core::Image>> images;
+
+	std::vector<std::unique_ptr<RenderTarget>> render_targets;
+
+	std::vector<std::unique_ptr<core::ImageView>> image_views;
+
+	std::vector<core::Sampler> samplers;
+
+	/// Owned instead of requested from the resource cache, as they write the buffers, views and samplers above
+	/// and the cache would keep them after these are destroyed
+	std::vector<std::unique_ptr<DescriptorSet>> descriptor_sets;
+
+	/// Handles replacing the indices of the capture
+	std::vector<VkBuffer> buffer_handles;
+
+	std::vector<VkImage> image_handles;
+
+	std::vector<VkImageView> image_view_handles;
+
+	std::vector<VkSampler> sampler_handles;
+
+	std::unique_ptr<CommandPool> primary_command_pool;
+
+	std::unique_ptr<CommandPool> secondary_command_pool;
+
+	/// Command buffer of each stream, requested again in the same order by each play
+	std::vector<CommandBuffer *> command_buffers;
+
+	std::vector<Stream> streams;
+
+	size_t command_count{0};
+};
+}        // namespace vkb
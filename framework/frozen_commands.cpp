@@ -0,0 +1,130 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "frozen_commands.h"
+
+#include "core/command_buffer.h"
+#include "core/device.h"
+#include "rendering/render_target.h"
+#include "resource_cache.h"
+
+namespace vkb
+{
+FrozenCommands::FrozenCommands(CommandBuffer &command_buffer, size_t inputs_hash) :
+    resource_cache{command_buffer.get_device().get_resource_cache()},
+    record{command_buffer.get_recorder()},
+    inputs_hash{inputs_hash},
+    cache_generation{resource_cache.get_generation()}
+{
+	assert(command_buffer.level == VK_COMMAND_BUFFER_LEVEL_SECONDARY && "Only secondary command buffers can be frozen");
+	assert(command_buffer.get_state() == CommandBuffer::State::Executable && "Command buffer must be ended before freezing it");
+
+	auto &render_target = record.get_render_pass_bindings().back().render_target;
+
+	this->render_target = &render_target;
+
+	extent = render_target.get_extent();
+
+	for (auto &view : render_target.get_views())
+	{
+		views.push_back(view.get_handle());
+	}
+
+	pin_pipelines();
+
+	for (auto &descriptor_set_binding : record.get_descriptor_set_bindings())
+	{
+		resource_cache.pin(descriptor_set_binding.descriptor_set);
+	}
+}
+
+FrozenCommands::~FrozenCommands()
+{
+	unpin_pipelines();
+
+	for (auto &descriptor_set_binding : record.get_descriptor_set_bindings())
+	{
+		resource_cache.unpin(descriptor_set_binding.descriptor_set);
+	}
+}
+
+bool FrozenCommands::is_valid(size_t inputs_hash, const RenderTarget &render_target) const
+{
+	if (this->inputs_hash != inputs_hash || this->render_target != &render_target)
+	{
+		return false;
+	}
+
+	if (cache_generation != resource_cache.get_generation())
+	{
+		return false;
+	}
+
+	if (extent.width != render_target.get_extent().width || extent.height != render_target.get_extent().height)
+	{
+		return false;
+	}
+
+	auto &current_views = render_target.get_views();
+
+	if (views.size() != current_views.size())
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < views.size(); ++i)
+	{
+		if (views[i] != current_views[i].get_handle())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+CommandRecord &FrozenCommands::get_record()
+{
+	return record;
+}
+
+void FrozenCommands::pin_pipelines()
+{
+	for (auto &pipeline_binding : record.get_pipeline_bindings())
+	{
+		// Pipelines still compiling asynchronously are not bound
+		if (pipeline_binding.pipeline)
+		{
+			resource_cache.pin(*pipeline_binding.pipeline);
+		}
+	}
+}
+
+void FrozenCommands::unpin_pipelines()
+{
+	for (auto &pipeline_binding : record.get_pipeline_bindings())
+	{
+		if (pipeline_binding.pipeline)
+		{
+			resource_cache.unpin(*pipeline_binding.pipeline);
+		}
+	}
+}
+}        // namespace vkb
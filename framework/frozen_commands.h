@@ -0,0 +1,102 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "command_record.h"
+#include "common/helpers.h"
+#include "common/vk_common.h"
+
+namespace vkb
+{
+class CommandBuffer;
+class RenderTarget;
+class ResourceCache;
+
+/**
+ * @brief Commands recorded once in a secondary command buffer and replayed in later frames
+ *
+ * Freezing keeps the packets and the resolved pipelines and descriptor sets of a recording,
+ * so replaying it into a new secondary command buffer only costs the Vulkan calls. The
+ * pipelines are resolved again only if the render pass it is executed in changes.
+ *
+ * The commands must not reference per-frame allocations, as those are recycled. The cached
+ * pipelines and descriptor sets they bind are pinned, so that a ResourceCacheBudget does not
+ * evict them while they are frozen. Everything else they
+ * depend on (pipeline state, buffers) is described by a hash chosen by the owner, which records
+ * the commands again when the hash changes. The render target they were recorded for is checked
+ * by is_valid too, as the frozen render pass binding refers to it, and so is the generation of
+ * the resource cache, as clearing or evicting cached objects may destroy the ones they bind.
+ */
+class FrozenCommands : public NonCopyable
+{
+  public:
+	/**
+	 * @brief Freezes the commands of a secondary command buffer
+	 * @param command_buffer Secondary command buffer which was ended and passed to CommandBuffer::execute_commands,
+	 *        so that its pipelines are resolved
+	 * @param inputs_hash Hash of the state and resources the commands depend on
+	 */
+	FrozenCommands(CommandBuffer &command_buffer, size_t inputs_hash);
+
+	/**
+	 * @brief Unpins the cached resources of the commands
+	 */
+	~FrozenCommands();
+
+	/**
+	 * @param inputs_hash Hash of the state and resources the commands would be recorded with now
+	 * @param render_target Render target the commands would be executed for now
+	 * @return True if the commands were frozen with the same inputs and render target, no cached object was
+	 *         destroyed since, and they can be replayed
+	 */
+	bool is_valid(size_t inputs_hash, const RenderTarget &render_target) const;
+
+	CommandRecord &get_record();
+
+	/**
+	 * @brief Pins the pipelines of the record, after they are resolved for a render pass
+	 */
+	void pin_pipelines();
+
+	/**
+	 * @brief Unpins the pipelines of the record, before they are resolved again for another render pass
+	 */
+	void unpin_pipelines();
+
+  private:
+	ResourceCache &resource_cache;
+
+	CommandRecord record;
+
+	size_t inputs_hash;
+
+	/// Generation of the resource cache when the commands were frozen
+	uint64_t cache_generation;
+
+	/// Render target of the recording, only compared as it may have been destroyed since
+	const RenderTarget *render_target;
+
+	VkExtent2D extent;
+
+	/// Views of the render target, which change when it is re-created in place
+	std::vector<VkImageView> views;
+};
+}        // namespace vkb
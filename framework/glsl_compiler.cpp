@@ -136,4 +136,24 @@ bool GLSLCompiler::compile_to_spirv(VkShaderStageFlagBits       stage,
 
 	return true;
 }
+
+std::string GLSLCompiler::get_version()
+{
+	std::string version = "glslang";
+
+#if defined(GLSLANG_MINOR_VERSION)
+	version += "." + std::to_string(GLSLANG_MINOR_VERSION);
+#endif
+#if defined(GLSLANG_PATCH_LEVEL)
+	version += "." + std::to_string(GLSLANG_PATCH_LEVEL);
+#endif
+#if defined(GLSLANG_REVISION)
+	version += std::string{"."} + GLSLANG_REVISION;
+#endif
+#if defined(GLSLANG_DATE)
+	version += std::string{"."} + GLSLANG_DATE;
+#endif
+
+	return version;
+}
 }        // namespace vkb
@@ -54,5 +54,11 @@ class GLSLCompiler
 	                      const ShaderVariant &       shader_variant,
 	                      std::vector<std::uint32_t> &spirv,
 	                      std::string &               info_log);
+
+	/**
+	 * @brief Identifies the glslang build the SPIRV code was generated with
+	 * @return A version string which changes whenever the compiler output may change
+	 */
+	static std::string get_version();
 };
 }        // namespace vkb
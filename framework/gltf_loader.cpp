@@ -35,6 +35,7 @@ VKBP_ENABLE_WARNINGS()
 #include "core/device.h"
 #include "core/image.h"
 #include "platform/filesystem.h"
+#include "scene_graph/components/bvh.h"
 #include "scene_graph/components/image/astc.h"
 #include "scene_graph/components/perspective_camera.h"
 #include "scene_graph/components/texture.h"
@@ -633,6 +634,9 @@ sg::Scene GLTFLoader::load_scene()
 	scene.add_child(*camera_node);
 	scene.add_node(std::move(camera_node));
 
+	// Hierarchy over the world bounds of the mesh nodes, used to cull them
+	scene.add_component(std::make_unique<sg::BVH>(meshes));
+
 	return scene;
 }
 
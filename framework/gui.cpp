@@ -130,7 +130,7 @@ Gui::Gui(RenderContext &render_context, const float dpi_factor) :
 	// Upload font data into the vulkan image memory
 	{
 		core::Buffer stage_buffer{device, upload_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY, 0};
-		stage_buffer.update({font_data, font_data + upload_size});
+		stage_buffer.update(font_data, upload_size);
 
 		auto &command_buffer = device.request_command_buffer();
 
@@ -237,25 +237,26 @@ void Gui::update_buffers(CommandBuffer &command_buffer)
 		return;
 	}
 
-	std::vector<uint8_t> vertex_data(vertex_buffer_size);
-	std::vector<uint8_t> index_data(index_buffer_size);
+	auto vertex_allocation = render_context.get_active_frame().allocate_buffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertex_buffer_size);
+	auto index_allocation  = render_context.get_active_frame().allocate_buffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT, index_buffer_size);
 
-	// Upload data
-	ImDrawVert *vtx_dst = (ImDrawVert *) vertex_data.data();
-	ImDrawIdx * idx_dst = (ImDrawIdx *) index_data.data();
+	// Upload data of each draw list straight into the allocations
+	uint32_t vtx_offset = 0;
+	uint32_t idx_offset = 0;
 
 	for (int n = 0; n < draw_data->CmdListsCount; n++)
 	{
 		const ImDrawList *cmd_list = draw_data->CmdLists[n];
-		memcpy(vtx_dst, cmd_list->VtxBuffer.Data, cmd_list->VtxBuffer.Size * sizeof(ImDrawVert));
-		memcpy(idx_dst, cmd_list->IdxBuffer.Data, cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx));
-		vtx_dst += cmd_list->VtxBuffer.Size;
-		idx_dst += cmd_list->IdxBuffer.Size;
-	}
 
-	auto vertex_allocation = render_context.get_active_frame().allocate_buffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertex_buffer_size);
+		size_t vtx_size = cmd_list->VtxBuffer.Size * sizeof(ImDrawVert);
+		size_t idx_size = cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx);
 
-	vertex_allocation.update(vertex_data);
+		vertex_allocation.update(reinterpret_cast<const uint8_t *>(cmd_list->VtxBuffer.Data), vtx_size, vtx_offset);
+		index_allocation.update(reinterpret_cast<const uint8_t *>(cmd_list->IdxBuffer.Data), idx_size, idx_offset);
+
+		vtx_offset += to_u32(vtx_size);
+		idx_offset += to_u32(idx_size);
+	}
 
 	std::vector<std::reference_wrapper<const core::Buffer>> buffers;
 	buffers.emplace_back(std::ref(vertex_allocation.get_buffer()));
@@ -264,10 +265,6 @@ void Gui::update_buffers(CommandBuffer &command_buffer)
 
 	command_buffer.bind_vertex_buffers(0, buffers, offsets);
 
-	auto index_allocation = render_context.get_active_frame().allocate_buffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT, index_buffer_size);
-
-	index_allocation.update(index_data);
-
 	command_buffer.bind_index_buffer(index_allocation.get_buffer(), index_allocation.get_offset(), VK_INDEX_TYPE_UINT16);
 }
 
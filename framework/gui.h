@@ -172,7 +172,17 @@ class Gui
 		      /* scale_factor = */ 1.0f / (1024.0f * 1024.0f)}},
 		    {StatIndex::l2_ext_write_bytes,
 		     {/* label = */ "Ext write bw: {:4.1f} MiB/s",
-		      /* scale_factor = */ 1.0f / (1024.0f * 1024.0f)}}};
+		      /* scale_factor = */ 1.0f / (1024.0f * 1024.0f)}},
+		    {StatIndex::removed_state_calls,
+		     {/* label = */ "Removed calls: {:4.0f}/frame"}},
+		    {StatIndex::pipeline_binds,
+		     {/* label = */ "Pipeline binds: {:4.0f}/frame"}},
+		    {StatIndex::descriptor_set_switches,
+		     {/* label = */ "Set switches: {:4.0f}/frame"}},
+		    {StatIndex::visible_draws,
+		     {/* label = */ "Visible draws: {:4.0f}/frame"}},
+		    {StatIndex::culled_draws,
+		     {/* label = */ "Culled draws: {:4.0f}/frame"}}};
 
 		float graph_height{50.0f};
 
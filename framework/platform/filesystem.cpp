@@ -169,6 +169,21 @@ void write_temp(const std::vector<uint8_t> &data, const std::string &filename, c
 	write_binary_file(data, path::get(path::Type::Temp) + filename, count);
 }
 
+const uint8_t *MappedFile::get_data() const
+{
+	return data;
+}
+
+size_t MappedFile::get_size() const
+{
+	return size;
+}
+
+std::unique_ptr<MappedFile> map_temp(const std::string &filename)
+{
+	return std::make_unique<MappedFile>(path::get(path::Type::Temp) + filename);
+}
+
 void write_image(const uint8_t *data, const std::string &filename, const uint32_t width, const uint32_t height, const uint32_t components, const uint32_t row_stride)
 {
 	stbi_write_png((path::get(path::Type::Screenshots) + filename + ".png").c_str(), width, height, components, data, row_stride);
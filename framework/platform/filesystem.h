@@ -23,6 +23,7 @@
 #include <cstdint>
 #include <cstdlib>
 #include <fstream>
+#include <memory>
 #include <string>
 #include <sys/stat.h>
 #include <unordered_map>
@@ -109,6 +110,47 @@ std::vector<uint8_t> read_temp(const std::string &filename, const uint32_t count
  */
 void write_temp(const std::vector<uint8_t> &data, const std::string &filename, const uint32_t count = 0);
 
+/**
+ * @brief Read-only memory mapping of a whole file, the data stays valid for the lifetime of the object
+ */
+class MappedFile
+{
+  public:
+	/**
+	 * @brief Platform specific implementation to map a file
+	 * @param filename The full path to the file
+	 * @throws runtime_error if the file cannot be opened or mapped
+	 */
+	MappedFile(const std::string &filename);
+
+	MappedFile(const MappedFile &) = delete;
+
+	/**
+	 * @brief Platform specific implementation to unmap the file
+	 */
+	~MappedFile();
+
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	const uint8_t *get_data() const;
+
+	size_t get_size() const;
+
+  private:
+	const uint8_t *data{nullptr};
+
+	size_t size{0};
+};
+
+/**
+ * @brief Helper to map a temporary file into memory, without reading it
+ *
+ * @param filename The path to the file (relative to the temporary storage directory)
+ * @throws runtime_error if the file cannot be opened or mapped
+ * @return The mapped file
+ */
+std::unique_ptr<MappedFile> map_temp(const std::string &filename);
+
 /**
  * @brief Helper to write to a png image in permanent storage
  *
@@ -20,6 +20,11 @@
 
 #include "linux_platform.h"
 
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+
 namespace vkb
 {
 namespace
@@ -46,6 +51,49 @@ void create_directory(const std::string &path)
 		mkdir(path.c_str(), 0777);
 	}
 }
+
+MappedFile::MappedFile(const std::string &filename)
+{
+	int file = open(filename.c_str(), O_RDONLY);
+
+	if (file < 0)
+	{
+		throw std::runtime_error("Failed to open file: " + filename);
+	}
+
+	struct stat info;
+	if (fstat(file, &info) != 0)
+	{
+		close(file);
+		throw std::runtime_error("Failed to get size of file: " + filename);
+	}
+
+	size = static_cast<size_t>(info.st_size);
+
+	if (size > 0)
+	{
+		void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+
+		if (mapping == MAP_FAILED)
+		{
+			close(file);
+			throw std::runtime_error("Failed to map file: " + filename);
+		}
+
+		data = static_cast<const uint8_t *>(mapping);
+	}
+
+	// The mapping stays valid once the file is closed
+	close(file);
+}
+
+MappedFile::~MappedFile()
+{
+	if (data)
+	{
+		munmap(const_cast<uint8_t *>(data), size);
+	}
+}
 }        // namespace fs
 
 LinuxPlatform::LinuxPlatform(int argc, char **argv)
@@ -56,6 +56,51 @@ void create_directory(const std::string &path)
 		CreateDirectory(path.c_str(), NULL);
 	}
 }
+
+MappedFile::MappedFile(const std::string &filename)
+{
+	HANDLE file = CreateFile(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error("Failed to open file: " + filename);
+	}
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size))
+	{
+		CloseHandle(file);
+		throw std::runtime_error("Failed to get size of file: " + filename);
+	}
+
+	size = static_cast<size_t>(file_size.QuadPart);
+
+	if (size > 0)
+	{
+		// The view keeps the mapping alive once its handle is closed
+		if (HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL))
+		{
+			data = static_cast<const uint8_t *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+			CloseHandle(mapping);
+		}
+
+		if (!data)
+		{
+			CloseHandle(file);
+			throw std::runtime_error("Failed to map file: " + filename);
+		}
+	}
+
+	CloseHandle(file);
+}
+
+MappedFile::~MappedFile()
+{
+	if (data)
+	{
+		UnmapViewOfFile(data);
+	}
+}
 }        // namespace fs
 
 WindowsPlatform::WindowsPlatform(HINSTANCE /*hInstance*/, HINSTANCE /*hPrevInstance*/,
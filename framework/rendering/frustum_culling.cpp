@@ -0,0 +1,211 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "rendering/frustum_culling.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define VKB_CULLING_SSE
+#	include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#	define VKB_CULLING_NEON
+#	include <arm_neon.h>
+#endif
+
+namespace vkb
+{
+namespace
+{
+/// Boxes tested by one iteration of the culling loop
+constexpr size_t BATCH_SIZE = 4;
+}        // namespace
+
+void transform_bounds(const glm::vec3 &min, const glm::vec3 &max, const glm::mat4 &transform, glm::vec3 &center, glm::vec3 &extent)
+{
+	center = glm::vec3(transform * glm::vec4((min + max) * 0.5f, 1.0f));
+
+	// The extent along each world axis is the sum of the transformed local extents projected on it
+	glm::vec3 local_extent = (max - min) * 0.5f;
+
+	extent = glm::abs(glm::vec3(transform[0])) * local_extent.x +
+	         glm::abs(glm::vec3(transform[1])) * local_extent.y +
+	         glm::abs(glm::vec3(transform[2])) * local_extent.z;
+}
+
+Frustum::Frustum(const glm::mat4 &view_proj)
+{
+	// Rows of the matrix, glm matrices are stored by column
+	glm::vec4 row_x{view_proj[0][0], view_proj[1][0], view_proj[2][0], view_proj[3][0]};
+	glm::vec4 row_y{view_proj[0][1], view_proj[1][1], view_proj[2][1], view_proj[3][1]};
+	glm::vec4 row_z{view_proj[0][2], view_proj[1][2], view_proj[2][2], view_proj[3][2]};
+	glm::vec4 row_w{view_proj[0][3], view_proj[1][3], view_proj[2][3], view_proj[3][3]};
+
+	// -w <= x <= w, -w <= y <= w and 0 <= z <= w in clip space
+	planes[0] = row_w + row_x;
+	planes[1] = row_w - row_x;
+	planes[2] = row_w + row_y;
+	planes[3] = row_w - row_y;
+	planes[4] = row_z;
+	planes[5] = row_w - row_z;
+
+	for (auto &plane : planes)
+	{
+		plane /= glm::length(glm::vec3(plane));
+	}
+}
+
+const std::array<glm::vec4, 6> &Frustum::get_planes() const
+{
+	return planes;
+}
+
+void BoundsCuller::clear()
+{
+	count = 0;
+}
+
+size_t BoundsCuller::add(const glm::vec3 &center, const glm::vec3 &extent)
+{
+	if (count == center_x.size())
+	{
+		for (auto *values : {&center_x, &center_y, &center_z, &extent_x, &extent_y, &extent_z})
+		{
+			values->resize(count + BATCH_SIZE);
+		}
+	}
+
+	center_x[count] = center.x;
+	center_y[count] = center.y;
+	center_z[count] = center.z;
+	extent_x[count] = extent.x;
+	extent_y[count] = extent.y;
+	extent_z[count] = extent.z;
+
+	return count++;
+}
+
+size_t BoundsCuller::size() const
+{
+	return count;
+}
+
+glm::vec3 BoundsCuller::get_center(size_t index) const
+{
+	return {center_x[index], center_y[index], center_z[index]};
+}
+
+void BoundsCuller::cull(const Frustum &frustum, std::vector<uint8_t> &visible) const
+{
+	visible.resize(count);
+
+	auto &planes = frustum.get_planes();
+
+	// A box is outside when its center is further behind a plane than the box reaches towards it
+	std::array<glm::vec3, 6> abs_normals;
+
+	for (size_t i = 0; i < planes.size(); ++i)
+	{
+		abs_normals[i] = glm::abs(glm::vec3(planes[i]));
+	}
+
+	// The lanes past the last box read padding, their results are dropped
+	for (size_t i = 0; i < count; i += BATCH_SIZE)
+	{
+		uint32_t inside_mask = 0;
+
+#if defined(VKB_CULLING_SSE)
+		__m128 cx = _mm_loadu_ps(&center_x[i]);
+		__m128 cy = _mm_loadu_ps(&center_y[i]);
+		__m128 cz = _mm_loadu_ps(&center_z[i]);
+		__m128 ex = _mm_loadu_ps(&extent_x[i]);
+		__m128 ey = _mm_loadu_ps(&extent_y[i]);
+		__m128 ez = _mm_loadu_ps(&extent_z[i]);
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+		for (size_t p = 0; p < planes.size(); ++p)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(planes[p].x)),
+			                                        _mm_mul_ps(cy, _mm_set1_ps(planes[p].y))),
+			                             _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(planes[p].z)),
+			                                        _mm_set1_ps(planes[p].w)));
+
+			__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(abs_normals[p].x)),
+			                                      _mm_mul_ps(ey, _mm_set1_ps(abs_normals[p].y))),
+			                           _mm_mul_ps(ez, _mm_set1_ps(abs_normals[p].z)));
+
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+		}
+
+		inside_mask = static_cast<uint32_t>(_mm_movemask_ps(inside));
+#elif defined(VKB_CULLING_NEON)
+		float32x4_t cx = vld1q_f32(&center_x[i]);
+		float32x4_t cy = vld1q_f32(&center_y[i]);
+		float32x4_t cz = vld1q_f32(&center_z[i]);
+		float32x4_t ex = vld1q_f32(&extent_x[i]);
+		float32x4_t ey = vld1q_f32(&extent_y[i]);
+		float32x4_t ez = vld1q_f32(&extent_z[i]);
+
+		uint32x4_t inside = vdupq_n_u32(~0u);
+
+		for (size_t p = 0; p < planes.size(); ++p)
+		{
+			float32x4_t distance = vdupq_n_f32(planes[p].w);
+			distance             = vmlaq_n_f32(distance, cx, planes[p].x);
+			distance             = vmlaq_n_f32(distance, cy, planes[p].y);
+			distance             = vmlaq_n_f32(distance, cz, planes[p].z);
+
+			float32x4_t radius = vmulq_n_f32(ex, abs_normals[p].x);
+			radius             = vmlaq_n_f32(radius, ey, abs_normals[p].y);
+			radius             = vmlaq_n_f32(radius, ez, abs_normals[p].z);
+
+			inside = vandq_u32(inside, vcgeq_f32(vaddq_f32(distance, radius), vdupq_n_f32(0.0f)));
+		}
+
+		uint32_t lanes[BATCH_SIZE];
+		vst1q_u32(lanes, inside);
+
+		for (size_t lane = 0; lane < BATCH_SIZE; ++lane)
+		{
+			inside_mask |= (lanes[lane] & 1u) << lane;
+		}
+#else
+		for (size_t lane = 0; lane < BATCH_SIZE; ++lane)
+		{
+			glm::vec3 center{center_x[i + lane], center_y[i + lane], center_z[i + lane]};
+			glm::vec3 extent{extent_x[i + lane], extent_y[i + lane], extent_z[i + lane]};
+
+			bool inside = true;
+
+			for (size_t p = 0; p < planes.size(); ++p)
+			{
+				inside = inside && glm::dot(glm::vec3(planes[p]), center) + planes[p].w + glm::dot(abs_normals[p], extent) >= 0.0f;
+			}
+
+			inside_mask |= static_cast<uint32_t>(inside) << lane;
+		}
+#endif
+
+		for (size_t lane = 0; lane < BATCH_SIZE && i + lane < count; ++lane)
+		{
+			visible[i + lane] = static_cast<uint8_t>((inside_mask >> lane) & 1u);
+		}
+	}
+}
+}        // namespace vkb
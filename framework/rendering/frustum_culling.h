@@ -0,0 +1,114 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "common/error.h"
+
+VKBP_DISABLE_WARNINGS()
+#include <glm/glm.hpp>
+VKBP_ENABLE_WARNINGS()
+
+namespace vkb
+{
+/**
+ * @brief Computes the world space bounds of a box transformed by a matrix
+ * @param min Minimum corner of the box
+ * @param max Maximum corner of the box
+ * @param transform Matrix transforming the box to world space
+ * @param center Center of the world space bounds
+ * @param extent Half size of the world space bounds along each axis
+ */
+void transform_bounds(const glm::vec3 &min, const glm::vec3 &max, const glm::mat4 &transform, glm::vec3 &center, glm::vec3 &extent);
+
+/**
+ * @brief Planes of a view frustum, with normals pointing inside
+ */
+class Frustum
+{
+  public:
+	/**
+	 * @brief Extracts the planes of a view projection matrix with a [0, 1] depth range
+	 * @param view_proj Projection matrix multiplied by the view matrix
+	 */
+	Frustum(const glm::mat4 &view_proj);
+
+	const std::array<glm::vec4, 6> &get_planes() const;
+
+  private:
+	std::array<glm::vec4, 6> planes;
+};
+
+/**
+ * @brief World space bounding boxes stored as a structure of arrays,
+ *        which are tested against a frustum four at a time with SSE or NEON when available
+ */
+class BoundsCuller
+{
+  public:
+	/**
+	 * @brief Removes the boxes, keeping the memory for the next ones
+	 */
+	void clear();
+
+	/**
+	 * @brief Adds a world space box
+	 * @param center Center of the box
+	 * @param extent Half size of the box along each axis
+	 * @return Index of the box
+	 */
+	size_t add(const glm::vec3 &center, const glm::vec3 &extent);
+
+	size_t size() const;
+
+	/**
+	 * @return World space center of a box
+	 */
+	glm::vec3 get_center(size_t index) const;
+
+	/**
+	 * @brief Tests every box against the frustum
+	 * @param frustum Frustum to test the boxes against
+	 * @param visible Resized to the number of boxes, set to 1 for the boxes intersecting the frustum and 0 for the others
+	 */
+	void cull(const Frustum &frustum, std::vector<uint8_t> &visible) const;
+
+  private:
+	/// Boxes in the arrays, which are padded to a multiple of the batch size
+	size_t count{0};
+
+	std::vector<float> center_x;
+
+	std::vector<float> center_y;
+
+	std::vector<float> center_z;
+
+	/// Half size of the boxes along each axis
+	std::vector<float> extent_x;
+
+	std::vector<float> extent_y;
+
+	std::vector<float> extent_z;
+};
+}        // namespace vkb
@@ -0,0 +1,321 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "rendering/indirect_culling.h"
+
+#include <algorithm>
+
+#include "common/helpers.h"
+#include "core/command_buffer.h"
+#include "core/device.h"
+#include "platform/filesystem.h"
+#include "rendering/render_context.h"
+
+namespace vkb
+{
+namespace
+{
+/// Invocations of a workgroup of the culling shader
+constexpr uint32_t CULLING_GROUP_SIZE = 64;
+}        // namespace
+
+IndirectCulling::IndirectCulling(RenderContext &render_context) :
+    render_context{render_context},
+    compute_source{fs::read_asset("shaders/scene_culling.comp")}
+{
+}
+
+IndirectCulling::~IndirectCulling()
+{
+	release_buffers();
+}
+
+void IndirectCulling::release_buffers()
+{
+	std::vector<VkBuffer> buffers;
+
+	if (instance_draw_buffer)
+	{
+		buffers.push_back(instance_draw_buffer->get_handle());
+		buffers.push_back(first_visible_instance_buffer->get_handle());
+	}
+
+	for (auto &frame : frame_buffers)
+	{
+		if (frame.bounds_buffer)
+		{
+			buffers.push_back(frame.bounds_buffer->get_handle());
+			buffers.push_back(frame.model_buffer->get_handle());
+			buffers.push_back(frame.indirect_buffer->get_handle());
+			buffers.push_back(frame.visible_instance_buffer->get_handle());
+		}
+	}
+
+	// The descriptor sets would outlive the buffers in the shared cache, and a new buffer could get the same handle
+	if (!buffers.empty())
+	{
+		render_context.get_device().get_resource_cache().clear_descriptor_sets(buffers);
+	}
+
+	frame_buffers.clear();
+	active_frame_buffers = nullptr;
+
+	instance_draw_buffer.reset();
+	first_visible_instance_buffer.reset();
+}
+
+void IndirectCulling::set_draws(const std::vector<VkDrawIndexedIndirectCommand> &new_commands, const std::vector<uint32_t> &instance_draws)
+{
+	// The buffers are sized for the previous draws
+	release_buffers();
+
+	commands       = new_commands;
+	instance_count = to_u32(instance_draws.size());
+
+	first_visible_instances.assign(commands.size(), 0);
+
+	visible_instance_count = 0;
+
+	if (instance_draws.empty())
+	{
+		return;
+	}
+
+	std::vector<uint32_t> draw_instance_counts(commands.size(), 0);
+
+	for (auto draw_index : instance_draws)
+	{
+		++draw_instance_counts[draw_index];
+	}
+
+	// The visible instances of a draw are packed in a range as large as all of its instances.
+	// The range is given to the shaders separately, so that the first instance can stay 0.
+	uint32_t first_visible_instance = 0;
+
+	for (size_t i = 0; i < commands.size(); ++i)
+	{
+		commands[i].instanceCount = 0;
+		commands[i].firstInstance = 0;
+
+		first_visible_instances[i] = first_visible_instance;
+
+		first_visible_instance += draw_instance_counts[i];
+	}
+
+	auto instance_draws_size = instance_draws.size() * sizeof(uint32_t);
+
+	instance_draw_buffer = std::make_unique<core::Buffer>(render_context.get_device(),
+	                                                      instance_draws_size,
+	                                                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+	                                                      VMA_MEMORY_USAGE_CPU_TO_GPU,
+	                                                      VMA_ALLOCATION_CREATE_MAPPED_BIT);
+
+	instance_draw_buffer->update(reinterpret_cast<const uint8_t *>(instance_draws.data()), instance_draws_size);
+
+	auto first_visible_instances_size = first_visible_instances.size() * sizeof(uint32_t);
+
+	first_visible_instance_buffer = std::make_unique<core::Buffer>(render_context.get_device(),
+	                                                               first_visible_instances_size,
+	                                                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+	                                                               VMA_MEMORY_USAGE_CPU_TO_GPU,
+	                                                               VMA_ALLOCATION_CREATE_MAPPED_BIT);
+
+	first_visible_instance_buffer->update(reinterpret_cast<const uint8_t *>(first_visible_instances.data()), first_visible_instances_size);
+}
+
+void IndirectCulling::set_instances(std::vector<glm::mat4> &&new_models, std::vector<InstanceBounds> &&new_bounds)
+{
+	assert(new_models.size() == instance_count && new_bounds.size() == instance_count && "There must be one matrix and bounding box per instance");
+
+	models = std::move(new_models);
+	bounds = std::move(new_bounds);
+
+	++instances_revision;
+}
+
+uint32_t IndirectCulling::get_draw_count() const
+{
+	return to_u32(commands.size());
+}
+
+uint32_t IndirectCulling::get_instance_count() const
+{
+	return instance_count;
+}
+
+uint32_t IndirectCulling::get_first_visible_instance(size_t draw_index) const
+{
+	return first_visible_instances[draw_index];
+}
+
+void IndirectCulling::cull(CommandBuffer &command_buffer, const Frustum *frustum)
+{
+	active_frame_buffers = nullptr;
+
+	if (instance_count == 0)
+	{
+		return;
+	}
+
+	auto &device = render_context.get_device();
+
+	// Buffers of a frame are not in use by the GPU anymore once the frame is active again
+	auto frame_index = render_context.get_active_frame_index();
+
+	if (frame_buffers.size() <= frame_index)
+	{
+		frame_buffers.resize(frame_index + 1);
+	}
+
+	auto &frame = frame_buffers[frame_index];
+
+	auto bounds_size   = bounds.size() * sizeof(InstanceBounds);
+	auto models_size   = models.size() * sizeof(glm::mat4);
+	auto commands_size = commands.size() * sizeof(VkDrawIndexedIndirectCommand);
+
+	if (!frame.bounds_buffer)
+	{
+		frame.bounds_buffer = std::make_unique<core::Buffer>(device,
+		                                                     bounds_size,
+		                                                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		                                                     VMA_MEMORY_USAGE_CPU_TO_GPU,
+		                                                     VMA_ALLOCATION_CREATE_MAPPED_BIT);
+
+		frame.model_buffer = std::make_unique<core::Buffer>(device,
+		                                                    models_size,
+		                                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		                                                    VMA_MEMORY_USAGE_CPU_TO_GPU,
+		                                                    VMA_ALLOCATION_CREATE_MAPPED_BIT);
+
+		frame.indirect_buffer = std::make_unique<core::Buffer>(device,
+		                                                       commands_size,
+		                                                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+		                                                       VMA_MEMORY_USAGE_GPU_TO_CPU,
+		                                                       VMA_ALLOCATION_CREATE_MAPPED_BIT);
+
+		frame.visible_instance_buffer = std::make_unique<core::Buffer>(device,
+		                                                               instance_count * sizeof(uint32_t),
+		                                                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		                                                               VMA_MEMORY_USAGE_GPU_ONLY,
+		                                                               0);
+
+		// Forces the first upload
+		frame.instances_revision = instances_revision - 1;
+	}
+
+	if (frame.culled)
+	{
+		vmaInvalidateAllocation(device.get_memory_allocator(), frame.indirect_buffer->get_memory(), 0, commands_size);
+
+		auto culled_commands = reinterpret_cast<const VkDrawIndexedIndirectCommand *>(frame.indirect_buffer->get_data());
+
+		visible_instance_count = 0;
+
+		for (size_t i = 0; i < commands.size(); ++i)
+		{
+			visible_instance_count += culled_commands[i].instanceCount;
+		}
+	}
+
+	if (frame.instances_revision != instances_revision)
+	{
+		frame.bounds_buffer->update(reinterpret_cast<const uint8_t *>(bounds.data()), bounds_size);
+		frame.model_buffer->update(reinterpret_cast<const uint8_t *>(models.data()), models_size);
+
+		frame.instances_revision = instances_revision;
+	}
+
+	// The shader counts the visible instances from zero
+	frame.indirect_buffer->update(reinterpret_cast<const uint8_t *>(commands.data()), commands_size);
+
+	frame.culled = true;
+
+	active_frame_buffers = &frame;
+
+	auto &compute_module = device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_COMPUTE_BIT, compute_source, compute_variant);
+
+	auto &pipeline_layout = device.get_resource_cache().request_pipeline_layout({&compute_module});
+
+	command_buffer.bind_pipeline_layout(pipeline_layout);
+
+	command_buffer.bind_buffer(*frame.bounds_buffer, 0, bounds_size, 0, 0, 0);
+	command_buffer.bind_buffer(*instance_draw_buffer, 0, instance_draw_buffer->get_size(), 0, 1, 0);
+	command_buffer.bind_buffer(*frame.indirect_buffer, 0, commands_size, 0, 2, 0);
+	command_buffer.bind_buffer(*frame.visible_instance_buffer, 0, frame.visible_instance_buffer->get_size(), 0, 3, 0);
+	command_buffer.bind_buffer(*first_visible_instance_buffer, 0, first_visible_instance_buffer->get_size(), 0, 4, 0);
+
+	CullingUniform culling_uniform;
+
+	if (frustum)
+	{
+		std::copy(frustum->get_planes().begin(), frustum->get_planes().end(), culling_uniform.planes);
+	}
+	else
+	{
+		// Every box is in front of these planes
+		std::fill(std::begin(culling_uniform.planes), std::end(culling_uniform.planes), glm::vec4{0.0f, 0.0f, 0.0f, 1.0f});
+	}
+
+	culling_uniform.instance_count = instance_count;
+
+	command_buffer.push_constants(0, culling_uniform);
+
+	command_buffer.dispatch((instance_count + CULLING_GROUP_SIZE - 1) / CULLING_GROUP_SIZE, 1, 1);
+
+	BufferMemoryBarrier barrier{};
+	barrier.src_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	barrier.dst_stage_mask  = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT;
+	barrier.src_access_mask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dst_access_mask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+
+	command_buffer.buffer_memory_barrier(*frame.indirect_buffer, 0, commands_size, barrier);
+
+	barrier.dst_stage_mask  = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+	barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT;
+
+	command_buffer.buffer_memory_barrier(*frame.visible_instance_buffer, 0, frame.visible_instance_buffer->get_size(), barrier);
+}
+
+const core::Buffer &IndirectCulling::get_indirect_buffer() const
+{
+	assert(active_frame_buffers && "Instances were not culled in this frame");
+
+	return *active_frame_buffers->indirect_buffer;
+}
+
+const core::Buffer &IndirectCulling::get_model_buffer() const
+{
+	assert(active_frame_buffers && "Instances were not culled in this frame");
+
+	return *active_frame_buffers->model_buffer;
+}
+
+const core::Buffer &IndirectCulling::get_visible_instance_buffer() const
+{
+	assert(active_frame_buffers && "Instances were not culled in this frame");
+
+	return *active_frame_buffers->visible_instance_buffer;
+}
+
+uint32_t IndirectCulling::get_visible_instance_count() const
+{
+	return visible_instance_count;
+}
+}        // namespace vkb
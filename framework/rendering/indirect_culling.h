@@ -0,0 +1,192 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "common/error.h"
+
+VKBP_DISABLE_WARNINGS()
+#include <glm/glm.hpp>
+VKBP_ENABLE_WARNINGS()
+
+#include "common/vk_common.h"
+#include "core/buffer.h"
+#include "core/shader_module.h"
+#include "rendering/frustum_culling.h"
+
+namespace vkb
+{
+class CommandBuffer;
+class RenderContext;
+
+/**
+ * @brief Culls the instances of indexed draws against a frustum in a compute shader.
+ *        The shader packs the indices of the visible instances of each draw after the first instance of the draw,
+ *        counting them in the instance count of its indirect arguments, so that one indirect draw issues
+ *        all the visible instances of a draw and nothing is recorded for the culled ones.
+ *        The draw arguments are uploaded once, the instance bounds and world matrices when they change,
+ *        so the CPU cost of culling follows the number of draws, not the number of instances.
+ */
+class IndirectCulling : public NonCopyable
+{
+  public:
+	/**
+	 * @brief World bounds of an instance, laid out as in the compute shader
+	 */
+	struct InstanceBounds
+	{
+		glm::vec4 center;
+
+		glm::vec4 extent;
+	};
+
+	IndirectCulling(RenderContext &render_context);
+
+	/**
+	 * @brief Removes the cached descriptor sets referencing the buffers, which must not be in use by the GPU anymore
+	 */
+	~IndirectCulling();
+
+	/**
+	 * @brief Sets the draws to cull and uploads their arguments
+	 * @param commands Draw arguments, whose instance count is set by the culling and first instance is reset to 0,
+	 *                 as a nonzero first instance requires the drawIndirectFirstInstance feature
+	 * @param instance_draws Index of the draw of each instance
+	 */
+	void set_draws(const std::vector<VkDrawIndexedIndirectCommand> &commands, const std::vector<uint32_t> &instance_draws);
+
+	/**
+	 * @brief Sets the world matrices and bounds of the instances, uploaded to the buffers of each frame the next time it is culled
+	 * @param models World matrix of each instance given to set_draws
+	 * @param bounds Bounds of each instance given to set_draws
+	 */
+	void set_instances(std::vector<glm::mat4> &&models, std::vector<InstanceBounds> &&bounds);
+
+	uint32_t get_draw_count() const;
+
+	uint32_t get_instance_count() const;
+
+	/**
+	 * @return Index of the first visible instance of a draw in the visible instance buffer,
+	 *         to be added to the instance index by the vertex shader
+	 */
+	uint32_t get_first_visible_instance(size_t draw_index) const;
+
+	/**
+	 * @brief Records the culling dispatch and the barriers making its results visible to indirect draws and vertex shaders.
+	 *        It must be recorded outside of a render pass.
+	 * @param frustum Frustum to test the instances against, or nullptr to keep all of them
+	 */
+	void cull(CommandBuffer &command_buffer, const Frustum *frustum);
+
+	/**
+	 * @return Indirect draw arguments written by the last cull, one VkDrawIndexedIndirectCommand per draw
+	 */
+	const core::Buffer &get_indirect_buffer() const;
+
+	/**
+	 * @return World matrix of each instance, read by the vertex shader
+	 */
+	const core::Buffer &get_model_buffer() const;
+
+	/**
+	 * @return Index of each visible instance, from the first visible instance of its draw, read by the vertex shader
+	 */
+	const core::Buffer &get_visible_instance_buffer() const;
+
+	/**
+	 * @return Number of visible instances read back by the last cull, which were counted by the GPU
+	 *         the previous time the active frame was rendered, or 0 if it was not culled then
+	 */
+	uint32_t get_visible_instance_count() const;
+
+  private:
+	/**
+	 * @brief Buffers written by the GPU or updated by the CPU, one set per frame in flight
+	 */
+	struct FrameBuffers
+	{
+		std::unique_ptr<core::Buffer> bounds_buffer;
+
+		std::unique_ptr<core::Buffer> model_buffer;
+
+		/// Host visible, so that the visible instance counts can be read back
+		std::unique_ptr<core::Buffer> indirect_buffer;
+
+		std::unique_ptr<core::Buffer> visible_instance_buffer;
+
+		/// Revision of the instances in bounds_buffer and model_buffer
+		uint32_t instances_revision{0};
+
+		/// Whether indirect_buffer holds the results of a cull
+		bool culled{false};
+	};
+
+	/**
+	 * @brief Push constants of the compute shader
+	 */
+	struct CullingUniform
+	{
+		glm::vec4 planes[6];
+
+		uint32_t instance_count;
+	};
+
+	/**
+	 * @brief Destroys the buffers and the cached descriptor sets writing them
+	 */
+	void release_buffers();
+
+	RenderContext &render_context;
+
+	ShaderSource compute_source;
+
+	ShaderVariant compute_variant;
+
+	/// Draw arguments with no instances, copied to the indirect buffer of a frame before culling
+	std::vector<VkDrawIndexedIndirectCommand> commands;
+
+	uint32_t instance_count{0};
+
+	/// Index of the draw of each instance
+	std::unique_ptr<core::Buffer> instance_draw_buffer;
+
+	/// Start of the range of the visible instances of each draw
+	std::vector<uint32_t> first_visible_instances;
+
+	std::unique_ptr<core::Buffer> first_visible_instance_buffer;
+
+	std::vector<glm::mat4> models;
+
+	std::vector<InstanceBounds> bounds;
+
+	/// Incremented by set_instances, the frame buffers with an older revision are updated
+	uint32_t instances_revision{0};
+
+	std::vector<FrameBuffers> frame_buffers;
+
+	FrameBuffers *active_frame_buffers{nullptr};
+
+	uint32_t visible_instance_count{0};
+};
+}        // namespace vkb
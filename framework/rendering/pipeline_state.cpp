@@ -87,6 +87,24 @@ bool operator!=(const vkb::ColorBlendState &lhs, const vkb::ColorBlendState &rhs
 
 namespace vkb
 {
+namespace
+{
+/**
+ * @brief Hashes the bytes of a state structure, they all hold 32-bit fields only so they have no padding
+ */
+template <class T>
+inline uint64_t hash_state(const T &state, uint64_t seed = 0)
+{
+	return hash_bytes(reinterpret_cast<const uint8_t *>(&state), sizeof(T), seed);
+}
+
+template <class T>
+inline uint64_t hash_state(const std::vector<T> &states, uint64_t seed = 0)
+{
+	return hash_bytes(reinterpret_cast<const uint8_t *>(states.data()), states.size() * sizeof(T), hash_state(states.size(), seed));
+}
+}        // namespace
+
 void SpecializationConstantState::reset()
 {
 	dirty = false;
@@ -131,6 +149,8 @@ void PipelineState::reset()
 {
 	clear_dirty();
 
+	dirty_hashes = ALL_SUB_STATES;
+
 	pipeline_layout = nullptr;
 
 	render_pass = nullptr;
@@ -197,6 +217,8 @@ void PipelineState::set_specialization_constant(uint32_t constant_id, const std:
 	if (specialization_constant_state.is_dirty())
 	{
 		dirty = true;
+
+		dirty_hash(SpecializationConstants);
 	}
 }
 
@@ -207,6 +229,8 @@ void PipelineState::set_vertex_input_state(const VertexInputState &new_vertex_in
 		vertex_input_sate = new_vertex_input_sate;
 
 		dirty = true;
+
+		dirty_hash(VertexInput);
 	}
 }
 
@@ -217,6 +241,8 @@ void PipelineState::set_input_assembly_state(const InputAssemblyState &new_input
 		input_assembly_state = new_input_assembly_state;
 
 		dirty = true;
+
+		dirty_hash(InputAssembly);
 	}
 }
 
@@ -227,6 +253,8 @@ void PipelineState::set_rasterization_state(const RasterizationState &new_raster
 		rasterization_state = new_rasterization_state;
 
 		dirty = true;
+
+		dirty_hash(Rasterization);
 	}
 }
 
@@ -237,6 +265,8 @@ void PipelineState::set_viewport_state(const ViewportState &new_viewport_state)
 		viewport_state = new_viewport_state;
 
 		dirty = true;
+
+		dirty_hash(Viewport);
 	}
 }
 
@@ -247,6 +277,8 @@ void PipelineState::set_multisample_state(const MultisampleState &new_multisampl
 		multisample_state = new_multisample_state;
 
 		dirty = true;
+
+		dirty_hash(Multisample);
 	}
 }
 
@@ -257,6 +289,8 @@ void PipelineState::set_depth_stencil_state(const DepthStencilState &new_depth_s
 		depth_stencil_state = new_depth_stencil_state;
 
 		dirty = true;
+
+		dirty_hash(DepthStencil);
 	}
 }
 
@@ -267,6 +301,8 @@ void PipelineState::set_color_blend_state(const ColorBlendState &new_color_blend
 		color_blend_state = new_color_blend_state;
 
 		dirty = true;
+
+		dirty_hash(ColorBlend);
 	}
 }
 
@@ -336,6 +372,101 @@ uint32_t PipelineState::get_subpass_index() const
 	return subpass_index;
 }
 
+uint64_t PipelineState::get_hash() const
+{
+	// Only rehash the sub-states changed since the last call
+	if (dirty_hashes & (1u << SpecializationConstants))
+	{
+		uint64_t hash = 0;
+
+		for (auto &constant : specialization_constant_state.get_specialization_constant_state())
+		{
+			hash = hash_state(constant.first, hash);
+			hash = hash_state(constant.second, hash);
+		}
+
+		sub_state_hashes[SpecializationConstants] = hash;
+	}
+
+	if (dirty_hashes & (1u << VertexInput))
+	{
+		sub_state_hashes[VertexInput] = hash_state(vertex_input_sate.attributes, hash_state(vertex_input_sate.bindings));
+	}
+
+	if (dirty_hashes & (1u << InputAssembly))
+	{
+		sub_state_hashes[InputAssembly] = hash_state(input_assembly_state);
+	}
+
+	if (dirty_hashes & (1u << Rasterization))
+	{
+		sub_state_hashes[Rasterization] = hash_state(rasterization_state);
+	}
+
+	if (dirty_hashes & (1u << Viewport))
+	{
+		sub_state_hashes[Viewport] = hash_state(viewport_state);
+	}
+
+	if (dirty_hashes & (1u << Multisample))
+	{
+		sub_state_hashes[Multisample] = hash_state(multisample_state);
+	}
+
+	if (dirty_hashes & (1u << DepthStencil))
+	{
+		sub_state_hashes[DepthStencil] = hash_state(depth_stencil_state);
+	}
+
+	if (dirty_hashes & (1u << ColorBlend))
+	{
+		uint64_t hash = hash_state(color_blend_state.logic_op_enable);
+		hash          = hash_state(color_blend_state.logic_op, hash);
+
+		sub_state_hashes[ColorBlend] = hash_state(color_blend_state.attachments, hash);
+	}
+
+	dirty_hashes = 0;
+
+	// Combine the cached hashes with the objects the state refers to
+	VkPipelineLayout layout_handle{VK_NULL_HANDLE};
+
+	if (pipeline_layout)
+	{
+		layout_handle = pipeline_layout->get_handle();
+	}
+
+	// For graphics only
+	VkRenderPass render_pass_handle{VK_NULL_HANDLE};
+
+	if (render_pass)
+	{
+		render_pass_handle = render_pass->get_handle();
+	}
+
+	uint64_t hash = hash_state(sub_state_hashes);
+
+	hash = hash_state(layout_handle, hash);
+	hash = hash_state(render_pass_handle, hash);
+
+	return hash_state(subpass_index, hash);
+}
+
+bool PipelineState::operator==(const PipelineState &other) const
+{
+	return pipeline_layout == other.pipeline_layout &&
+	       render_pass == other.render_pass &&
+	       subpass_index == other.subpass_index &&
+	       specialization_constant_state.get_specialization_constant_state() == other.specialization_constant_state.get_specialization_constant_state() &&
+	       !(vertex_input_sate != other.vertex_input_sate) &&
+	       !(input_assembly_state != other.input_assembly_state) &&
+	       !(rasterization_state != other.rasterization_state) &&
+	       !(viewport_state != other.viewport_state) &&
+	       !(multisample_state != other.multisample_state) &&
+	       !(depth_stencil_state != other.depth_stencil_state) &&
+	       !(color_blend_state != other.color_blend_state);
+}
+
 bool PipelineState::is_dirty() const
 {
 	return dirty || specialization_constant_state.is_dirty();
@@ -346,4 +477,14 @@ void PipelineState::clear_dirty()
 	dirty = false;
 	specialization_constant_state.clear_dirty();
 }
+
+void PipelineState::set_dirty()
+{
+	dirty = true;
+}
+
+void PipelineState::dirty_hash(SubState sub_state)
+{
+	dirty_hashes |= 1u << sub_state;
+}
 }        // namespace vkb
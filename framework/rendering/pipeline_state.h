@@ -229,13 +229,53 @@ class PipelineState
 
 	uint32_t get_subpass_index() const;
 
+	/**
+	 * @brief Returns a 64-bit hash of the whole state.
+	 *        A hash is cached for each sub-state and only recomputed after a setter changed it,
+	 *        so the full state hash is an O(1) combination of the cached ones.
+	 */
+	uint64_t get_hash() const;
+
+	/**
+	 * @brief Compares the whole state, as different states may share the same hash
+	 */
+	bool operator==(const PipelineState &other) const;
+
 	bool is_dirty() const;
 
 	void clear_dirty();
 
+	/**
+	 * @brief Forces the next draw to bind a pipeline, as for a state copied into a new command buffer
+	 */
+	void set_dirty();
+
   private:
+	/// Sub-states which keep a cached hash
+	enum SubState : uint32_t
+	{
+		SpecializationConstants,
+		VertexInput,
+		InputAssembly,
+		Rasterization,
+		Viewport,
+		Multisample,
+		DepthStencil,
+		ColorBlend,
+		SubStateCount
+	};
+
+	static const uint32_t ALL_SUB_STATES = (1u << SubStateCount) - 1;
+
+	void dirty_hash(SubState sub_state);
+
 	bool dirty{false};
 
+	/// Bit mask of the sub-states whose cached hash is out of date
+	mutable uint32_t dirty_hashes{ALL_SUB_STATES};
+
+	mutable std::array<uint64_t, SubStateCount> sub_state_hashes{};
+
 	PipelineLayout *pipeline_layout{nullptr};
 
 	const RenderPass *render_pass{nullptr};
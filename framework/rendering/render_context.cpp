@@ -20,6 +20,8 @@
 
 #include "rendering/render_context.h"
 
+#include <thread>
+
 namespace vkb
 {
 RenderContext::RenderContext(std::unique_ptr<Swapchain> &&s, RenderTarget::CreateFunc create_rt) :
@@ -36,6 +38,10 @@ RenderContext::RenderContext(std::unique_ptr<Swapchain> &&s, RenderTarget::Creat
 	surface_extent = swapchain->get_extent();
 	VkExtent3D extent{surface_extent.width, surface_extent.height, 1};
 
+	// Let every core record commands for a frame, the per-thread pools are only filled when used
+	auto thread_count = std::thread::hardware_concurrency();
+	thread_count      = thread_count == 0 ? 1 : thread_count;
+
 	for (auto &image_handle : swapchain->get_images())
 	{
 		auto swapchain_image = core::Image{
@@ -44,8 +50,10 @@ RenderContext::RenderContext(std::unique_ptr<Swapchain> &&s, RenderTarget::Creat
 		    swapchain->get_format(),
 		    swapchain->get_usage()};
 		auto render_target = create_render_target(std::move(swapchain_image));
-		frames.emplace_back(RenderFrame{device, std::move(render_target)});
+		frames.emplace_back(RenderFrame{device, std::move(render_target), thread_count});
 	}
+
+	frame_numbers.resize(frames.size(), 0);
 }
 
 VkSemaphore RenderContext::begin_frame()
@@ -81,6 +89,13 @@ VkSemaphore RenderContext::begin_frame()
 
 	wait_frame();
 
+	// Waiting for the fences of this frame means that every frame submitted before it has completed as well
+	auto completed_frame_number = frame_numbers.at(active_frame_index);
+
+	frame_numbers.at(active_frame_index) = ++frame_count;
+
+	device.get_resource_cache().begin_frame(frame_count, completed_frame_number);
+
 	return aquired_semaphore;
 }
 
@@ -161,17 +176,23 @@ RenderFrame &RenderContext::get_active_frame()
 	return frames.at(active_frame_index);
 }
 
+uint32_t RenderContext::get_active_frame_index() const
+{
+	assert(frame_active && "Frame is not active, please call begin_frame");
+	return active_frame_index;
+}
+
 RenderFrame &RenderContext::get_last_rendered_frame()
 {
 	assert(!frame_active && "Frame is still active, please call end_frame");
 	return frames.at(active_frame_index);
 }
 
-CommandBuffer &RenderContext::request_frame_command_buffer(const Queue &queue, CommandBuffer::ResetMode reset_mode, VkCommandBufferLevel level)
+CommandBuffer &RenderContext::request_frame_command_buffer(const Queue &queue, CommandBuffer::ResetMode reset_mode, VkCommandBufferLevel level, size_t thread_index)
 {
 	RenderFrame &frame = get_active_frame();
 
-	return frame.get_command_pool(queue, reset_mode).request_command_buffer(level);
+	return frame.get_command_pool(queue, reset_mode, thread_index).request_command_buffer(level);
 }
 
 VkSemaphore RenderContext::request_semaphore()
@@ -88,6 +88,11 @@ class RenderContext : public NonCopyable
 	 */
 	RenderFrame &get_active_frame();
 
+	/**
+	 * @return Index of the active frame, to select per-frame resources kept outside of the frame
+	 */
+	uint32_t get_active_frame_index() const;
+
 	/**
 	 * @brief An error should be raised if a frame is active.
 	 *        A frame is active after @ref begin_frame has been called.
@@ -102,11 +107,13 @@ class RenderContext : public NonCopyable
 	 * @param reset_mode Indicate how the command buffer will be used, may trigger a
 	 *        pool re-creation to set necessary flags
 	 * @param level Command buffer level, either primary or secondary
+	 * @param thread_index Index of the thread the command buffer is recorded on
 	 * @return A command buffer related to the current active frame
 	 */
 	CommandBuffer &request_frame_command_buffer(const Queue &            queue,
-	                                            CommandBuffer::ResetMode reset_mode = CommandBuffer::ResetMode::ResetPool,
-	                                            VkCommandBufferLevel     level      = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+	                                            CommandBuffer::ResetMode reset_mode   = CommandBuffer::ResetMode::ResetPool,
+	                                            VkCommandBufferLevel     level        = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+	                                            size_t                   thread_index = 0);
 
 	VkSemaphore request_semaphore();
 
@@ -136,6 +143,12 @@ class RenderContext : public NonCopyable
 
 	std::vector<RenderFrame> frames;
 
+	/// Number of frames begun so far
+	uint64_t frame_count{0};
+
+	/// Number of the frame each render frame was last used for
+	std::vector<uint64_t> frame_numbers;
+
 	/// Queue to submit commands for rendering our frames
 	const Queue &present_queue;
 
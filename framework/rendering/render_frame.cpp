@@ -24,15 +24,25 @@
 
 namespace vkb
 {
-RenderFrame::RenderFrame(Device &device, RenderTarget &&render_target) :
+RenderFrame::RenderFrame(Device &device, RenderTarget &&render_target, size_t thread_count) :
     device{device},
     fence_pool{device},
     semaphore_pool{device},
-    swapchain_render_target{std::move(render_target)}
+    swapchain_render_target{std::move(render_target)},
+    thread_count{thread_count}
 {
-	buffer_pools.emplace(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, std::make_pair(BufferPool{device, BUFFER_POOL_BLOCK_SIZE * 1024, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT}, nullptr));
-	buffer_pools.emplace(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, std::make_pair(BufferPool{device, BUFFER_POOL_BLOCK_SIZE * 1024, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT}, nullptr));
-	buffer_pools.emplace(VK_BUFFER_USAGE_INDEX_BUFFER_BIT, std::make_pair(BufferPool{device, BUFFER_POOL_BLOCK_SIZE * 1024, VK_BUFFER_USAGE_INDEX_BUFFER_BIT}, nullptr));
+	assert(thread_count > 0 && "A frame needs at least one thread to record commands");
+
+	for (auto usage : {VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_BUFFER_USAGE_INDEX_BUFFER_BIT})
+	{
+		auto &usage_pools = buffer_pools[usage];
+
+		// Blocks are only requested on the first allocation, so idle threads cost no memory
+		for (size_t i = 0; i < thread_count; ++i)
+		{
+			usage_pools.emplace_back(BufferPool{device, BUFFER_POOL_BLOCK_SIZE * 1024, usage}, nullptr);
+		}
+	}
 }
 
 void RenderFrame::update_render_target(RenderTarget &&render_target)
@@ -46,52 +56,64 @@ void RenderFrame::reset()
 
 	fence_pool.reset();
 
-	for (auto &command_pool : command_pools)
+	for (auto &command_pools_it : command_pools)
 	{
-		command_pool.second->reset_pool();
+		for (auto &command_pool : command_pools_it.second)
+		{
+			if (command_pool)
+			{
+				command_pool->reset_pool();
+			}
+		}
 	}
 
-	for (auto &buffer_pool_it : buffer_pools)
+	for (auto &buffer_pools_it : buffer_pools)
 	{
-		auto &[buffer_pool, buffer_block] = buffer_pool_it.second;
-
-		buffer_pool.reset();
+		for (auto &[buffer_pool, buffer_block] : buffer_pools_it.second)
+		{
+			buffer_pool.reset();
 
-		buffer_block = nullptr;
+			buffer_block = nullptr;
+		}
 	}
 
 	semaphore_pool.reset();
 }
 
-CommandPool &RenderFrame::get_command_pool(const Queue &queue, CommandBuffer::ResetMode reset_mode)
+CommandPool &RenderFrame::get_command_pool(const Queue &queue, CommandBuffer::ResetMode reset_mode, size_t thread_index)
 {
-	auto command_pool_it = command_pools.find(queue.get_family_index());
+	assert(thread_index < thread_count && "Thread index is out of bounds");
 
-	if (command_pool_it != command_pools.end())
+	auto command_pools_it = command_pools.find(queue.get_family_index());
+
+	if (command_pools_it == command_pools.end())
 	{
-		if (command_pool_it->second->get_reset_mode() != reset_mode)
-		{
-			device.wait_idle();
+		auto res_ins_it = command_pools.emplace(queue.get_family_index(), std::vector<std::unique_ptr<CommandPool>>(thread_count));
 
-			// Delete pool
-			command_pools.erase(command_pool_it);
-		}
-		else
+		if (!res_ins_it.second)
 		{
-			return *command_pool_it->second;
+			throw std::runtime_error("Failed to insert command pool");
 		}
+
+		command_pools_it = res_ins_it.first;
 	}
 
-	auto res_ins_it = command_pools.emplace(queue.get_family_index(), std::make_unique<CommandPool>(device, queue.get_family_index(), reset_mode));
+	auto &command_pool = command_pools_it->second[thread_index];
 
-	if (!res_ins_it.second)
+	if (command_pool && command_pool->get_reset_mode() != reset_mode)
 	{
-		throw std::runtime_error("Failed to insert command pool");
+		device.wait_idle();
+
+		// Delete pool
+		command_pool.reset();
 	}
 
-	command_pool_it = res_ins_it.first;
+	if (!command_pool)
+	{
+		command_pool = std::make_unique<CommandPool>(device, queue.get_family_index(), reset_mode);
+	}
 
-	return *command_pool_it->second;
+	return *command_pool;
 }
 
 FencePool &RenderFrame::get_fence_pool()
@@ -109,8 +131,10 @@ RenderTarget &RenderFrame::get_render_target()
 	return swapchain_render_target;
 }
 
-BufferAllocation RenderFrame::allocate_buffer(const VkBufferUsageFlags usage, const VkDeviceSize size)
+BufferAllocation RenderFrame::allocate_buffer(const VkBufferUsageFlags usage, const VkDeviceSize size, size_t thread_index)
 {
+	assert(thread_index < thread_count && "Thread index is out of bounds");
+
 	// Find a pool for this usage
 	auto buffer_pool_it = buffer_pools.find(usage);
 	if (buffer_pool_it == buffer_pools.end())
@@ -119,7 +143,7 @@ BufferAllocation RenderFrame::allocate_buffer(const VkBufferUsageFlags usage, co
 		return BufferAllocation{};
 	}
 
-	auto &[buffer_pool, buffer_block] = buffer_pool_it->second;
+	auto &[buffer_pool, buffer_block] = buffer_pool_it->second[thread_index];
 
 	if (!buffer_block)
 	{
@@ -140,4 +164,9 @@ BufferAllocation RenderFrame::allocate_buffer(const VkBufferUsageFlags usage, co
 
 	return data;
 }
+
+size_t RenderFrame::get_thread_count() const
+{
+	return thread_count;
+}
 }        // namespace vkb
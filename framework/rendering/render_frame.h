@@ -46,6 +46,9 @@ namespace vkb
  * A RenderFrame cannot be destroyed individually since frames are managed by the RenderContext,
  * the whole context must be destroyed. This is because each RenderFrame holds Vulkan objects
  * such as the swapchain image.
+ *
+ * Command pools and buffer pools are kept per thread, so that several threads can record
+ * command buffers for the same frame without locking, as long as each uses its own thread index.
  */
 class RenderFrame : public NonCopyable
 {
@@ -55,7 +58,12 @@ class RenderFrame : public NonCopyable
 	 */
 	static constexpr uint32_t BUFFER_POOL_BLOCK_SIZE = 256;
 
-	RenderFrame(Device &device, RenderTarget &&render_target);
+	/**
+	 * @param device A valid device
+	 * @param render_target The swapchain render target of the frame
+	 * @param thread_count Number of threads which may record commands for the frame
+	 */
+	RenderFrame(Device &device, RenderTarget &&render_target, size_t thread_count = 1);
 
 	void reset();
 
@@ -66,12 +74,15 @@ class RenderFrame : public NonCopyable
 
 	/**
 	 * @brief Retrieve the frame's command pool
+	 *        The first request for a queue family must be made from the main thread,
+	 *        then each thread can request its own pool concurrently
 	 * @param queue The queue command buffers will be submitted on
 	 * @param reset_mode Indicate how the command buffers will be reset after execution,
 	 *        may trigger a pool re-creation to set necessary flags
+	 * @param thread_index Index of the thread the command buffers are recorded on
 	 * @return The frame's command pool
 	 */
-	CommandPool &get_command_pool(const Queue &queue, CommandBuffer::ResetMode reset_mode);
+	CommandPool &get_command_pool(const Queue &queue, CommandBuffer::ResetMode reset_mode, size_t thread_index = 0);
 
 	FencePool &get_fence_pool();
 
@@ -88,15 +99,21 @@ class RenderFrame : public NonCopyable
 	/**
 	 * @param usage Usage of the buffer
 	 * @param size Amount of memory required
+	 * @param thread_index Index of the thread the allocation is made from
 	 * @return The requested allocation, it may be empty
 	 */
-	BufferAllocation allocate_buffer(VkBufferUsageFlags usage, VkDeviceSize size);
+	BufferAllocation allocate_buffer(VkBufferUsageFlags usage, VkDeviceSize size, size_t thread_index = 0);
+
+	/**
+	 * @return Number of threads which may record commands for the frame
+	 */
+	size_t get_thread_count() const;
 
   private:
 	Device &device;
 
-	/// Commands pools associated to the frame
-	std::map<uint32_t, std::unique_ptr<CommandPool>> command_pools;
+	/// Commands pools associated to the frame, one per thread for each queue family
+	std::map<uint32_t, std::vector<std::unique_ptr<CommandPool>>> command_pools;
 
 	FencePool fence_pool;
 
@@ -104,6 +121,9 @@ class RenderFrame : public NonCopyable
 
 	RenderTarget swapchain_render_target;
 
-	std::map<VkBufferUsageFlags, std::pair<BufferPool, BufferBlock *>> buffer_pools;
+	/// Buffer pools for each usage, one per thread
+	std::map<VkBufferUsageFlags, std::vector<std::pair<BufferPool, BufferBlock *>>> buffer_pools;
+
+	size_t thread_count;
 };
 }        // namespace vkb
@@ -45,6 +45,11 @@ void RenderPipeline::add_subpass(std::unique_ptr<Subpass> &&subpass)
 	subpasses.emplace_back(std::move(subpass));
 }
 
+std::vector<std::unique_ptr<Subpass>> &RenderPipeline::get_subpasses()
+{
+	return subpasses;
+}
+
 const std::vector<LoadStoreInfo> &RenderPipeline::get_load_store() const
 {
 	return load_store;
@@ -69,6 +74,11 @@ void RenderPipeline::draw(CommandBuffer &command_buffer, RenderTarget &render_ta
 {
 	assert(!subpasses.empty() && "Render pipeline should contain at least one sub-pass");
 
+	for (auto &subpass : subpasses)
+	{
+		subpass->prepare(command_buffer);
+	}
+
 	for (size_t i = 0; i < subpasses.size(); ++i)
 	{
 		auto &subpass = subpasses[i];
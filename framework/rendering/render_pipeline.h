@@ -72,6 +72,11 @@ class RenderPipeline : public NonCopyable
 	 */
 	void add_subpass(std::unique_ptr<Subpass> &&subpass);
 
+	/**
+	 * @return Subpasses of the pipeline, in the order they are drawn
+	 */
+	std::vector<std::unique_ptr<Subpass>> &get_subpasses();
+
 	/**
 	 * @brief Record draw commands for each Subpass
 	 */
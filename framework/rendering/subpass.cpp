@@ -48,6 +48,10 @@ void Subpass::update_render_target_attachments()
 	render_target.set_output_attachments(output_attachments);
 }
 
+void Subpass::prepare(CommandBuffer &command_buffer)
+{
+}
+
 RenderContext &Subpass::get_render_context()
 {
 	return render_context;
@@ -54,6 +54,13 @@ class Subpass : public NonCopyable
 	 */
 	void update_render_target_attachments();
 
+	/**
+	 * @brief Records the commands the subpass needs before its render pass begins, such as compute work.
+	 *        This function is called by the RenderPipeline for every subpass before beginning the render pass.
+	 * @param command_buffer Command buffer to use to record the commands
+	 */
+	virtual void prepare(CommandBuffer &command_buffer);
+
 	/**
 	 * @brief Draw virtual function
 	 * @param command_buffer Command buffer to use to record draw commands
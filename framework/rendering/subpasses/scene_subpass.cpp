@@ -19,8 +19,20 @@
  */
 
 #include "rendering/subpasses/scene_subpass.h"
+
+#include <algorithm>
+#include <array>
+#include <exception>
+#include <numeric>
+#include <unordered_map>
+
+#include <ctpl_stl.h>
+
 #include "common/vk_common.h"
+#include "frozen_commands.h"
+#include "rendering/indirect_culling.h"
 #include "rendering/render_context.h"
+#include "scene_graph/components/bvh.h"
 #include "scene_graph/components/camera.h"
 #include "scene_graph/components/image.h"
 #include "scene_graph/components/material.h"
@@ -31,83 +43,777 @@
 #include "scene_graph/scene.h"
 #include "utils.h"
 
-namespace vkb
-{
-SceneSubpass::SceneSubpass(RenderContext &render_context, ShaderSource &&vertex_source, ShaderSource &&fragment_source, sg::Scene &scene, sg::Camera &camera) :
-    Subpass{render_context, std::move(vertex_source), std::move(fragment_source)},
-    meshes{scene.get_components<sg::Mesh>()},
-    camera{camera}
+namespace vkb
+{
+namespace
+{
+/// Bits of the sort key given to each of the pipeline, material, mesh and distance fields
+constexpr uint32_t SORT_FIELD_BITS = 16;
+
+constexpr uint64_t SORT_FIELD_MASK = (1ull << SORT_FIELD_BITS) - 1;
+
+/// Name of the vertex shader input holding the world matrix of each instance
+const std::string INSTANCE_MODEL_INPUT = "instance_model";
+
+/// Name of the vertex shader buffer holding the visible instances of each draw culled on the GPU
+const std::string VISIBLE_INSTANCE_BUFFER = "VisibleInstanceBuffer";
+
+/// Draw index of the submeshes which cannot be culled on the GPU
+constexpr uint32_t NO_INDIRECT_DRAW = ~0u;
+
+/// Offset of the first visible instance pushed for each indirect draw, after the material push constants
+constexpr uint32_t INDIRECT_DRAW_UNIFORM_OFFSET = 32;
+
+/**
+ * @brief Checks if a submesh can be drawn indirectly when the draws are culled on the GPU
+ */
+bool is_indirect_draw(const sg::SubMesh &sub_mesh)
+{
+	return sub_mesh.vertex_indices != 0 && sub_mesh.get_material()->alpha_mode != sg::AlphaMode::Blend;
+}
+
+/**
+ * @brief Least significant digit radix sort of (key, index) pairs, one byte per pass.
+ *        Passes where every key has the same byte are skipped, so keys with unused high bits cost less.
+ * @param keys Pairs to sort, sorted in place
+ * @param scratch Buffer of the same type, resized as needed and reused across calls
+ */
+void radix_sort(std::vector<std::pair<uint64_t, uint32_t>> &keys, std::vector<std::pair<uint64_t, uint32_t>> &scratch)
+{
+	if (keys.size() < 2)
+	{
+		return;
+	}
+
+	scratch.resize(keys.size());
+
+	for (uint32_t shift = 0; shift < 64; shift += 8)
+	{
+		std::array<size_t, 256> offsets{};
+
+		for (auto &key : keys)
+		{
+			++offsets[(key.first >> shift) & 0xFF];
+		}
+
+		if (offsets[(keys.front().first >> shift) & 0xFF] == keys.size())
+		{
+			continue;
+		}
+
+		size_t offset = 0;
+
+		for (auto &count : offsets)
+		{
+			auto bucket_size = count;
+			count            = offset;
+			offset += bucket_size;
+		}
+
+		for (auto &key : keys)
+		{
+			scratch[offsets[(key.first >> shift) & 0xFF]++] = key;
+		}
+
+		keys.swap(scratch);
+	}
+}
+
+/**
+ * @brief Gives a small identifier to each distinct value, in order of first appearance
+ */
+template <class T>
+uint64_t get_sort_id(std::unordered_map<T, uint64_t> &ids, const T &value)
+{
+	auto it = ids.emplace(value, ids.size()).first;
+
+	// Identifiers beyond the field range share sort positions, which only costs extra state changes
+	return it->second & SORT_FIELD_MASK;
+}
+}        // namespace
+
+SceneSubpass::SceneSubpass(RenderContext &render_context, ShaderSource &&vertex_source, ShaderSource &&fragment_source, sg::Scene &scene, sg::Camera &camera) :
+    Subpass{render_context, std::move(vertex_source), std::move(fragment_source)},
+    meshes{scene.get_components<sg::Mesh>()},
+    camera{camera}
+{
+	// Default light
+	global_uniform.light_pos   = glm::vec4(500.0f, 1550.0f, 0.0f, 1.0);
+	global_uniform.light_color = glm::vec4(1.0, 1.0, 1.0, 1.0);
+
+	// Build all shader variance upfront
+	auto &device = render_context.get_device();
+	for (auto &mesh : meshes)
+	{
+		for (auto &sub_mesh : mesh->get_submeshes())
+		{
+			auto &variant     = sub_mesh->get_shader_variant();
+			auto &vert_module = device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader(), variant);
+			auto &frag_module = device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader(), variant);
+
+			vert_module.set_resource_dynamic("ModelUniform");
+		}
+	}
+
+	auto alignment = device.get_properties().limits.minUniformBufferOffsetAlignment;
+
+	model_uniform_stride = (sizeof(glm::mat4) + alignment - 1) / alignment * alignment;
+
+	// Scenes loaded by GLTFLoader come with their hierarchy, it is built here for the other ones
+	if (!scene.has_component<sg::BVH>())
+	{
+		scene.add_component(std::make_unique<sg::BVH>(meshes));
+	}
+
+	bvh = scene.get_components<sg::BVH>().front();
+
+	prepare_instanced_variants();
+
+	for (auto &leaf : bvh->get_leaves())
+	{
+		total_draw_count += leaf.mesh->get_submeshes().size();
+	}
+
+	prepare_state_keys();
+}
+
+SceneSubpass::~SceneSubpass()
+{
+	for (auto &frame : frozen_frames)
+	{
+		release_frozen_frame(frame);
+	}
+}
+
+void SceneSubpass::set_thread_count(size_t count)
+{
+	thread_count = std::max<size_t>(count, 1);
+
+	// The calling thread records the first range of draws
+	if (thread_count > 1)
+	{
+		thread_pool = std::make_unique<ctpl::thread_pool>(static_cast<int>(thread_count - 1));
+	}
+	else
+	{
+		thread_pool.reset();
+	}
+}
+
+size_t SceneSubpass::get_thread_count() const
+{
+	return thread_count;
+}
+
+void SceneSubpass::set_state_sorting(bool enabled)
+{
+	state_sorting = enabled;
+}
+
+bool SceneSubpass::is_state_sorting() const
+{
+	return state_sorting;
+}
+
+void SceneSubpass::set_gpu_culling(bool enabled)
+{
+	gpu_culling = enabled;
+}
+
+bool SceneSubpass::is_gpu_culling() const
+{
+	return gpu_culling;
+}
+
+void SceneSubpass::set_instancing(bool enabled)
+{
+	instancing = enabled;
+}
+
+bool SceneSubpass::is_instancing() const
+{
+	return instancing;
+}
+
+void SceneSubpass::set_command_freezing(bool enabled)
+{
+	command_freezing = enabled;
+}
+
+bool SceneSubpass::is_command_freezing() const
+{
+	return command_freezing;
+}
+
+size_t SceneSubpass::get_frozen_replay_count() const
+{
+	return frozen_replay_count;
+}
+
+void SceneSubpass::set_frustum_culling(bool enabled)
+{
+	frustum_culling = enabled;
+}
+
+bool SceneSubpass::is_frustum_culling() const
+{
+	return frustum_culling;
+}
+
+size_t SceneSubpass::get_visible_draw_count() const
+{
+	return visible_draw_count;
+}
+
+size_t SceneSubpass::get_culled_draw_count() const
+{
+	return culled_draw_count;
+}
+
+void SceneSubpass::prepare_instanced_variants()
+{
+	auto &resource_cache = get_render_context().get_device().get_resource_cache();
+
+	for (auto &mesh : meshes)
+	{
+		if (mesh->get_nodes().size() < 2)
+		{
+			continue;
+		}
+
+		for (auto &sub_mesh : mesh->get_submeshes())
+		{
+			ShaderVariant variant = sub_mesh->get_shader_variant();
+			variant.add_define("INSTANCING");
+
+			auto &vert_module = resource_cache.request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader(), variant);
+
+			auto &resources = vert_module.get_resources();
+
+			auto input_it = std::find_if(resources.begin(), resources.end(), [](const ShaderResource &resource) {
+				return resource.type == ShaderResourceType::Input && resource.name == INSTANCE_MODEL_INPUT;
+			});
+
+			// Shaders without the instance input draw the submesh once per node
+			if (input_it == resources.end())
+			{
+				continue;
+			}
+
+			resource_cache.request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader(), variant);
+
+			instanced_variants.emplace(sub_mesh, InstancedVariant{variant, input_it->location});
+		}
+	}
+}
+
+void SceneSubpass::cull_nodes()
+{
+	auto &leaves = bvh->get_leaves();
+
+	if (frustum_culling)
+	{
+		bvh->cull(Frustum{camera.get_projection() * camera.get_view()}, visible_leaves);
+	}
+	else
+	{
+		visible_leaves.resize(leaves.size());
+		std::iota(visible_leaves.begin(), visible_leaves.end(), 0);
+	}
+
+	visible_draw_count = 0;
+
+	for (auto leaf_index : visible_leaves)
+	{
+		visible_draw_count += leaves[leaf_index].mesh->get_submeshes().size();
+	}
+
+	culled_draw_count = total_draw_count - visible_draw_count;
+}
+
+void SceneSubpass::prepare_state_keys()
+{
+	// The pipeline of a draw depends on its shader variant and rasterization state,
+	// its descriptor set on the textures of its material
+	std::unordered_map<size_t, uint64_t>               pipeline_ids;
+	std::unordered_map<const sg::Material *, uint64_t> material_ids;
+
+	uint64_t mesh_id = 0;
+
+	state_keys.clear();
+
+	for (auto &mesh : meshes)
+	{
+		state_keys.emplace_back();
+
+		for (auto &sub_mesh : mesh->get_submeshes())
+		{
+			auto material = sub_mesh->get_material();
+
+			size_t pipeline_hash = sub_mesh->get_shader_variant().get_id();
+			hash_combine(pipeline_hash, material->double_sided);
+
+			uint64_t key = get_sort_id(pipeline_ids, pipeline_hash) << (3 * SORT_FIELD_BITS);
+			key |= get_sort_id(material_ids, material) << (2 * SORT_FIELD_BITS);
+			key |= (mesh_id++ & SORT_FIELD_MASK) << SORT_FIELD_BITS;
+
+			state_keys.back().push_back(key);
+		}
+	}
+}
+
+void SceneSubpass::prepare_indirect_draws()
+{
+	auto &leaves = bvh->get_leaves();
+
+	auto &resource_cache = get_render_context().get_device().get_resource_cache();
+
+	std::vector<IndirectDraw>                   draws;
+	std::vector<std::pair<uint64_t, uint32_t>>  draw_keys;
+	std::unordered_map<sg::SubMesh *, uint32_t> draw_indices;
+	std::vector<uint32_t>                       instance_draws;
+
+	indirect_instance_leaves.clear();
+
+	for (uint32_t leaf_index = 0; leaf_index < leaves.size(); ++leaf_index)
+	{
+		auto &leaf = leaves[leaf_index];
+
+		auto &sub_meshes = leaf.mesh->get_submeshes();
+
+		for (size_t sub_mesh_index = 0; sub_mesh_index < sub_meshes.size(); ++sub_mesh_index)
+		{
+			auto sub_mesh = sub_meshes[sub_mesh_index];
+
+			if (!is_indirect_draw(*sub_mesh))
+			{
+				continue;
+			}
+
+			auto draw_it = draw_indices.find(sub_mesh);
+
+			if (draw_it == draw_indices.end())
+			{
+				ShaderVariant variant = sub_mesh->get_shader_variant();
+				variant.add_define("GPU_CULLING");
+
+				auto &vert_module = resource_cache.request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader(), variant);
+
+				auto &resources = vert_module.get_resources();
+
+				bool reads_instances = std::any_of(resources.begin(), resources.end(), [](const ShaderResource &resource) {
+					return resource.name == VISIBLE_INSTANCE_BUFFER;
+				});
+
+				uint32_t draw_index = NO_INDIRECT_DRAW;
+
+				// Shaders reading the world matrix from the model uniform keep the CPU path
+				if (reads_instances)
+				{
+					resource_cache.request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader(), variant);
+
+					draw_index = to_u32(draws.size());
+
+					draw_keys.emplace_back(state_keys[leaf.mesh_index][sub_mesh_index], draw_index);
+
+					draws.push_back({sub_mesh, variant});
+				}
+
+				draw_it = draw_indices.emplace(sub_mesh, draw_index).first;
+			}
+
+			if (draw_it->second != NO_INDIRECT_DRAW)
+			{
+				instance_draws.push_back(draw_it->second);
+				indirect_instance_leaves.push_back(leaf_index);
+			}
+		}
+	}
+
+	// The state keys do not change, so the draws are sorted once
+	radix_sort(draw_keys, sort_scratch);
+
+	std::vector<uint32_t>                     sorted_indices(draws.size());
+	std::vector<VkDrawIndexedIndirectCommand> commands;
+
+	indirect_draws.clear();
+	indirect_sub_meshes.clear();
+
+	for (auto &draw_key : draw_keys)
+	{
+		auto &draw = draws[draw_key.second];
+
+		sorted_indices[draw_key.second] = to_u32(indirect_draws.size());
+
+		indirect_draws.push_back(draw);
+		indirect_sub_meshes.insert(draw.sub_mesh);
+
+		VkDrawIndexedIndirectCommand command{};
+		command.indexCount = draw.sub_mesh->vertex_indices;
+
+		commands.push_back(command);
+	}
+
+	for (auto &draw_index : instance_draws)
+	{
+		draw_index = sorted_indices[draw_index];
+	}
+
+	indirect_culling->set_draws(commands, instance_draws);
+
+	update_indirect_instances();
+}
+
+void SceneSubpass::update_indirect_instances()
+{
+	auto &leaves = bvh->get_leaves();
+
+	std::vector<glm::mat4>                       models;
+	std::vector<IndirectCulling::InstanceBounds> bounds;
+
+	models.reserve(indirect_instance_leaves.size());
+	bounds.reserve(indirect_instance_leaves.size());
+
+	for (auto leaf_index : indirect_instance_leaves)
+	{
+		auto &leaf = leaves[leaf_index];
+
+		models.push_back(leaf.node->get_transform().get_world_matrix());
+		bounds.push_back({glm::vec4{leaf.center, 0.0f}, glm::vec4{leaf.extent, 0.0f}});
+	}
+
+	indirect_culling->set_instances(std::move(models), std::move(bounds));
+
+	indirect_instances_revision = bvh->get_revision();
+}
+
+void SceneSubpass::prepare(CommandBuffer &command_buffer)
+{
+	global_uniform.camera_view_proj = vkb::vulkan_style_projection(camera.get_projection()) * camera.get_view();
+
+	frame_uniform = get_render_context().get_active_frame().allocate_buffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(GlobalUniform));
+
+	frame_uniform.update(global_uniform);
+
+	bvh->refit();
+
+	indirect_draws_culled = false;
+
+	if (!gpu_culling)
+	{
+		return;
+	}
+
+	if (!indirect_culling)
+	{
+		indirect_culling = std::make_unique<IndirectCulling>(get_render_context());
+
+		prepare_indirect_draws();
+	}
+	else if (indirect_instances_revision != bvh->get_revision())
+	{
+		update_indirect_instances();
+	}
+
+	if (frustum_culling)
+	{
+		Frustum frustum{camera.get_projection() * camera.get_view()};
+
+		indirect_culling->cull(command_buffer, &frustum);
+	}
+	else
+	{
+		indirect_culling->cull(command_buffer, nullptr);
+	}
+
+	indirect_draws_culled = true;
+}
+
+size_t SceneSubpass::sort_draws()
+{
+	opaque_draws.clear();
+	transparent_draws.clear();
+	sorted_nodes.clear();
+
+	// Every draw is culled on the GPU, so the hierarchy is not traversed
+	if (indirect_draws_culled && indirect_instance_leaves.size() == total_draw_count)
+	{
+		visible_draw_count = indirect_culling->get_visible_instance_count();
+		culled_draw_count  = total_draw_count - visible_draw_count;
+
+		return 0;
+	}
+
+	cull_nodes();
+
+	auto camera_position = glm::vec3(camera.get_node()->get_transform().get_world_matrix()[3]);
+
+	float max_distance = 0.0f;
+
+	auto &leaves = bvh->get_leaves();
+
+	for (auto leaf_index : visible_leaves)
+	{
+		auto &leaf = leaves[leaf_index];
+
+		float distance = glm::length(camera_position - leaf.center);
+
+		max_distance = std::max(max_distance, distance);
+
+		auto &sub_meshes = leaf.mesh->get_submeshes();
+
+		for (size_t sub_mesh_index = 0; sub_mesh_index < sub_meshes.size(); ++sub_mesh_index)
+		{
+			auto sub_mesh = sub_meshes[sub_mesh_index];
+
+			// Drawn by draw_indirect
+			if (indirect_draws_culled && indirect_sub_meshes.count(sub_mesh))
+			{
+				continue;
+			}
+
+			if (sub_mesh->get_material()->alpha_mode == sg::AlphaMode::Blend)
+			{
+				transparent_draws.push_back({0, distance, leaf.node, sub_mesh});
+			}
+			else
+			{
+				uint64_t key = state_sorting ? state_keys[leaf.mesh_index][sub_mesh_index] : 0;
+
+				opaque_draws.push_back({key, distance, leaf.node, sub_mesh});
+			}
+		}
+	}
+
+	// Coarse distance in the low bits keeps draws sharing the same state front to back
+	float distance_scale = max_distance > 0.0f ? SORT_FIELD_MASK / max_distance : 0.0f;
+
+	sort_keys.clear();
+
+	for (size_t i = 0; i < opaque_draws.size(); ++i)
+	{
+		auto depth = static_cast<uint64_t>(opaque_draws[i].distance * distance_scale);
+
+		sort_keys.emplace_back(opaque_draws[i].key | std::min(depth, SORT_FIELD_MASK), to_u32(i));
+	}
+
+	radix_sort(sort_keys, sort_scratch);
+
+	// Without state sorting, draws of the same submesh are only adjacent by chance
+	if (instancing && !state_sorting)
+	{
+		group_instanced_draws();
+	}
+
+	std::sort(transparent_draws.begin(), transparent_draws.end(), [](const SortedDraw &lhs, const SortedDraw &rhs) {
+		return lhs.distance > rhs.distance;
+	});
+
+	if (indirect_draws_culled)
+	{
+		// The draws culled on the GPU are counted by the GPU, and read back a few frames later
+		visible_draw_count = opaque_draws.size() + transparent_draws.size() + indirect_culling->get_visible_instance_count();
+		culled_draw_count  = total_draw_count - visible_draw_count;
+	}
+
+	for (auto &sort_key : sort_keys)
+	{
+		auto &draw = opaque_draws[sort_key.second];
+
+		sorted_nodes.emplace_back(draw.node, draw.sub_mesh);
+	}
+
+	for (auto &draw : transparent_draws)
+	{
+		sorted_nodes.emplace_back(draw.node, draw.sub_mesh);
+	}
+
+	return opaque_draws.size();
+}
+
+void SceneSubpass::group_instanced_draws()
 {
-	// Default light
-	global_uniform.light_pos   = glm::vec4(500.0f, 1550.0f, 0.0f, 1.0);
-	global_uniform.light_color = glm::vec4(1.0, 1.0, 1.0, 1.0);
+	draw_groups.clear();
+	group_offsets.clear();
+	instanced_groups.clear();
 
-	// Build all shader variance upfront
-	auto &device = render_context.get_device();
-	for (auto &mesh : meshes)
+	// A group per instanced submesh, in the order of its nearest draw, and a group per other draw
+	for (auto &sort_key : sort_keys)
 	{
-		for (auto &sub_mesh : mesh->get_submeshes())
+		auto sub_mesh = opaque_draws[sort_key.second].sub_mesh;
+
+		auto group = to_u32(group_offsets.size());
+
+		if (instanced_variants.count(sub_mesh))
 		{
-			auto &variant     = sub_mesh->get_shader_variant();
-			auto &vert_module = device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader(), variant);
-			auto &frag_module = device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader(), variant);
+			group = instanced_groups.emplace(sub_mesh, group).first->second;
+		}
 
-			vert_module.set_resource_dynamic("GlobalUniform");
-			frag_module.set_resource_dynamic("GlobalUniform");
+		if (group == group_offsets.size())
+		{
+			group_offsets.push_back(0);
 		}
+
+		++group_offsets[group];
+
+		draw_groups.push_back(group);
+	}
+
+	uint32_t offset = 0;
+
+	for (auto &group_offset : group_offsets)
+	{
+		auto group_size = group_offset;
+		group_offset    = offset;
+		offset += group_size;
+	}
+
+	sort_scratch.resize(sort_keys.size());
+
+	for (size_t i = 0; i < sort_keys.size(); ++i)
+	{
+		sort_scratch[group_offsets[draw_groups[i]]++] = sort_keys[i];
 	}
+
+	sort_keys.swap(sort_scratch);
 }
 
 void SceneSubpass::get_sorted_nodes(std::multimap<float, std::pair<sg::Node *, sg::SubMesh *>> &opaque_nodes,
                                     std::multimap<float, std::pair<sg::Node *, sg::SubMesh *>> &transparent_nodes)
 {
+	cull_nodes();
+
 	auto camera_transform = camera.get_node()->get_transform().get_world_matrix();
 
-	for (auto &mesh : meshes)
+	auto &leaves = bvh->get_leaves();
+
+	for (auto leaf_index : visible_leaves)
+	{
+		auto &leaf = leaves[leaf_index];
+
+		float distance = glm::length(glm::vec3(camera_transform[3]) - leaf.center);
+
+		for (auto &sub_mesh : leaf.mesh->get_submeshes())
+		{
+			if (sub_mesh->get_material()->alpha_mode == sg::AlphaMode::Blend)
+			{
+				transparent_nodes.emplace(distance, std::make_pair(leaf.node, sub_mesh));
+			}
+			else
+			{
+				opaque_nodes.emplace(distance, std::make_pair(leaf.node, sub_mesh));
+			}
+		}
+	}
+}
+
+void SceneSubpass::draw(CommandBuffer &command_buffer)
+{
+	// Opaque objects in state order, then transparent objects in back-to-front order
+	size_t transparent_begin = sort_draws();
+
+	if (command_freezing)
+	{
+		draw_frozen(command_buffer, transparent_begin);
+
+		return;
+	}
+
+	update_model_uniforms();
+
+	if (thread_count > 1 && !sorted_nodes.empty())
+	{
+		draw_parallel(command_buffer, sorted_nodes, transparent_begin);
+
+		return;
+	}
+
+	draw_indirect(command_buffer);
+
+	draw_opaque(command_buffer, sorted_nodes, 0, transparent_begin, 0);
+
+	for (size_t i = transparent_begin; i < sorted_nodes.size(); ++i)
 	{
-		for (auto &node : mesh->get_nodes())
+		if (i == transparent_begin)
 		{
-			auto node_transform = node->get_transform().get_world_matrix();
+			set_transparent_states(command_buffer);
+		}
 
-			const sg::AABB &mesh_bounds = mesh->get_bounds();
+		bind_uniforms(command_buffer, i);
 
-			sg::AABB world_bounds{mesh_bounds.get_min(), mesh_bounds.get_max()};
-			world_bounds.transform(node_transform);
+		draw_submesh(command_buffer, *sorted_nodes[i].second);
+	}
+}
+
+void SceneSubpass::draw_opaque(CommandBuffer &command_buffer, const std::vector<std::pair<sg::Node *, sg::SubMesh *>> &nodes,
+                               size_t begin, size_t end, size_t thread_index)
+{
+	size_t i = begin;
 
-			float distance = glm::length(glm::vec3(camera_transform[3]) - world_bounds.get_center());
+	while (i < end)
+	{
+		auto sub_mesh = nodes[i].second;
+
+		size_t run_end = i + 1;
 
-			for (auto &sub_mesh : mesh->get_submeshes())
+		auto instanced_it = instanced_variants.find(sub_mesh);
+
+		// sort_draws keeps the draws of an instanced submesh next to each other.
+		// Instance data is written while recording, which frozen draws skip.
+		if (instancing && !command_freezing && instanced_it != instanced_variants.end())
+		{
+			while (run_end < end && nodes[run_end].second == sub_mesh)
 			{
-				if (sub_mesh->get_material()->alpha_mode == sg::AlphaMode::Blend)
-				{
-					transparent_nodes.emplace(distance, std::make_pair(node, sub_mesh));
-				}
-				else
-				{
-					opaque_nodes.emplace(distance, std::make_pair(node, sub_mesh));
-				}
+				++run_end;
 			}
 		}
+
+		if (run_end - i > 1)
+		{
+			draw_instanced(command_buffer, nodes, i, run_end, instanced_it->second, thread_index);
+		}
+		else
+		{
+			bind_uniforms(command_buffer, i);
+
+			draw_submesh(command_buffer, *sub_mesh);
+		}
+
+		i = run_end;
 	}
 }
 
-void SceneSubpass::draw(CommandBuffer &command_buffer)
+void SceneSubpass::draw_instanced(CommandBuffer &command_buffer, const std::vector<std::pair<sg::Node *, sg::SubMesh *>> &nodes,
+                                  size_t begin, size_t end, const InstancedVariant &instanced_variant, size_t thread_index)
 {
-	std::multimap<float, std::pair<sg::Node *, sg::SubMesh *>> opaque_nodes;
-	std::multimap<float, std::pair<sg::Node *, sg::SubMesh *>> transparent_nodes;
+	auto &sub_mesh = *nodes[begin].second;
 
-	get_sorted_nodes(opaque_nodes, transparent_nodes);
+	auto instance_count = to_u32(end - begin);
 
 	auto &render_frame = get_render_context().get_active_frame();
 
-	// Draw opaque objects in front-to-back order
-	for (auto node_it = opaque_nodes.begin(); node_it != opaque_nodes.end(); node_it++)
-	{
-		update_uniform(command_buffer, *node_it->second.first);
+	auto allocation = render_frame.allocate_buffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, instance_count * sizeof(glm::mat4), thread_index);
 
-		draw_submesh(command_buffer, *node_it->second.second);
+	for (uint32_t i = 0; i < instance_count; ++i)
+	{
+		allocation.update(nodes[begin + i].first->get_transform().get_world_matrix(), to_u32(i * sizeof(glm::mat4)));
 	}
 
+	// The world matrices come from the instance data
+	bind_uniforms(command_buffer, begin);
+
+	bind_submesh(command_buffer, sub_mesh, instanced_variant.variant);
+
+	std::vector<std::reference_wrapper<const core::Buffer>> buffers;
+	buffers.emplace_back(std::ref(allocation.get_buffer()));
+
+	command_buffer.bind_vertex_buffers(instanced_variant.location, std::move(buffers), {allocation.get_offset()});
+
+	draw_submesh_command(command_buffer, sub_mesh, instance_count);
+}
+
+void SceneSubpass::set_transparent_states(CommandBuffer &command_buffer)
+{
 	// Enable alpha blending
 	ColorBlendAttachmentState color_blend_attachment{};
 	color_blend_attachment.blend_enable           = VK_TRUE;
@@ -121,34 +827,310 @@ void SceneSubpass::draw(CommandBuffer &command_buffer)
 	command_buffer.set_color_blend_state(color_blend_state);
 
 	command_buffer.set_depth_stencil_state(get_depth_stencil_state());
+}
+
+void SceneSubpass::draw_parallel(CommandBuffer &primary_command_buffer, const std::vector<std::pair<sg::Node *, sg::SubMesh *>> &nodes, size_t transparent_begin)
+{
+	if (nodes.empty())
+	{
+		return;
+	}
+
+	auto &render_frame = get_render_context().get_active_frame();
+
+	auto range_count = std::min({thread_count, render_frame.get_thread_count(), nodes.size()});
+	auto range_size  = (nodes.size() + range_count - 1) / range_count;
+
+	const auto &queue = get_render_context().get_device().get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT, 0);
+
+	// Matching the primary reset mode keeps its pool from being re-created
+	auto reset_mode = primary_command_buffer.get_reset_mode();
+
+	// Command buffers are requested on the calling thread, each from the pool of the thread which records it,
+	// as a Vulkan command pool must not be used by several threads at the same time
+	std::vector<CommandBuffer *> secondary_command_buffers;
+
+	for (size_t i = 0; i < range_count; ++i)
+	{
+		auto &command_pool = render_frame.get_command_pool(queue, reset_mode, i);
+
+		secondary_command_buffers.push_back(&command_pool.request_command_buffer(VK_COMMAND_BUFFER_LEVEL_SECONDARY));
+	}
+
+	// World matrices were updated by sort_draws, so the workers only read the scene
+	std::vector<std::future<void>> futures;
+
+	for (size_t i = 1; i < range_count; ++i)
+	{
+		futures.push_back(thread_pool->push([&, i](size_t) {
+			auto &secondary_command_buffer = *secondary_command_buffers[i];
+
+			secondary_command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &primary_command_buffer);
+
+			record_draws(secondary_command_buffer, nodes, i * range_size, std::min((i + 1) * range_size, nodes.size()), transparent_begin, i);
+
+			secondary_command_buffer.end();
+		}));
+	}
+
+	std::exception_ptr exception;
+
+	try
+	{
+		auto &secondary_command_buffer = *secondary_command_buffers[0];
+
+		secondary_command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &primary_command_buffer);
+
+		record_draws(secondary_command_buffer, nodes, 0, std::min(range_size, nodes.size()), transparent_begin, 0);
 
-	// Draw transparent objects in back-to-front order
-	for (auto node_it = transparent_nodes.rbegin(); node_it != transparent_nodes.rend(); node_it++)
+		secondary_command_buffer.end();
+	}
+	catch (...)
+	{
+		exception = std::current_exception();
+	}
+
+	// The workers refer to this stack frame, so all of them are joined before any exception is propagated
+	for (auto &future : futures)
 	{
-		update_uniform(command_buffer, *node_it->second.first);
+		try
+		{
+			future.get();
+		}
+		catch (...)
+		{
+			if (!exception)
+			{
+				exception = std::current_exception();
+			}
+		}
+	}
 
-		draw_submesh(command_buffer, *node_it->second.second);
+	if (exception)
+	{
+		std::rethrow_exception(exception);
 	}
+
+	primary_command_buffer.execute_commands(secondary_command_buffers);
 }
 
-void SceneSubpass::update_uniform(CommandBuffer &command_buffer, sg::Node &node)
+void SceneSubpass::draw_frozen(CommandBuffer &primary_command_buffer, size_t transparent_begin)
 {
-	global_uniform.camera_view_proj = vkb::vulkan_style_projection(camera.get_projection()) * camera.get_view();
+	auto &render_context = get_render_context();
+
+	auto &device = render_context.get_device();
+
+	// Buffers of a frame are not in use by the GPU anymore once the frame is active again
+	auto frame_index = render_context.get_active_frame_index();
+
+	if (frozen_frames.size() <= frame_index)
+	{
+		frozen_frames.resize(frame_index + 1);
+	}
+
+	auto &frame = frozen_frames[frame_index];
+
+	// The world matrices follow the global uniform at an aligned offset
+	auto models_offset = (sizeof(GlobalUniform) + model_uniform_stride - 1) / model_uniform_stride * model_uniform_stride;
+
+	auto uniforms_size = models_offset + std::max<size_t>(sorted_nodes.size(), 1) * model_uniform_stride;
+
+	if (!frame.uniform_buffer || frame.uniform_buffer->get_size() < uniforms_size)
+	{
+		release_frozen_frame(frame);
+
+		frame.uniform_buffer = std::make_unique<core::Buffer>(device,
+		                                                      uniforms_size,
+		                                                      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		                                                      VMA_MEMORY_USAGE_CPU_TO_GPU,
+		                                                      VMA_ALLOCATION_CREATE_MAPPED_BIT);
+	}
+
+	// The frozen draws bind the same ranges every frame, only their contents change
+	frame_uniform = BufferAllocation{*frame.uniform_buffer, sizeof(GlobalUniform), 0};
+
+	frame_uniform.update(global_uniform);
+
+	model_uniforms = BufferAllocation{*frame.uniform_buffer, sorted_nodes.size() * model_uniform_stride, models_offset};
+
+	size_t inputs_hash = 0;
+
+	hash_combine(inputs_hash, transparent_begin);
+	hash_combine(inputs_hash, indirect_draws_culled);
+
+	for (size_t i = 0; i < sorted_nodes.size(); ++i)
+	{
+		model_uniforms.update(sorted_nodes[i].first->get_transform().get_world_matrix(), to_u32(i * model_uniform_stride));
+
+		hash_combine(inputs_hash, sorted_nodes[i].first);
+		hash_combine(inputs_hash, sorted_nodes[i].second);
+	}
+
+	const auto &queue = device.get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT, 0);
+
+	// Matching the primary reset mode keeps its pool from being re-created
+	auto &command_pool = render_context.get_active_frame().get_command_pool(queue, primary_command_buffer.get_reset_mode());
+
+	auto &secondary_command_buffer = command_pool.request_command_buffer(VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+
+	secondary_command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &primary_command_buffer);
+
+	auto &render_target = primary_command_buffer.get_recorder().get_render_pass_bindings().back().render_target;
+
+	bool replay = frame.commands && frame.commands->is_valid(inputs_hash, render_target);
+
+	if (replay)
+	{
+		secondary_command_buffer.replay_frozen(*frame.commands);
+
+		++frozen_replay_count;
+	}
+	else
+	{
+		record_draws(secondary_command_buffer, sorted_nodes, 0, sorted_nodes.size(), transparent_begin, 0);
+	}
+
+	secondary_command_buffer.end();
+
+	std::vector<CommandBuffer *> secondary_command_buffers{&secondary_command_buffer};
+
+	primary_command_buffer.execute_commands(secondary_command_buffers);
+
+	if (!replay)
+	{
+		frame.commands = std::make_unique<FrozenCommands>(secondary_command_buffer, inputs_hash);
+	}
+}
+
+void SceneSubpass::release_frozen_frame(FrozenFrame &frame)
+{
+	frame.commands.reset();
+
+	if (frame.uniform_buffer)
+	{
+		get_render_context().get_device().get_resource_cache().clear_descriptor_sets({frame.uniform_buffer->get_handle()});
+
+		frame.uniform_buffer.reset();
+	}
+}
+
+void SceneSubpass::record_draws(CommandBuffer &command_buffer, const std::vector<std::pair<sg::Node *, sg::SubMesh *>> &nodes,
+                                size_t begin, size_t end, size_t transparent_begin, size_t thread_index)
+{
+	auto &extent = command_buffer.get_recorder().get_render_pass_bindings().back().render_target.get_extent();
+
+	VkViewport viewport{};
+	viewport.width    = static_cast<float>(extent.width);
+	viewport.height   = static_cast<float>(extent.height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	command_buffer.set_viewport(0, {viewport});
+
+	VkRect2D scissor{};
+	scissor.extent = extent;
+	command_buffer.set_scissor(0, {scissor});
+
+	// The draws culled on the GPU go first, as when the draws are recorded inline
+	if (begin == 0)
+	{
+		draw_indirect(command_buffer);
+	}
+
+	auto opaque_end = std::min(std::max(begin, transparent_begin), end);
+
+	draw_opaque(command_buffer, nodes, begin, opaque_end, thread_index);
+
+	for (size_t i = opaque_end; i < end; ++i)
+	{
+		if (i == opaque_end)
+		{
+			set_transparent_states(command_buffer);
+		}
+
+		bind_uniforms(command_buffer, i);
+
+		draw_submesh(command_buffer, *nodes[i].second);
+	}
+}
+
+void SceneSubpass::update_uniform(CommandBuffer &command_buffer, sg::Node &node, size_t thread_index)
+{
+	auto &render_frame = get_render_context().get_active_frame();
+
+	auto allocation = render_frame.allocate_buffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(glm::mat4), thread_index);
+
+	allocation.update(node.get_transform().get_world_matrix());
+
+	command_buffer.bind_buffer(frame_uniform.get_buffer(), frame_uniform.get_offset(), frame_uniform.get_size(), 0, 1, 0);
+
+	command_buffer.bind_buffer(allocation.get_buffer(), allocation.get_offset(), allocation.get_size(), 0, 2, 0);
+}
+
+void SceneSubpass::update_model_uniforms()
+{
+	if (sorted_nodes.empty())
+	{
+		return;
+	}
 
 	auto &render_frame = get_render_context().get_active_frame();
 
-	auto &transform = node.get_transform();
+	model_uniforms = render_frame.allocate_buffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sorted_nodes.size() * model_uniform_stride);
+
+	for (size_t i = 0; i < sorted_nodes.size(); ++i)
+	{
+		model_uniforms.update(sorted_nodes[i].first->get_transform().get_world_matrix(), to_u32(i * model_uniform_stride));
+	}
+}
+
+void SceneSubpass::bind_uniforms(CommandBuffer &command_buffer, size_t draw_index)
+{
+	command_buffer.bind_buffer(frame_uniform.get_buffer(), frame_uniform.get_offset(), frame_uniform.get_size(), 0, 1, 0);
+
+	// Every draw binds the same range of the same buffer, so only the dynamic offset changes
+	command_buffer.bind_buffer(model_uniforms.get_buffer(), model_uniforms.get_offset() + draw_index * model_uniform_stride, sizeof(glm::mat4), 0, 2, 0);
+}
+
+void SceneSubpass::draw_indirect(CommandBuffer &command_buffer)
+{
+	if (!indirect_draws_culled || indirect_draws.empty())
+	{
+		return;
+	}
+
+	auto &indirect_buffer         = indirect_culling->get_indirect_buffer();
+	auto &model_buffer            = indirect_culling->get_model_buffer();
+	auto &visible_instance_buffer = indirect_culling->get_visible_instance_buffer();
+
+	uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+	for (size_t i = 0; i < indirect_draws.size(); ++i)
+	{
+		auto &sub_mesh = *indirect_draws[i].sub_mesh;
+
+		bind_submesh(command_buffer, sub_mesh, indirect_draws[i].variant);
 
-	auto allocation = render_frame.allocate_buffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(GlobalUniform));
+		command_buffer.bind_buffer(frame_uniform.get_buffer(), frame_uniform.get_offset(), frame_uniform.get_size(), 0, 1, 0);
+		command_buffer.bind_buffer(model_buffer, 0, model_buffer.get_size(), 0, 3, 0);
+		command_buffer.bind_buffer(visible_instance_buffer, 0, visible_instance_buffer.get_size(), 0, 4, 0);
 
-	global_uniform.model = transform.get_world_matrix();
+		command_buffer.bind_index_buffer(*sub_mesh.index_buffer, sub_mesh.index_offset, sub_mesh.index_type);
 
-	allocation.update(global_uniform);
+		command_buffer.push_constants(INDIRECT_DRAW_UNIFORM_OFFSET, indirect_culling->get_first_visible_instance(i));
 
-	command_buffer.bind_buffer(allocation.get_buffer(), allocation.get_offset(), allocation.get_size(), 0, 1, 0);
+		// Issues the visible instances of the submesh, possibly none
+		command_buffer.draw_indexed_indirect(indirect_buffer, i * stride, 1, stride);
+	}
 }
 
 void SceneSubpass::draw_submesh(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh)
+{
+	bind_submesh(command_buffer, sub_mesh, sub_mesh.get_shader_variant());
+
+	draw_submesh_command(command_buffer, sub_mesh);
+}
+
+void SceneSubpass::bind_submesh(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh, const ShaderVariant &variant)
 {
 	auto &device = command_buffer.get_device();
 
@@ -161,8 +1143,8 @@ void SceneSubpass::draw_submesh(CommandBuffer &command_buffer, sg::SubMesh &sub_
 
 	command_buffer.set_rasterization_state(rasterization_state);
 
-	auto &vert_shader_module = device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader(), sub_mesh.get_shader_variant());
-	auto &frag_shader_module = device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader(), sub_mesh.get_shader_variant());
+	auto &vert_shader_module = device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader(), variant);
+	auto &frag_shader_module = device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader(), variant);
 
 	std::vector<ShaderModule *> shader_modules{&vert_shader_module, &frag_shader_module};
 
@@ -199,6 +1181,30 @@ void SceneSubpass::draw_submesh(CommandBuffer &command_buffer, sg::SubMesh &sub_
 
 	for (auto &input_resource : vertex_input_resources)
 	{
+		// One world matrix per instance, its columns take consecutive locations
+		if (input_resource.name == INSTANCE_MODEL_INPUT)
+		{
+			for (uint32_t column = 0; column < input_resource.columns; ++column)
+			{
+				VkVertexInputAttributeDescription instance_attribute{};
+				instance_attribute.binding  = input_resource.location;
+				instance_attribute.format   = VK_FORMAT_R32G32B32A32_SFLOAT;
+				instance_attribute.location = input_resource.location + column;
+				instance_attribute.offset   = column * sizeof(glm::vec4);
+
+				vertex_input_state.attributes.push_back(instance_attribute);
+			}
+
+			VkVertexInputBindingDescription instance_binding{};
+			instance_binding.binding   = input_resource.location;
+			instance_binding.stride    = sizeof(glm::mat4);
+			instance_binding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+			vertex_input_state.bindings.push_back(instance_binding);
+
+			continue;
+		}
+
 		sg::VertexAttribute attribute;
 
 		if (!sub_mesh.get_attribute(input_resource.name, attribute))
@@ -237,11 +1243,9 @@ void SceneSubpass::draw_submesh(CommandBuffer &command_buffer, sg::SubMesh &sub_
 			command_buffer.bind_vertex_buffers(input_resource.location, std::move(buffers), {0});
 		}
 	}
-
-	draw_submesh_command(command_buffer, sub_mesh);
 }
 
-void SceneSubpass::draw_submesh_command(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh)
+void SceneSubpass::draw_submesh_command(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh, uint32_t instance_count)
 {
 	// Draw submesh indexed if indices exists
 	if (sub_mesh.vertex_indices != 0)
@@ -250,12 +1254,12 @@ void SceneSubpass::draw_submesh_command(CommandBuffer &command_buffer, sg::SubMe
 		command_buffer.bind_index_buffer(*sub_mesh.index_buffer, sub_mesh.index_offset, sub_mesh.index_type);
 
 		// Draw submesh using indexed data
-		command_buffer.draw_indexed(sub_mesh.vertex_indices, 1, 0, 0, 0);
+		command_buffer.draw_indexed(sub_mesh.vertex_indices, instance_count, 0, 0, 0);
 	}
 	else
 	{
 		// Draw submesh using vertices only
-		command_buffer.draw(sub_mesh.vertices_count, 1, 0, 0);
+		command_buffer.draw(sub_mesh.vertices_count, instance_count, 0, 0);
 	}
 }
 }        // namespace vkb
@@ -20,16 +20,28 @@
 
 #pragma once
 
+#include <unordered_map>
+#include <unordered_set>
+
 #include "common/error.h"
 
 VKBP_DISABLE_WARNINGS()
 #include <glm/glm.hpp>
 VKBP_ENABLE_WARNINGS()
 
+#include "buffer_pool.h"
 #include "rendering/subpass.h"
 
+namespace ctpl
+{
+class thread_pool;
+}        // namespace ctpl
+
 namespace vkb
 {
+class FrozenCommands;
+class IndirectCulling;
+
 namespace sg
 {
 class Scene;
@@ -37,15 +49,15 @@ class Node;
 class Mesh;
 class SubMesh;
 class Camera;
+class BVH;
 }        // namespace sg
 
 /**
- * @brief Global uniform structure for base shader
+ * @brief Global uniform structure for base shader, written once per frame.
+ *        The world matrix of each draw is in a separate uniform at binding 2.
  */
 struct alignas(16) GlobalUniform
 {
-	glm::mat4 model;
-
 	glm::mat4 camera_view_proj;
 
 	glm::vec4 light_pos;
@@ -81,33 +93,352 @@ class SceneSubpass : public Subpass
 	 */
 	SceneSubpass(RenderContext &render_context, ShaderSource &&vertex_shader, ShaderSource &&fragment_shader, sg::Scene &scene, sg::Camera &camera);
 
-	virtual ~SceneSubpass() = default;
+	virtual ~SceneSubpass();
+
+	/**
+	 * @brief Refits the scene hierarchy, writes the global uniform of the frame,
+	 *        and culls the draws on the GPU when enabled, see set_gpu_culling
+	 */
+	virtual void prepare(CommandBuffer &command_buffer) override;
 
 	/**
 	 * @brief Record draw commands
 	 */
 	virtual void draw(CommandBuffer &command_buffer) override;
 
-	void update_uniform(CommandBuffer &command_buffer, sg::Node &node);
+	/**
+	 * @brief Splits the sorted draws into contiguous ranges, which are recorded in parallel into
+	 *        one secondary command buffer per thread and then executed in order.
+	 *        Dynamic states are not inherited by secondary command buffers, so the viewport and scissor
+	 *        of each of them cover the whole render target.
+	 * @param thread_count Number of threads recording the draws, including the calling one.
+	 *        With 1 thread the draws are recorded directly into the subpass command buffer.
+	 *        It is limited to the number of threads of the render frame at draw time.
+	 */
+	void set_thread_count(size_t thread_count);
+
+	size_t get_thread_count() const;
+
+	/**
+	 * @brief Orders opaque draws by pipeline, material, mesh and then distance, so consecutive draws share
+	 *        as much state as possible. When disabled they are only ordered by distance, front to back.
+	 *        Transparent draws are always ordered back to front.
+	 */
+	void set_state_sorting(bool enabled);
+
+	bool is_state_sorting() const;
+
+	/**
+	 * @brief Skips the nodes whose world bounds are outside of the camera frustum, on the CPU or on the GPU
+	 */
+	void set_frustum_culling(bool enabled);
+
+	bool is_frustum_culling() const;
+
+	/**
+	 * @brief Culls the nodes of the opaque indexed submeshes in a compute shader, see IndirectCulling.
+	 *        Each submesh is drawn with one indirect draw of its visible nodes, using the GPU_CULLING variant
+	 *        of its shaders, so the draws recorded do not depend on the number of nodes or on culling.
+	 *        The submeshes whose variant does not read the culled instances keep the CPU path, like the other draws,
+	 *        which is skipped along with the CPU culling when every submesh is culled on the GPU.
+	 *        The indirect draws go first, in the first secondary command buffer when recording in parallel.
+	 *        Their visible and culled counts are read back from the GPU, and are a few frames late.
+	 */
+	void set_gpu_culling(bool enabled);
+
+	bool is_gpu_culling() const;
+
+	/**
+	 * @brief Merges consecutive opaque draws of the same submesh into one instanced draw,
+	 *        taking the world matrices from a per-frame vertex buffer instead of the global uniform.
+	 *        Only submeshes of meshes used by several nodes are instanced, with the INSTANCING
+	 *        variant of their shaders, and only when that variant declares the instance input.
+	 *        State sorting keeps the draws of a submesh together. Without it the draws of each
+	 *        instanced submesh are gathered where the nearest of them is, the other draws keep their order.
+	 */
+	void set_instancing(bool enabled);
+
+	bool is_instancing() const;
+
+	/**
+	 * @brief Records the draws into one secondary command buffer per frame in flight, which is frozen and replayed
+	 *        by the following frames, see FrozenCommands. The draws are recorded again when the visible draws
+	 *        or their order change, or when the render target changes. The uniforms are written every frame into
+	 *        buffers owned by the subpass, at the offsets the frozen commands read them from.
+	 *        Instancing and parallel recording are not used while freezing.
+	 */
+	void set_command_freezing(bool enabled);
+
+	bool is_command_freezing() const;
+
+	/**
+	 * @return Number of frames which replayed frozen draws instead of recording them
+	 */
+	size_t get_frozen_replay_count() const;
+
+	/**
+	 * @return Number of submesh draws inside of the camera frustum during the last draw
+	 */
+	size_t get_visible_draw_count() const;
+
+	/**
+	 * @return Number of submesh draws skipped by frustum culling during the last draw
+	 */
+	size_t get_culled_draw_count() const;
+
+	/**
+	 * @brief Binds the global uniform of the frame along with a new allocation holding the world matrix of a node.
+	 *        The draws recorded by draw() use the matrices written for the whole frame instead.
+	 * @param thread_index Index of the thread recording the command buffer, selecting the frame buffer pool to allocate from
+	 */
+	void update_uniform(CommandBuffer &command_buffer, sg::Node &node, size_t thread_index = 0);
 
 	void draw_submesh(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh);
 
   protected:
 	/**
-	 * @brief Sorts objects based on distance from camera and classifies them
-	 *        into opaque and transparent in the arrays provided
+	 * @brief Sorts objects inside of the camera frustum based on distance from camera
+	 *        and classifies them into opaque and transparent in the arrays provided
 	 */
 	void get_sorted_nodes(std::multimap<float, std::pair<sg::Node *, sg::SubMesh *>> &opaque_nodes,
 	                      std::multimap<float, std::pair<sg::Node *, sg::SubMesh *>> &transparent_nodes);
 
+	/**
+	 * @brief Sets the color blend and depth stencil states used to draw transparent objects
+	 */
+	void set_transparent_states(CommandBuffer &command_buffer);
+
   private:
-	void draw_submesh_command(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh);
+	/**
+	 * @brief A draw of a submesh by a node, with the key it is sorted by
+	 */
+	struct SortedDraw
+	{
+		uint64_t key;
+
+		float distance;
+
+		sg::Node *node;
+
+		sg::SubMesh *sub_mesh;
+	};
+
+	/**
+	 * @brief A submesh culled on the GPU, drawn with the variant of its shaders reading the culled instances
+	 */
+	struct IndirectDraw
+	{
+		sg::SubMesh *sub_mesh;
+
+		ShaderVariant variant;
+	};
+
+	/**
+	 * @brief Shader variant of a submesh reading its world matrices from instance data
+	 */
+	struct InstancedVariant
+	{
+		ShaderVariant variant;
+
+		/// First location of the instance world matrix, one per column
+		uint32_t location;
+	};
+
+	/**
+	 * @brief Uniforms and frozen draws of a frame in flight, see set_command_freezing
+	 */
+	struct FrozenFrame
+	{
+		/// Global uniform followed by the world matrices of the draws
+		std::unique_ptr<core::Buffer> uniform_buffer;
+
+		std::unique_ptr<FrozenCommands> commands;
+	};
+
+	/**
+	 * @brief Prepares the instanced variant of the submeshes of meshes used by several nodes, see set_instancing
+	 */
+	void prepare_instanced_variants();
+
+	/**
+	 * @brief Collects the leaves of the scene hierarchy inside of the camera frustum, the hierarchy is refit by prepare
+	 */
+	void cull_nodes();
+
+	/**
+	 * @brief Builds the state part of the sort key of each submesh, see set_state_sorting
+	 */
+	void prepare_state_keys();
+
+	/**
+	 * @brief Fills sorted_nodes with the opaque draws in key order followed by the transparent draws back to front
+	 * @return Index of the first transparent node
+	 */
+	size_t sort_draws();
+
+	/**
+	 * @brief Moves the opaque draws of each instanced submesh next to the nearest of them, for when they are not sorted by state
+	 */
+	void group_instanced_draws();
+
+	/**
+	 * @brief Writes the world matrices of the sorted draws into one allocation so that the draws only change a dynamic offset
+	 */
+	void update_model_uniforms();
+
+	/**
+	 * @brief Binds the global uniform and the world matrix written for a draw by update_model_uniforms
+	 * @param draw_index Index of the draw in the sorted draws
+	 */
+	void bind_uniforms(CommandBuffer &command_buffer, size_t draw_index);
+
+	/**
+	 * @brief Collects the submeshes culled on the GPU in state order along with their nodes,
+	 *        then uploads their arguments and the world matrices and bounds of the nodes
+	 */
+	void prepare_indirect_draws();
+
+	/**
+	 * @brief Uploads the world matrices and bounds of the nodes culled on the GPU
+	 */
+	void update_indirect_instances();
+
+	/**
+	 * @brief Records one indirect draw per submesh culled on the GPU
+	 */
+	void draw_indirect(CommandBuffer &command_buffer);
+
+	/**
+	 * @brief Sets the pipeline state, push constants, textures and vertex buffers of a submesh
+	 * @param variant Variant of the shaders to draw the submesh with
+	 */
+	void bind_submesh(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh, const ShaderVariant &variant);
+
+	void draw_submesh_command(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh, uint32_t instance_count = 1);
+
+	/**
+	 * @brief Records a range of opaque draws, merging the consecutive draws of an instanced submesh
+	 */
+	void draw_opaque(CommandBuffer &command_buffer, const std::vector<std::pair<sg::Node *, sg::SubMesh *>> &nodes,
+	                 size_t begin, size_t end, size_t thread_index);
+
+	/**
+	 * @brief Records the draws of a range of nodes sharing the same submesh as one instanced draw
+	 */
+	void draw_instanced(CommandBuffer &command_buffer, const std::vector<std::pair<sg::Node *, sg::SubMesh *>> &nodes,
+	                    size_t begin, size_t end, const InstancedVariant &instanced_variant, size_t thread_index);
+
+	/**
+	 * @brief Writes the uniforms of the active frame into its own buffer, then replays its frozen draws,
+	 *        or records and freezes them if they changed
+	 * @param transparent_begin Index of the first transparent node in the sorted nodes
+	 */
+	void draw_frozen(CommandBuffer &primary_command_buffer, size_t transparent_begin);
+
+	/**
+	 * @brief Destroys the uniform buffer and the frozen draws of a frame, along with the cached descriptor sets writing the buffer
+	 */
+	void release_frozen_frame(FrozenFrame &frame);
+
+	/**
+	 * @brief Records the draws on the thread pool, see set_thread_count
+	 * @param nodes Nodes in draw order, opaque ones first
+	 * @param transparent_begin Index of the first transparent node
+	 */
+	void draw_parallel(CommandBuffer &primary_command_buffer, const std::vector<std::pair<sg::Node *, sg::SubMesh *>> &nodes, size_t transparent_begin);
+
+	/**
+	 * @brief Records a range of draws into a secondary command buffer
+	 */
+	void record_draws(CommandBuffer &command_buffer, const std::vector<std::pair<sg::Node *, sg::SubMesh *>> &nodes,
+	                  size_t begin, size_t end, size_t transparent_begin, size_t thread_index);
 
 	sg::Camera &camera;
 
 	std::vector<sg::Mesh *> meshes;
 
 	GlobalUniform global_uniform;
+
+	/// Global uniform written by prepare for the current frame
+	BufferAllocation frame_uniform;
+
+	/// World matrices of the draws of the current frame, one every model_uniform_stride bytes
+	BufferAllocation model_uniforms;
+
+	/// Size of a world matrix rounded up to the minimum uniform buffer offset alignment
+	VkDeviceSize model_uniform_stride{0};
+
+	size_t thread_count{1};
+
+	/// Workers recording the draws along with the calling thread
+	std::unique_ptr<ctpl::thread_pool> thread_pool;
+
+	bool state_sorting{true};
+
+	bool frustum_culling{true};
+
+	/// Hierarchy over the nodes of the scene meshes, built from the same mesh list as meshes
+	sg::BVH *bvh{nullptr};
+
+	/// Leaves of the hierarchy inside of the camera frustum
+	std::vector<uint32_t> visible_leaves;
+
+	size_t total_draw_count{0};
+
+	size_t visible_draw_count{0};
+
+	size_t culled_draw_count{0};
+
+	bool gpu_culling{false};
+
+	std::unique_ptr<IndirectCulling> indirect_culling;
+
+	/// Set by prepare when the draws of the current frame were culled on the GPU
+	bool indirect_draws_culled{false};
+
+	/// Submeshes culled on the GPU, in the order of their indirect arguments
+	std::vector<IndirectDraw> indirect_draws;
+
+	std::unordered_set<const sg::SubMesh *> indirect_sub_meshes;
+
+	/// Leaf of the hierarchy of each instance culled on the GPU
+	std::vector<uint32_t> indirect_instance_leaves;
+
+	/// Revision of the hierarchy the uploaded instances come from
+	uint32_t indirect_instances_revision{0};
+
+	bool instancing{true};
+
+	/// Submeshes which can be drawn with instancing
+	std::unordered_map<const sg::SubMesh *, InstancedVariant> instanced_variants;
+
+	bool command_freezing{false};
+
+	/// Indexed by frame in flight
+	std::vector<FrozenFrame> frozen_frames;
+
+	size_t frozen_replay_count{0};
+
+	/// Pipeline, material and mesh identifiers packed in the high bits of the sort key, for each submesh of each mesh
+	std::vector<std::vector<uint64_t>> state_keys;
+
+	/// Arrays reused across frames to sort the draws without allocating
+	std::vector<SortedDraw> opaque_draws;
+
+	std::vector<SortedDraw> transparent_draws;
+
+	std::vector<std::pair<uint64_t, uint32_t>> sort_keys;
+
+	std::vector<std::pair<uint64_t, uint32_t>> sort_scratch;
+
+	/// Group of each sorted opaque draw, then where each group starts, see group_instanced_draws
+	std::vector<uint32_t> draw_groups;
+
+	std::vector<uint32_t> group_offsets;
+
+	std::unordered_map<const sg::SubMesh *, uint32_t> instanced_groups;
+
+	std::vector<std::pair<sg::Node *, sg::SubMesh *>> sorted_nodes;
 };
 
 }        // namespace vkb
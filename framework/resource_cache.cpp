@@ -20,126 +20,212 @@
 
 #include "resource_cache.h"
 
+#include <algorithm>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
+#include <ctpl_stl.h>
+
+#include "core/device.h"
+#include "timer.h"
+
 namespace vkb
 {
 namespace
 {
+/**
+ * @brief Appends the raw bytes of a value to a resource key.
+ *        Only types without padding may be packed this way, otherwise equal values could produce different keys.
+ */
 template <typename T>
-inline void hash_param(size_t &seed, const T &value)
+inline void pack_param(ResourceKey &key, const T &value)
 {
-	hash_combine(seed, value);
+	static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be packed as raw bytes");
+
+	auto data = reinterpret_cast<const uint8_t *>(&value);
+	key.hashed.insert(key.hashed.end(), data, data + sizeof(T));
 }
 
 template <>
-inline void hash_param(size_t & /*seed*/, const VkPipelineCache & /*value*/)
+inline void pack_param<VkPipelineCache>(ResourceKey & /*key*/, const VkPipelineCache & /*value*/)
 {
 }
 
-template <>
-inline void hash_param<std::vector<uint8_t>>(
-    size_t &                    seed,
-    const std::vector<uint8_t> &value)
+inline void pack_param(ResourceKey & /*key*/, const ThreadPipelineCache & /*value*/)
 {
-	hash_combine(seed, std::string{value.begin(), value.end()});
 }
 
-template <>
-inline void hash_param<std::vector<Attachment>>(
-    size_t &                       seed,
-    const std::vector<Attachment> &value)
+// Containers are declared ahead, but defined after all overloads so they can pack any element type
+template <class T>
+inline void pack_param(ResourceKey &key, const std::vector<T> &value);
+
+template <class T>
+inline void pack_param(ResourceKey &key, const BindingMap<T> &value);
+
+inline void pack_param(ResourceKey &key, const std::string &value)
 {
-	for (auto &attachment : value)
-	{
-		hash_combine(seed, attachment);
-	}
+	pack_param(key, value.size());
+
+	key.hashed.insert(key.hashed.end(), value.begin(), value.end());
 }
 
-template <>
-inline void hash_param<std::vector<LoadStoreInfo>>(
-    size_t &                          seed,
-    const std::vector<LoadStoreInfo> &value)
+inline void pack_param(ResourceKey &key, const ShaderSource &shader_source)
+{
+	pack_param(key, shader_source.get_id());
+}
+
+inline void pack_param(ResourceKey &key, const ShaderVariant &shader_variant)
 {
-	for (auto &load_store_info : value)
+	pack_param(key, shader_variant.get_id());
+}
+
+inline void pack_param(ResourceKey &key, ShaderModule *const &shader_module)
+{
+	pack_param(key, shader_module->get_id());
+}
+
+inline void pack_param(ResourceKey &key, const SubpassInfo &subpass_info)
+{
+	pack_param(key, subpass_info.input_attachments);
+	pack_param(key, subpass_info.output_attachments);
+}
+
+inline void pack_param(ResourceKey &key, const ShaderResource &shader_resource)
+{
+	// Resources without a binding point do not take part in descriptor set layouts
+	if (shader_resource.type == ShaderResourceType::Input ||
+	    shader_resource.type == ShaderResourceType::Output ||
+	    shader_resource.type == ShaderResourceType::PushConstant ||
+	    shader_resource.type == ShaderResourceType::SpecializationConstant)
 	{
-		hash_combine(seed, load_store_info);
+		return;
 	}
+
+	pack_param(key, shader_resource.set);
+	pack_param(key, shader_resource.binding);
+	pack_param(key, shader_resource.type);
+	pack_param(key, shader_resource.array_size);
+	pack_param(key, shader_resource.stages);
+	pack_param(key, static_cast<uint32_t>(shader_resource.dynamic));
 }
 
-template <>
-inline void hash_param<std::vector<SubpassInfo>>(
-    size_t &                        seed,
-    const std::vector<SubpassInfo> &value)
+inline void pack_param(ResourceKey &key, const DescriptorSetLayout &descriptor_set_layout)
 {
-	for (auto &subpass_info : value)
+	pack_param(key, descriptor_set_layout.get_handle());
+}
+
+inline void pack_param(ResourceKey &key, const VkDescriptorImageInfo &descriptor_image_info)
+{
+	// Packed field by field to skip the padding at the end of the structure
+	pack_param(key, descriptor_image_info.sampler);
+	pack_param(key, descriptor_image_info.imageView);
+	pack_param(key, descriptor_image_info.imageLayout);
+}
+
+inline void pack_param(ResourceKey &key, const RenderTarget &render_target)
+{
+	pack_param(key, render_target.get_views().size());
+
+	for (auto &view : render_target.get_views())
 	{
-		hash_combine(seed, subpass_info);
+		pack_param(key, view.get_handle());
 	}
 }
 
-template <>
-inline void hash_param<std::vector<ShaderModule *>>(
-    size_t &                           seed,
-    const std::vector<ShaderModule *> &value)
+inline void pack_param(ResourceKey &key, const RenderPass &render_pass)
 {
-	for (auto &shader_module : value)
+	pack_param(key, render_pass.get_handle());
+}
+
+inline void pack_param(ResourceKey &key, const SpecializationConstantState &specialization_constant_state)
+{
+	auto &constants = specialization_constant_state.get_specialization_constant_state();
+
+	pack_param(key, constants.size());
+
+	for (auto &constant : constants)
 	{
-		hash_combine(seed, shader_module->get_id());
+		pack_param(key, constant.first);
+		pack_param(key, constant.second);
 	}
 }
 
-template <>
-inline void hash_param<std::vector<ShaderResource>>(
-    size_t &                           seed,
-    const std::vector<ShaderResource> &value)
+inline void pack_param(ResourceKey &key, const PipelineState &pipeline_state)
 {
-	for (auto &resource : value)
+	// The state is packed in the hashed bytes first, then moved to the verified bytes
+	auto hashed_size = key.hashed.size();
+
+	pack_param(key, pipeline_state.get_pipeline_layout().get_handle());
+
+	// For graphics only
+	VkRenderPass render_pass{VK_NULL_HANDLE};
+
+	if (auto state_render_pass = pipeline_state.get_render_pass())
 	{
-		hash_combine(seed, resource);
+		render_pass = state_render_pass->get_handle();
 	}
+
+	pack_param(key, render_pass);
+
+	pack_param(key, pipeline_state.get_subpass_index());
+
+	pack_param(key, pipeline_state.get_specialization_constant_state());
+
+	// All the fixed function states only hold 32-bit fields, so they have no padding
+	pack_param(key, pipeline_state.get_vertex_input_state().bindings);
+	pack_param(key, pipeline_state.get_vertex_input_state().attributes);
+	pack_param(key, pipeline_state.get_input_assembly_state());
+	pack_param(key, pipeline_state.get_rasterization_state());
+	pack_param(key, pipeline_state.get_viewport_state());
+	pack_param(key, pipeline_state.get_multisample_state());
+	pack_param(key, pipeline_state.get_depth_stencil_state());
+	pack_param(key, pipeline_state.get_color_blend_state().logic_op_enable);
+	pack_param(key, pipeline_state.get_color_blend_state().logic_op);
+	pack_param(key, pipeline_state.get_color_blend_state().attachments);
+
+	key.verified.insert(key.verified.end(), key.hashed.begin() + hashed_size, key.hashed.end());
+	key.hashed.resize(hashed_size);
+
+	// Only the cached hash of the state is hashed, instead of the whole state
+	pack_param(key, pipeline_state.get_hash());
 }
 
-template <>
-inline void hash_param<std::unordered_map<uint32_t, std::map<uint32_t, VkDescriptorBufferInfo>>>(
-    size_t &                                                                        seed,
-    const std::unordered_map<uint32_t, std::map<uint32_t, VkDescriptorBufferInfo>> &value)
+template <class T>
+inline void pack_param(ResourceKey &key, const std::vector<T> &value)
 {
-	for (auto &binding_set : value)
-	{
-		hash_combine(seed, binding_set.first);
+	pack_param(key, value.size());
 
-		for (auto &binding_element : binding_set.second)
-		{
-			hash_combine(seed, binding_element.first);
-			hash_combine(seed, binding_element.second);
-		}
+	for (auto &element : value)
+	{
+		pack_param(key, element);
 	}
 }
 
-template <>
-inline void hash_param<std::unordered_map<uint32_t, std::map<uint32_t, VkDescriptorImageInfo>>>(
-    size_t &                                                                       seed,
-    const std::unordered_map<uint32_t, std::map<uint32_t, VkDescriptorImageInfo>> &value)
+template <class T>
+inline void pack_param(ResourceKey &key, const BindingMap<T> &value)
 {
+	pack_param(key, value.size());
+
 	for (auto &binding_set : value)
 	{
-		hash_combine(seed, binding_set.first);
+		pack_param(key, binding_set.first);
+		pack_param(key, binding_set.second.size());
 
 		for (auto &binding_element : binding_set.second)
 		{
-			hash_combine(seed, binding_element.first);
-			hash_combine(seed, binding_element.second);
+			pack_param(key, binding_element.first);
+			pack_param(key, binding_element.second);
 		}
 	}
 }
 
 template <typename T, typename... Args>
-inline void hash_param(size_t &seed, const T &first_arg, const Args &... args)
+inline void pack_param(ResourceKey &key, const T &first_arg, const Args &... args)
 {
-	hash_param(seed, first_arg);
+	pack_param(key, first_arg);
 
-	hash_param(seed, args...);
+	pack_param(key, args...);
 }
 
 template <class T, class... A>
@@ -211,69 +297,282 @@ struct RecordHelper<GraphicsPipeline, A...>
 	}
 };
 
-template <class T, class... A>
-T &request_resource(Device &device, ResourceRecord &recorder, std::unordered_map<std::size_t, T> &resources, A &... args)
+/**
+ * @brief Approximate host memory used by a cached resource
+ */
+template <class T>
+size_t get_memory_usage(const T &)
 {
-	RecordHelper<T, A...> record_helper;
+	return sizeof(T);
+}
 
-	std::size_t hash{0U};
-	hash_param(hash, args...);
+size_t get_memory_usage(const ShaderModule &shader_module)
+{
+	return sizeof(ShaderModule) + shader_module.get_binary().size() * sizeof(uint32_t) + shader_module.get_resources().size() * sizeof(ShaderResource);
+}
 
-	auto res_it = resources.find(hash);
+/**
+ * @brief Finds a resource in a shard, which must be locked by the caller
+ * @return A pointer to the resource, or nullptr if it is not cached
+ */
+template <class T>
+T *find_resource(typename ResourceMap<T>::Shard &shard, uint64_t hash, const ResourceKey &key, uint64_t frame_number)
+{
+	// The full key is compared, so that resources whose hash collide are never mixed up
+	auto range = shard.resources.equal_range(hash);
 
-	if (res_it != resources.end())
+	for (auto res_it = range.first; res_it != range.second; ++res_it)
 	{
-		return res_it->second;
+		if (res_it->second.key == key)
+		{
+			res_it->second.last_used = frame_number;
+
+			return &res_it->second.resource;
+		}
 	}
 
-	// If we do not have it already, create and cache it
-	const char *res_type = typeid(T).name();
-	size_t      res_id   = resources.size();
+	return nullptr;
+}
+
+/**
+ * @brief Tells whether an asynchronous build of a resource failed, the shard must be locked by the caller
+ */
+template <class T>
+bool is_failed(typename ResourceMap<T>::Shard &shard, uint64_t hash, const ResourceKey &key)
+{
+	auto range = shard.failed.equal_range(hash);
+
+	return std::any_of(range.first, range.second, [&key](const std::pair<const uint64_t, ResourceKey> &failed) { return failed.second == key; });
+}
+
+/**
+ * @brief Builds a resource whose hash was added to the pending set of its shard by the caller,
+ *        then makes it visible to other threads
+ * @param keep_failure Whether to add the key to the failed keys of the shard if the build fails
+ */
+template <class T, class... A>
+T &build_resource(Device &device, ResourceRecord &recorder, std::mutex &recorder_mutex, uint64_t frame_number, ResourceMap<T> &resources, uint64_t hash, ResourceKey &&key, bool keep_failure, A &... args)
+{
+	RecordHelper<T, A...> record_helper;
+
+	auto &shard = resources.get_shard(hash);
+
+	std::unique_lock<std::mutex> shard_lock{shard.mutex, std::defer_lock};
 
-	LOGI("Building #{} cache object ({})", res_id, res_type);
+	size_t index{0U};
 
-	size_t index = record_helper.record(recorder, args...);
+	typename ResourceMap<T>::Iterator res_it;
 
 	try
 	{
+		{
+			std::lock_guard<std::mutex> guard{recorder_mutex};
+
+			index = record_helper.record(recorder, args...);
+		}
+
+		Timer timer;
+		timer.start();
+
 		T resource(device, args...);
 
-		auto res_ins_it = resources.emplace(hash, std::move(resource));
+		auto creation_time = timer.stop<Timer::Nanoseconds>();
+
+		size_t memory = get_memory_usage(resource) + key.hashed.size() + key.verified.size();
+
+		shard_lock.lock();
+
+		res_it = shard.resources.emplace(hash, typename ResourceMap<T>::Entry{std::move(key), std::move(resource), frame_number, memory});
+
+		shard_lock.unlock();
+
+		resources.add_resident(static_cast<uint64_t>(creation_time), memory);
 
-		if (!res_ins_it.second)
 		{
-			throw std::runtime_error{std::string{"Insertion error for #"} + std::to_string(res_id) + "cache object (" + res_type + ")"};
+			std::lock_guard<std::mutex> guard{recorder_mutex};
+
+			record_helper.index(recorder, index, res_it->second.resource);
 		}
+	}
+	catch (const std::exception &e)
+	{
+		LOGE("Creation error for cache object {:#018x} ({}): {}", hash, typeid(T).name(), e.what());
 
-		res_it = res_ins_it.first;
+		if (!shard_lock.owns_lock())
+		{
+			shard_lock.lock();
+		}
+
+		shard.pending.erase(hash);
+
+		// Recorded before the shard is unlocked, so that no other request queues the build again
+		if (keep_failure)
+		{
+			shard.failed.emplace(hash, std::move(key));
+
+			resources.add_failure();
+		}
+
+		shard_lock.unlock();
+
+		shard.ready.notify_all();
 
-		record_helper.index(recorder, index, res_it->second);
+		throw;
 	}
-	catch (const std::exception &e)
+
+	// The resource is now indexed by the recorder, make it visible to waiting threads
+	shard_lock.lock();
+
+	shard.pending.erase(hash);
+
+	shard_lock.unlock();
+
+	shard.ready.notify_all();
+
+	return res_it->second.resource;
+}
+
+template <class T, class... A>
+T &request_resource(Device &device, ResourceRecord &recorder, std::mutex &recorder_mutex, uint64_t frame_number, ResourceMap<T> &resources, A &... args)
+{
+	// Reused across requests so that packing the key does not allocate once warmed up
+	thread_local ResourceKey key;
+
+	key.clear();
+	pack_param(key, args...);
+
+	uint64_t hash = hash_bytes(key.hashed.data(), key.hashed.size());
+
+	auto &shard = resources.get_shard(hash);
+
+	std::unique_lock<std::mutex> shard_lock{shard.mutex};
+
+	// Wait if another thread is already building a resource with this hash
+	shard.ready.wait(shard_lock, [&shard, hash]() { return shard.pending.find(hash) == shard.pending.end(); });
+
+	if (auto resource = find_resource<T>(shard, hash, key, frame_number))
 	{
-		LOGE("Creation error for #{} cache object ({})", res_id, res_type);
-		throw e;
+		resources.add_hit();
+
+		return *resource;
 	}
 
-	return res_it->second;
+	// If we do not have it already, create and cache it
+	// Other threads requesting it will wait until it is removed from the pending set
+	shard.pending.insert(hash);
+
+	shard_lock.unlock();
+
+	return build_resource(device, recorder, recorder_mutex, frame_number, resources, hash, ResourceKey{key}, false, args...);
+}
+
+/**
+ * @brief Non-blocking version of request_resource, which builds missing resources on a thread pool
+ * @return A pointer to the resource, or nullptr if it is not ready yet
+ */
+template <class T, class... A>
+T *request_resource_async(ctpl::thread_pool &thread_pool, std::function<void()> on_queued, std::function<void()> on_built, Device &device, ResourceRecord &recorder, std::mutex &recorder_mutex, uint64_t frame_number, ResourceMap<T> &resources, A &... args)
+{
+	thread_local ResourceKey key;
+
+	key.clear();
+	pack_param(key, args...);
+
+	uint64_t hash = hash_bytes(key.hashed.data(), key.hashed.size());
+
+	auto &shard = resources.get_shard(hash);
+
+	std::lock_guard<std::mutex> shard_guard{shard.mutex};
+
+	// Still being built, do not wait for it
+	if (shard.pending.find(hash) != shard.pending.end())
+	{
+		return nullptr;
+	}
+
+	if (auto resource = find_resource<T>(shard, hash, key, frame_number))
+	{
+		resources.add_hit();
+
+		return resource;
+	}
+
+	// Draws using a resource which failed to build are skipped, as while it is being built
+	if (is_failed<T>(shard, hash, key))
+	{
+		return nullptr;
+	}
+
+	shard.pending.insert(hash);
+
+	on_queued();
+
+	// The worker gets its own copy of the key and of the arguments
+	thread_pool.push([&device, &recorder, &recorder_mutex, frame_number, &resources, hash, on_built, resource_key = ResourceKey{key}, args...](size_t) mutable {
+		try
+		{
+			build_resource(device, recorder, recorder_mutex, frame_number, resources, hash, std::move(resource_key), true, args...);
+		}
+		catch (const std::exception &e)
+		{
+			LOGE("Asynchronous build of a {} failed, it will not be retried until the cache is cleared: {}", typeid(T).name(), e.what());
+		}
+
+		on_built();
+	});
+
+	return nullptr;
 }
 }        // namespace
 
 ResourceCache::ResourceCache(Device &device) :
-    device{device}
+    device{device},
+    owned_pipeline_cache{device}
+{
+}
+
+ResourceCache::~ResourceCache()
 {
+	wait_pending_pipelines();
 }
 
-void ResourceCache::warmup(const std::vector<uint8_t> &data)
+bool ResourceCache::warmup(const uint8_t *data, size_t size)
 {
-	recorder.set_data(data);
+	// Reject the whole record up front, so that invalid data is never partially replayed
+	if (!ResourceRecord::validate(data, size, device.get_properties().pipelineCacheUUID))
+	{
+		return false;
+	}
+
+	replayer.play(*this, data, size);
+
+	return true;
+}
 
-	replayer.play(*this, recorder);
+bool ResourceCache::warmup(const std::vector<uint8_t> &data)
+{
+	return warmup(data.data(), data.size());
 }
 
 std::vector<uint8_t> ResourceCache::serialize()
 {
-	return recorder.get_data();
+	std::lock_guard<std::mutex> guard{recorder_mutex};
+
+	return recorder.get_data(device.get_properties().pipelineCacheUUID);
+}
+
+size_t ResourceCache::get_serialized_index(VkPipelineLayout pipeline_layout)
+{
+	std::lock_guard<std::mutex> guard{recorder_mutex};
+
+	return recorder.get_pipeline_layout_index(pipeline_layout);
+}
+
+size_t ResourceCache::get_serialized_index(const GraphicsPipeline &graphics_pipeline)
+{
+	std::lock_guard<std::mutex> guard{recorder_mutex};
+
+	return recorder.get_graphics_pipeline_index(graphics_pipeline);
 }
 
 void ResourceCache::set_pipeline_cache(VkPipelineCache new_pipeline_cache)
@@ -281,45 +580,294 @@ void ResourceCache::set_pipeline_cache(VkPipelineCache new_pipeline_cache)
 	pipeline_cache = new_pipeline_cache;
 }
 
+void ResourceCache::set_pipeline_cache_enabled(bool enable)
+{
+	pipeline_cache_enabled = enable;
+}
+
+bool ResourceCache::is_pipeline_cache_enabled() const
+{
+	return pipeline_cache_enabled;
+}
+
+void ResourceCache::set_pipeline_cache_save_interval(float seconds)
+{
+	pipeline_cache_save_interval = seconds;
+}
+
+void ResourceCache::save_pipeline_cache()
+{
+	owned_pipeline_cache.save();
+}
+
+void ResourceCache::set_budget(const ResourceCacheBudget &new_budget)
+{
+	budget = new_budget;
+}
+
+const ResourceCacheBudget &ResourceCache::get_budget() const
+{
+	return budget;
+}
+
+void ResourceCache::pin(const Pipeline &pipeline)
+{
+	add_pin(&pipeline);
+}
+
+void ResourceCache::unpin(const Pipeline &pipeline)
+{
+	remove_pin(&pipeline);
+}
+
+void ResourceCache::pin(const DescriptorSet &descriptor_set)
+{
+	add_pin(&descriptor_set);
+}
+
+void ResourceCache::unpin(const DescriptorSet &descriptor_set)
+{
+	remove_pin(&descriptor_set);
+}
+
+void ResourceCache::add_pin(const void *resource)
+{
+	std::lock_guard<std::mutex> guard{pinned_resources_mutex};
+
+	++pinned_resources[resource];
+}
+
+void ResourceCache::remove_pin(const void *resource)
+{
+	std::lock_guard<std::mutex> guard{pinned_resources_mutex};
+
+	auto pin_it = pinned_resources.find(resource);
+
+	assert(pin_it != pinned_resources.end() && "Resource unpinned more times than it was pinned");
+
+	if (pin_it != pinned_resources.end() && --pin_it->second == 0)
+	{
+		pinned_resources.erase(pin_it);
+	}
+}
+
+bool ResourceCache::is_pinned(const void *resource) const
+{
+	return pinned_resources.find(resource) != pinned_resources.end();
+}
+
+void ResourceCache::begin_frame(uint64_t new_frame_number, uint64_t completed_frame_number)
+{
+	frame_number = new_frame_number;
+
+	if (pipeline_cache_save_interval > 0.0f)
+	{
+		pipeline_cache_save_timer.start();
+
+		if (pipeline_cache_save_timer.elapsed() >= pipeline_cache_save_interval)
+		{
+			pipeline_cache_save_timer.lap();
+
+			auto pipeline_count = graphics_pipelines.get_usage().misses + compute_pipelines.get_usage().misses;
+
+			bool is_saving = pipeline_cache_save.valid() && pipeline_cache_save.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+
+			// Save in the background, so that the frame does not wait for the driver to serialize the caches
+			if (pipeline_count != saved_pipeline_count && !is_saving)
+			{
+				saved_pipeline_count = pipeline_count;
+
+				pipeline_cache_save = std::async(std::launch::async, [this]() { owned_pipeline_cache.save(); });
+			}
+		}
+	}
+
+	shader_modules.begin_frame();
+	pipeline_layouts.begin_frame();
+	descriptor_set_layouts.begin_frame();
+	render_passes.begin_frame();
+	descriptor_sets.begin_frame();
+	graphics_pipelines.begin_frame();
+	compute_pipelines.begin_frame();
+	framebuffers.begin_frame();
+
+	auto get_eviction_count = [this]() {
+		return shader_modules.get_eviction_count() + descriptor_sets.get_eviction_count() +
+		       graphics_pipelines.get_eviction_count() + compute_pipelines.get_eviction_count();
+	};
+
+	auto eviction_count = get_eviction_count();
+
+	{
+		// Pinned resources are bound by their holders without being requested, so their last use is unknown
+		std::lock_guard<std::mutex> guard{pinned_resources_mutex};
+
+		descriptor_sets.evict(budget.descriptor_sets, completed_frame_number, [this](const DescriptorSet &descriptor_set) {
+			return !is_pinned(&descriptor_set);
+		});
+
+		graphics_pipelines.evict(budget.graphics_pipelines, completed_frame_number, [this](const GraphicsPipeline &pipeline) {
+			return !is_pinned(static_cast<const Pipeline *>(&pipeline));
+		});
+
+		compute_pipelines.evict(budget.compute_pipelines, completed_frame_number, [this](const ComputePipeline &pipeline) {
+			return !is_pinned(static_cast<const Pipeline *>(&pipeline));
+		});
+	}
+
+	if (budget.shader_modules > 0 && shader_modules.get_resident_count() > budget.shader_modules)
+	{
+		// Pipeline layouts are never evicted, so the shader modules they point to have to stay
+		std::unordered_set<const ShaderModule *> used_shader_modules;
+
+		pipeline_layouts.for_each([&used_shader_modules](const PipelineLayout &pipeline_layout) {
+			used_shader_modules.insert(pipeline_layout.get_stages().begin(), pipeline_layout.get_stages().end());
+		});
+
+		shader_modules.evict(budget.shader_modules, completed_frame_number, [&used_shader_modules](const ShaderModule &shader_module) {
+			return used_shader_modules.find(&shader_module) == used_shader_modules.end();
+		});
+	}
+
+	if (get_eviction_count() != eviction_count)
+	{
+		++generation;
+	}
+}
+
+uint64_t ResourceCache::get_generation() const
+{
+	return generation;
+}
+
+void ResourceCache::set_async_pipeline_compilation(bool enable)
+{
+	if (enable && !thread_pool)
+	{
+		auto thread_count = std::thread::hardware_concurrency();
+		thread_count      = thread_count > 1 ? thread_count - 1 : 1;
+
+		thread_pool = std::make_unique<ctpl::thread_pool>(thread_count);
+	}
+
+	async_pipeline_compilation = enable;
+}
+
+bool ResourceCache::is_async_pipeline_compilation() const
+{
+	return async_pipeline_compilation;
+}
+
+void ResourceCache::wait_pending_pipelines()
+{
+	std::unique_lock<std::mutex> lock{pending_pipelines_mutex};
+
+	pending_pipelines_done.wait(lock, [this]() { return pending_pipeline_count == 0; });
+}
+
+ResourceCacheCounters ResourceCache::get_counters() const
+{
+	ResourceCacheCounters counters;
+
+	counters.shader_modules         = shader_modules.get_usage();
+	counters.pipeline_layouts       = pipeline_layouts.get_usage();
+	counters.descriptor_set_layouts = descriptor_set_layouts.get_usage();
+	counters.render_passes          = render_passes.get_usage();
+	counters.descriptor_sets        = descriptor_sets.get_usage();
+	counters.graphics_pipelines     = graphics_pipelines.get_usage();
+	counters.compute_pipelines      = compute_pipelines.get_usage();
+	counters.framebuffers           = framebuffers.get_usage();
+
+	return counters;
+}
+
 ShaderModule &ResourceCache::request_shader_module(VkShaderStageFlagBits stage, const ShaderSource &glsl_source, const ShaderVariant &shader_variant)
 {
 	std::string entry_point{"main"};
-	return request_resource(device, recorder, shader_modules, stage, glsl_source, entry_point, shader_variant);
+	return request_resource(device, recorder, recorder_mutex, frame_number, shader_modules, stage, glsl_source, entry_point, shader_variant);
 }
 
 PipelineLayout &ResourceCache::request_pipeline_layout(const std::vector<ShaderModule *> &requested_shader_modules)
 {
-	return request_resource(device, recorder, pipeline_layouts, requested_shader_modules);
+	return request_resource(device, recorder, recorder_mutex, frame_number, pipeline_layouts, requested_shader_modules);
 }
 
 DescriptorSetLayout &ResourceCache::request_descriptor_set_layout(const std::vector<ShaderResource> &set_resources)
 {
-	return request_resource(device, recorder, descriptor_set_layouts, set_resources);
+	return request_resource(device, recorder, recorder_mutex, frame_number, descriptor_set_layouts, set_resources);
 }
 
 GraphicsPipeline &ResourceCache::request_graphics_pipeline(PipelineState &pipeline_state)
 {
-	return request_resource(device, recorder, graphics_pipelines, pipeline_cache, pipeline_state);
+	if (pipeline_cache == VK_NULL_HANDLE && pipeline_cache_enabled)
+	{
+		ThreadPipelineCache thread_pipeline_cache{&owned_pipeline_cache};
+
+		return request_resource(device, recorder, recorder_mutex, frame_number, graphics_pipelines, thread_pipeline_cache, pipeline_state);
+	}
+
+	return request_resource(device, recorder, recorder_mutex, frame_number, graphics_pipelines, pipeline_cache, pipeline_state);
+}
+
+GraphicsPipeline *ResourceCache::request_graphics_pipeline_async(PipelineState &pipeline_state)
+{
+	if (!async_pipeline_compilation)
+	{
+		return &request_graphics_pipeline(pipeline_state);
+	}
+
+	auto on_queued = [this]() {
+		std::lock_guard<std::mutex> lock{pending_pipelines_mutex};
+
+		++pending_pipeline_count;
+	};
+
+	auto on_built = [this]() {
+		{
+			std::lock_guard<std::mutex> lock{pending_pipelines_mutex};
+
+			--pending_pipeline_count;
+		}
+
+		pending_pipelines_done.notify_all();
+	};
+
+	if (pipeline_cache == VK_NULL_HANDLE && pipeline_cache_enabled)
+	{
+		// Each worker builds with its own pipeline cache
+		ThreadPipelineCache thread_pipeline_cache{&owned_pipeline_cache};
+
+		return request_resource_async(*thread_pool, on_queued, on_built, device, recorder, recorder_mutex, frame_number, graphics_pipelines, thread_pipeline_cache, pipeline_state);
+	}
+
+	return request_resource_async(*thread_pool, on_queued, on_built, device, recorder, recorder_mutex, frame_number, graphics_pipelines, pipeline_cache, pipeline_state);
 }
 
 ComputePipeline &ResourceCache::request_compute_pipeline(PipelineState &pipeline_state)
 {
-	return request_resource(device, recorder, compute_pipelines, pipeline_cache, pipeline_state);
+	if (pipeline_cache == VK_NULL_HANDLE && pipeline_cache_enabled)
+	{
+		ThreadPipelineCache thread_pipeline_cache{&owned_pipeline_cache};
+
+		return request_resource(device, recorder, recorder_mutex, frame_number, compute_pipelines, thread_pipeline_cache, pipeline_state);
+	}
+
+	return request_resource(device, recorder, recorder_mutex, frame_number, compute_pipelines, pipeline_cache, pipeline_state);
 }
 
 DescriptorSet &ResourceCache::request_descriptor_set(DescriptorSetLayout &descriptor_set_layout, const BindingMap<VkDescriptorBufferInfo> &buffer_infos, const BindingMap<VkDescriptorImageInfo> &image_infos)
 {
-	return request_resource(device, recorder, descriptor_sets, descriptor_set_layout, buffer_infos, image_infos);
+	return request_resource(device, recorder, recorder_mutex, frame_number, descriptor_sets, descriptor_set_layout, buffer_infos, image_infos);
 }
 
 RenderPass &ResourceCache::request_render_pass(const std::vector<Attachment> &attachments, const std::vector<LoadStoreInfo> &load_store_infos, const std::vector<SubpassInfo> &subpasses)
 {
-	return request_resource(device, recorder, render_passes, attachments, load_store_infos, subpasses);
+	return request_resource(device, recorder, recorder_mutex, frame_number, render_passes, attachments, load_store_infos, subpasses);
 }
 
 Framebuffer &ResourceCache::request_framebuffer(const RenderTarget &render_target, const RenderPass &render_pass)
 {
-	return request_resource(device, recorder, framebuffers, render_target, render_pass);
+	return request_resource(device, recorder, recorder_mutex, frame_number, framebuffers, render_target, render_pass);
 }
 
 void ResourceCache::clear_pipelines()
@@ -327,15 +875,51 @@ void ResourceCache::clear_pipelines()
 	graphics_pipelines.clear();
 
 	compute_pipelines.clear();
+
+	++generation;
 }
 
 void ResourceCache::clear_framebuffers()
 {
 	framebuffers.clear();
+
+	++generation;
+}
+
+void ResourceCache::clear_descriptor_sets(const std::vector<VkBuffer> &buffers)
+{
+	auto erased = descriptor_sets.erase_if([&buffers](const DescriptorSet &descriptor_set) {
+		for (auto &binding_it : descriptor_set.get_buffer_infos())
+		{
+			for (auto &buffer_it : binding_it.second)
+			{
+				if (std::find(buffers.begin(), buffers.end(), buffer_it.second.buffer) != buffers.end())
+				{
+					return true;
+				}
+			}
+		}
+
+		return false;
+	});
+
+	if (erased > 0)
+	{
+		++generation;
+	}
 }
 
 void ResourceCache::clear()
 {
+	wait_pending_pipelines();
+
+	if (pipeline_cache_save.valid())
+	{
+		pipeline_cache_save.wait();
+	}
+
+	save_pipeline_cache();
+
 	shader_modules.clear();
 	pipeline_layouts.clear();
 	descriptor_sets.clear();
@@ -343,5 +927,9 @@ void ResourceCache::clear()
 	render_passes.clear();
 	clear_pipelines();
 	clear_framebuffers();
+
+	owned_pipeline_cache.clear();
+
+	++generation;
 }
 }        // namespace vkb
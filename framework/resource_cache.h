@@ -20,18 +20,413 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+
 #include "common/helpers.h"
 #include "common/vk_common.h"
 #include "core/descriptor_set.h"
 #include "core/descriptor_set_layout.h"
 #include "core/framebuffer.h"
+#include "core/pipeline_cache.h"
 #include "resource_record.h"
 #include "resource_replay.h"
+#include "timer.h"
+
+namespace ctpl
+{
+class thread_pool;
+}
 
 namespace vkb
 {
 class Device;
 
+/**
+ * @brief Parameters of a resource request packed into bytes.
+ * The hashed bytes are used to find a resource, and the verified bytes are only compared to confirm it.
+ * States which keep their own up to date hash, like PipelineState, put that hash in the hashed bytes
+ * and their full content in the verified bytes, so they do not need rehashing on every lookup.
+ */
+struct ResourceKey
+{
+	std::vector<uint8_t> hashed;
+
+	std::vector<uint8_t> verified;
+
+	void clear()
+	{
+		hashed.clear();
+		verified.clear();
+	}
+
+	bool operator==(const ResourceKey &other) const
+	{
+		return hashed == other.hashed && verified == other.verified;
+	}
+};
+
+/**
+ * @brief Statistics of a cached type
+ */
+struct ResourceCacheUsage
+{
+	/// Number of histogram buckets, bucket i counts creations shorter than 10^(i+1) microseconds
+	/// and the last one counts all the longer creations
+	static const size_t CREATION_TIME_BUCKET_COUNT = 6;
+
+	/// Number of objects currently cached
+	size_t resident{0};
+
+	/// Number of objects destroyed to fit in the budget of the cache
+	size_t evicted{0};
+
+	/// Requests which found the object in the cache
+	size_t hits{0};
+
+	/// Requests which had to build the object
+	size_t misses{0};
+
+	/// Asynchronous builds which failed, which are not retried until the objects are cleared
+	size_t failures{0};
+
+	/// Misses during the last completed frame
+	size_t frame_misses{0};
+
+	/// Approximate host memory used by the cached objects and their keys, in bytes
+	size_t memory{0};
+
+	/// Total time spent building objects, in milliseconds
+	double creation_time{0.0};
+
+	std::array<size_t, CREATION_TIME_BUCKET_COUNT> creation_time_histogram{};
+};
+
+/**
+ * @brief Hash map of cached resources split into shards, each guarded by its own mutex.
+ * A request only locks the shard its hash falls into, so threads looking up different
+ * resources rarely contend with each other.
+ * Every entry stores the packed key it was built from, which is compared on lookup,
+ * so two requests whose 64-bit hashes collide still get their own resource.
+ * A hash which is being built is kept in the pending set of its shard, so that other
+ * threads requesting the same resource wait for it instead of building it twice.
+ * The keys of the asynchronous builds which failed are kept too, so that they are not retried
+ * on every request.
+ */
+template <class T>
+class ResourceMap : public NonCopyable
+{
+  public:
+	static const size_t SHARD_COUNT = 16;
+
+	struct Entry
+	{
+		ResourceKey key;
+
+		T resource;
+
+		/// Number of the last frame which requested the resource
+		uint64_t last_used{0};
+
+		/// Approximate memory used by the entry, in bytes
+		size_t memory{0};
+	};
+
+	using Iterator = typename std::unordered_multimap<uint64_t, Entry>::iterator;
+
+	struct Shard
+	{
+		std::mutex mutex;
+
+		std::condition_variable ready;
+
+		std::unordered_multimap<uint64_t, Entry> resources;
+
+		std::unordered_set<uint64_t> pending;
+
+		std::unordered_multimap<uint64_t, ResourceKey> failed;
+	};
+
+	Shard &get_shard(uint64_t hash)
+	{
+		return shards[hash % SHARD_COUNT];
+	}
+
+	/**
+	 * @brief Called when a request finds its resource in the cache
+	 */
+	void add_hit()
+	{
+		++hits;
+	}
+
+	/**
+	 * @brief Called when a new resource is added to a shard
+	 * @param creation_time Time spent building the resource, in nanoseconds
+	 * @param memory Approximate memory used by the entry, in bytes
+	 */
+	void add_resident(uint64_t creation_time, size_t memory)
+	{
+		++resident;
+		++misses;
+		++frame_misses;
+
+		total_memory += memory;
+		total_creation_time += creation_time;
+
+		size_t   bucket = 0;
+		uint64_t limit  = 10000;
+
+		while (bucket < ResourceCacheUsage::CREATION_TIME_BUCKET_COUNT - 1 && creation_time >= limit)
+		{
+			++bucket;
+			limit *= 10;
+		}
+
+		++creation_time_histogram[bucket];
+	}
+
+	/**
+	 * @brief Called when an asynchronous build fails and its key is added to the failed keys of its shard
+	 */
+	void add_failure()
+	{
+		++failures;
+	}
+
+	size_t get_resident_count() const
+	{
+		return resident;
+	}
+
+	size_t get_eviction_count() const
+	{
+		return evicted;
+	}
+
+	/**
+	 * @brief Starts counting the misses of a new frame
+	 */
+	void begin_frame()
+	{
+		last_frame_misses = frame_misses.exchange(0);
+	}
+
+	ResourceCacheUsage get_usage() const
+	{
+		ResourceCacheUsage usage;
+
+		usage.resident      = resident;
+		usage.evicted       = evicted;
+		usage.hits          = hits;
+		usage.misses        = misses;
+		usage.failures      = failures;
+		usage.frame_misses  = last_frame_misses;
+		usage.memory        = total_memory;
+		usage.creation_time = total_creation_time / 1000000.0;
+
+		for (size_t i = 0; i < ResourceCacheUsage::CREATION_TIME_BUCKET_COUNT; ++i)
+		{
+			usage.creation_time_histogram[i] = creation_time_histogram[i];
+		}
+
+		return usage;
+	}
+
+	/**
+	 * @brief Calls a function on every resource, locking one shard at a time
+	 */
+	template <class F>
+	void for_each(F func)
+	{
+		for (auto &shard : shards)
+		{
+			std::lock_guard<std::mutex> guard{shard.mutex};
+
+			for (auto &resource_it : shard.resources)
+			{
+				func(resource_it.second.resource);
+			}
+		}
+	}
+
+	/**
+	 * @brief Destroys the least recently used resources until the map fits in its budget
+	 * @param budget Maximum number of resident resources, 0 means no limit
+	 * @param completed_frame Resources last used after this frame may still be in use by the GPU and are kept
+	 * @param can_evict Predicate telling whether a resource is not referenced by other cached resources
+	 */
+	template <class P>
+	void evict(size_t budget, uint64_t completed_frame, P can_evict)
+	{
+		if (budget == 0 || resident <= budget)
+		{
+			return;
+		}
+
+		std::array<std::unique_lock<std::mutex>, SHARD_COUNT> locks;
+
+		for (size_t i = 0; i < SHARD_COUNT; ++i)
+		{
+			locks[i] = std::unique_lock<std::mutex>{shards[i].mutex};
+		}
+
+		struct Candidate
+		{
+			uint64_t last_used;
+
+			Shard *shard;
+
+			Iterator it;
+		};
+
+		std::vector<Candidate> candidates;
+
+		for (auto &shard : shards)
+		{
+			for (auto it = shard.resources.begin(); it != shard.resources.end(); ++it)
+			{
+				if (it->second.last_used <= completed_frame && can_evict(it->second.resource))
+				{
+					candidates.push_back({it->second.last_used, &shard, it});
+				}
+			}
+		}
+
+		std::sort(candidates.begin(), candidates.end(), [](const Candidate &lhs, const Candidate &rhs) { return lhs.last_used < rhs.last_used; });
+
+		for (auto &candidate : candidates)
+		{
+			if (resident <= budget)
+			{
+				break;
+			}
+
+			total_memory -= candidate.it->second.memory;
+
+			candidate.shard->resources.erase(candidate.it);
+
+			--resident;
+			++evicted;
+		}
+	}
+
+	/**
+	 * @brief Destroys the resources matching a predicate, which must not be in use by the GPU anymore
+	 * @return Number of resources destroyed
+	 */
+	template <class P>
+	size_t erase_if(P predicate)
+	{
+		size_t erased{0};
+
+		for (auto &shard : shards)
+		{
+			std::lock_guard<std::mutex> guard{shard.mutex};
+
+			for (auto it = shard.resources.begin(); it != shard.resources.end();)
+			{
+				if (predicate(it->second.resource))
+				{
+					total_memory -= it->second.memory;
+
+					it = shard.resources.erase(it);
+
+					--resident;
+					++erased;
+				}
+				else
+				{
+					++it;
+				}
+			}
+		}
+
+		return erased;
+	}
+
+	/**
+	 * @brief Destroys all the resources, must not be called while other threads are requesting resources
+	 */
+	void clear()
+	{
+		for (auto &shard : shards)
+		{
+			std::lock_guard<std::mutex> guard{shard.mutex};
+
+			shard.resources.clear();
+
+			// The failed builds may succeed with a fresh start, e.g. once shaders are fixed
+			shard.failed.clear();
+		}
+
+		resident     = 0;
+		total_memory = 0;
+	}
+
+  private:
+	std::array<Shard, SHARD_COUNT> shards;
+
+	std::atomic<size_t> resident{0};
+
+	std::atomic<size_t> evicted{0};
+
+	std::atomic<size_t> hits{0};
+
+	std::atomic<size_t> misses{0};
+
+	std::atomic<size_t> failures{0};
+
+	std::atomic<size_t> frame_misses{0};
+
+	std::atomic<size_t> last_frame_misses{0};
+
+	std::atomic<size_t> total_memory{0};
+
+	/// Total creation time in nanoseconds
+	std::atomic<uint64_t> total_creation_time{0};
+
+	std::array<std::atomic<size_t>, ResourceCacheUsage::CREATION_TIME_BUCKET_COUNT> creation_time_histogram{};
+};
+
+/**
+ * @brief Maximum number of resident objects for each type the cache can evict, 0 means no limit
+ */
+struct ResourceCacheBudget
+{
+	size_t shader_modules{0};
+
+	size_t descriptor_sets{0};
+
+	size_t graphics_pipelines{0};
+
+	size_t compute_pipelines{0};
+};
+
+/**
+ * @brief Statistics of every cached type
+ */
+struct ResourceCacheCounters
+{
+	ResourceCacheUsage shader_modules;
+
+	ResourceCacheUsage pipeline_layouts;
+
+	ResourceCacheUsage descriptor_set_layouts;
+
+	ResourceCacheUsage render_passes;
+
+	ResourceCacheUsage descriptor_sets;
+
+	ResourceCacheUsage graphics_pipelines;
+
+	ResourceCacheUsage compute_pipelines;
+
+	ResourceCacheUsage framebuffers;
+};
+
 /**
  * @brief Cache all sorts of Vulkan objects specific to a Vulkan device.
  * Supports serialization and deserialization of cached resources.
@@ -42,19 +437,128 @@ class Device;
  * The resource cache is also linked with ResourceRecord and ResourceReplay. Replay can warm-up
  * the cache on app startup by creating all necessary objects.
  * The cache holds pointers to objects and has a mapping from such pointers to hashes.
- * It can only be destroyed in bulk, single elements cannot be removed.
+ *
+ * By default objects are only destroyed in bulk. When a budget is set, the least recently used
+ * shader modules, descriptor sets and pipelines are evicted at the beginning of a frame, as long as
+ * no frame still in flight used them. Evictable objects kept across frames by the caller, instead of
+ * being requested again every frame they are used, have to be pinned for as long as they are kept.
+ * Every clear or eviction bumps the generation of the cache, which holders of objects kept across
+ * frames can compare to tell that the objects they depend on may have been destroyed.
+ *
+ * Resources can be requested concurrently from multiple threads. Each resource is built only
+ * once, threads requesting a resource which is being built wait until it is ready.
+ * Clearing the cache is not thread-safe and must happen when no other thread is using it.
+ *
+ * Unless the application sets its own, pipelines are created with pipeline caches owned by the
+ * resource cache, one per thread, which are saved to disk periodically and when the cache is cleared.
  */
 class ResourceCache : public NonCopyable
 {
   public:
 	ResourceCache(Device &device);
 
-	void warmup(const std::vector<uint8_t> &data);
+	~ResourceCache();
+
+	/**
+	 * @brief Creates all the resources serialized by a previous run
+	 * @param data Serialized resources, e.g. the contents of a mapped file, which is not copied
+	 * @param size Size of the data in bytes
+	 * @return False if the data is invalid or was recorded on another device or driver, in which case nothing is created
+	 */
+	bool warmup(const uint8_t *data, size_t size);
 
+	bool warmup(const std::vector<uint8_t> &data);
+
+	/**
+	 * @brief Serializes the resources requested so far, tagged with the pipelineCacheUUID of the device
+	 */
 	std::vector<uint8_t> serialize();
 
+	/**
+	 * @brief Gets the index of a pipeline layout among the serialized pipeline layouts
+	 * @throws std::out_of_range if the pipeline layout was not requested from the cache
+	 */
+	size_t get_serialized_index(VkPipelineLayout pipeline_layout);
+
+	/**
+	 * @brief Gets the index of a graphics pipeline among the serialized graphics pipelines
+	 * @throws std::out_of_range if the pipeline was not requested from the cache
+	 */
+	size_t get_serialized_index(const GraphicsPipeline &graphics_pipeline);
+
+	/**
+	 * @brief Overrides the pipeline caches owned by the resource cache with an application one
+	 * @param pipeline_cache The cache to create pipelines with, VK_NULL_HANDLE to use the owned caches again
+	 */
 	void set_pipeline_cache(VkPipelineCache pipeline_cache);
 
+	/**
+	 * @brief Enables creating pipelines with the owned pipeline caches, which are loaded from
+	 *        and saved to the temporary storage directory. Enabled by default.
+	 */
+	void set_pipeline_cache_enabled(bool enable);
+
+	bool is_pipeline_cache_enabled() const;
+
+	/**
+	 * @brief Sets how often the owned pipeline caches are saved in the background, if new pipelines were built
+	 * @param seconds Interval between two saves, 0 only saves them when the resource cache is cleared
+	 */
+	void set_pipeline_cache_save_interval(float seconds);
+
+	/**
+	 * @brief Merges the owned pipeline caches of all threads and writes them to disk
+	 */
+	void save_pipeline_cache();
+
+	void set_budget(const ResourceCacheBudget &budget);
+
+	const ResourceCacheBudget &get_budget() const;
+
+	/**
+	 * @brief Keeps a pipeline from being evicted until it is unpinned as many times as it was pinned
+	 */
+	void pin(const Pipeline &pipeline);
+
+	void unpin(const Pipeline &pipeline);
+
+	/**
+	 * @brief Keeps a descriptor set from being evicted until it is unpinned as many times as it was pinned
+	 */
+	void pin(const DescriptorSet &descriptor_set);
+
+	void unpin(const DescriptorSet &descriptor_set);
+
+	/**
+	 * @brief Starts a new frame, and evicts the resources over budget
+	 * @param frame_number Number of the frame starting, used to track when resources were last used
+	 * @param completed_frame_number All the frames up to this number have finished executing on the GPU
+	 */
+	void begin_frame(uint64_t frame_number, uint64_t completed_frame_number);
+
+	/**
+	 * @brief Returns a counter bumped whenever cached objects are cleared or evicted
+	 */
+	uint64_t get_generation() const;
+
+	/**
+	 * @brief Returns hits, misses, creation times, live counts and memory of every cached type
+	 */
+	ResourceCacheCounters get_counters() const;
+
+	/**
+	 * @brief Enables building graphics pipelines on a pool of worker threads,
+	 *        so that recording never stalls on a pipeline compilation
+	 */
+	void set_async_pipeline_compilation(bool enable);
+
+	bool is_async_pipeline_compilation() const;
+
+	/**
+	 * @brief Waits until all the pipelines queued for compilation are built, e.g. during a loading screen
+	 */
+	void wait_pending_pipelines();
+
 	ShaderModule &request_shader_module(VkShaderStageFlagBits stage, const ShaderSource &glsl_source, const ShaderVariant &shader_variant = {});
 
 	PipelineLayout &request_pipeline_layout(const std::vector<ShaderModule *> &shader_modules);
@@ -63,6 +567,14 @@ class ResourceCache : public NonCopyable
 
 	GraphicsPipeline &request_graphics_pipeline(PipelineState &pipeline_state);
 
+	/**
+	 * @brief Non-blocking version of request_graphics_pipeline when async compilation is enabled.
+	 *        A missing pipeline is queued for compilation and will be returned by a later request.
+	 *        A pipeline whose compilation failed is not queued again until the pipelines are cleared.
+	 * @return The pipeline, or nullptr if it is not built yet or failed to build
+	 */
+	GraphicsPipeline *request_graphics_pipeline_async(PipelineState &pipeline_state);
+
 	ComputePipeline &request_compute_pipeline(PipelineState &pipeline_state);
 
 	DescriptorSet &request_descriptor_set(DescriptorSetLayout &                     descriptor_set_layout,
@@ -80,6 +592,12 @@ class ResourceCache : public NonCopyable
 
 	void clear_framebuffers();
 
+	/**
+	 * @brief Destroys the descriptor sets writing any of the buffers, before the buffers themselves are destroyed.
+	 *        The descriptor sets must not be in use by the GPU anymore.
+	 */
+	void clear_descriptor_sets(const std::vector<VkBuffer> &buffers);
+
 	void clear();
 
   private:
@@ -87,25 +605,75 @@ class ResourceCache : public NonCopyable
 
 	ResourceRecord recorder;
 
+	/// Guards the recorder, as resources can be built from multiple threads
+	std::mutex recorder_mutex;
+
 	ResourceReplay replayer;
 
 	VkPipelineCache pipeline_cache{VK_NULL_HANDLE};
 
-	std::unordered_map<std::size_t, ShaderModule> shader_modules;
+	/// Pipeline caches used when the application does not set its own
+	PipelineCache owned_pipeline_cache;
+
+	bool pipeline_cache_enabled{true};
+
+	float pipeline_cache_save_interval{30.0f};
+
+	Timer pipeline_cache_save_timer;
+
+	/// Number of pipelines built when the owned pipeline caches were last saved
+	size_t saved_pipeline_count{0};
+
+	/// Background save of the owned pipeline caches
+	std::future<void> pipeline_cache_save;
+
+	void add_pin(const void *resource);
+
+	void remove_pin(const void *resource);
+
+	/**
+	 * @brief Must be called with pinned_resources_mutex locked
+	 */
+	bool is_pinned(const void *resource) const;
+
+	ResourceCacheBudget budget;
+
+	/// Number of pins of each resource kept across frames, which are never evicted
+	std::unordered_map<const void *, size_t> pinned_resources;
+
+	std::mutex pinned_resources_mutex;
+
+	std::atomic<uint64_t> frame_number{0};
 
-	std::unordered_map<std::size_t, PipelineLayout> pipeline_layouts;
+	std::atomic<uint64_t> generation{0};
 
-	std::unordered_map<std::size_t, DescriptorSetLayout> descriptor_set_layouts;
+	ResourceMap<ShaderModule> shader_modules;
 
-	std::unordered_map<std::size_t, RenderPass> render_passes;
+	ResourceMap<PipelineLayout> pipeline_layouts;
 
-	std::unordered_map<std::size_t, GraphicsPipeline> graphics_pipelines;
+	ResourceMap<DescriptorSetLayout> descriptor_set_layouts;
 
-	std::unordered_map<std::size_t, ComputePipeline> compute_pipelines;
+	ResourceMap<RenderPass> render_passes;
 
-	std::unordered_map<std::size_t, DescriptorSet> descriptor_sets;
+	ResourceMap<GraphicsPipeline> graphics_pipelines;
 
-	std::unordered_map<std::size_t, Framebuffer> framebuffers;
+	ResourceMap<ComputePipeline> compute_pipelines;
+
+	ResourceMap<DescriptorSet> descriptor_sets;
+
+	ResourceMap<Framebuffer> framebuffers;
+
+	bool async_pipeline_compilation{false};
+
+	/// Number of pipelines queued and not built yet
+	size_t pending_pipeline_count{0};
+
+	std::mutex pending_pipelines_mutex;
+
+	std::condition_variable pending_pipelines_done;
+
+	/// Workers building pipelines asynchronously, declared last so they stop before the cached resources are destroyed
+	std::unique_ptr<ctpl::thread_pool> thread_pool;
 };
 }        // namespace vkb
 
@@ -459,79 +1027,7 @@ struct hash<vkb::PipelineState>
 {
 	std::size_t operator()(const vkb::PipelineState &pipeline_state) const
 	{
-		std::size_t result = 0;
-
-		vkb::hash_combine(result, pipeline_state.get_pipeline_layout().get_handle());
-
-		// For graphics only
-		if (auto render_pass = pipeline_state.get_render_pass())
-		{
-			vkb::hash_combine(result, render_pass->get_handle());
-		}
-
-		vkb::hash_combine(result, pipeline_state.get_specialization_constant_state());
-
-		vkb::hash_combine(result, pipeline_state.get_subpass_index());
-
-		for (auto stage : pipeline_state.get_pipeline_layout().get_stages())
-		{
-			vkb::hash_combine(result, stage->get_id());
-		}
-
-		// VkPipelineVertexInputStateCreateInfo
-		for (auto &attribute : pipeline_state.get_vertex_input_state().attributes)
-		{
-			vkb::hash_combine(result, attribute);
-		}
-
-		for (auto &binding : pipeline_state.get_vertex_input_state().bindings)
-		{
-			vkb::hash_combine(result, binding);
-		}
-
-		// VkPipelineInputAssemblyStateCreateInfo
-		vkb::hash_combine(result, pipeline_state.get_input_assembly_state().primitive_restart_enable);
-		vkb::hash_combine(result, static_cast<std::underlying_type<VkPrimitiveTopology>::type>(pipeline_state.get_input_assembly_state().topology));
-
-		//VkPipelineViewportStateCreateInfo
-		vkb::hash_combine(result, pipeline_state.get_viewport_state().viewport_count);
-		vkb::hash_combine(result, pipeline_state.get_viewport_state().scissor_count);
-
-		// VkPipelineRasterizationStateCreateInfo
-		vkb::hash_combine(result, pipeline_state.get_rasterization_state().cull_mode);
-		vkb::hash_combine(result, pipeline_state.get_rasterization_state().depth_bias_enable);
-		vkb::hash_combine(result, pipeline_state.get_rasterization_state().depth_clamp_enable);
-		vkb::hash_combine(result, static_cast<std::underlying_type<VkFrontFace>::type>(pipeline_state.get_rasterization_state().front_face));
-		vkb::hash_combine(result, static_cast<std::underlying_type<VkPolygonMode>::type>(pipeline_state.get_rasterization_state().polygon_mode));
-		vkb::hash_combine(result, pipeline_state.get_rasterization_state().rasterizer_discard_enable);
-
-		// VkPipelineMultisampleStateCreateInfo
-		vkb::hash_combine(result, pipeline_state.get_multisample_state().alpha_to_coverage_enable);
-		vkb::hash_combine(result, pipeline_state.get_multisample_state().alpha_to_one_enable);
-		vkb::hash_combine(result, pipeline_state.get_multisample_state().min_sample_shading);
-		vkb::hash_combine(result, static_cast<std::underlying_type<VkSampleCountFlagBits>::type>(pipeline_state.get_multisample_state().rasterization_samples));
-		vkb::hash_combine(result, pipeline_state.get_multisample_state().sample_shading_enable);
-		vkb::hash_combine(result, pipeline_state.get_multisample_state().sample_mask);
-
-		// VkPipelineDepthStencilStateCreateInfo
-		vkb::hash_combine(result, pipeline_state.get_depth_stencil_state().back);
-		vkb::hash_combine(result, pipeline_state.get_depth_stencil_state().depth_bounds_test_enable);
-		vkb::hash_combine(result, static_cast<std::underlying_type<VkCompareOp>::type>(pipeline_state.get_depth_stencil_state().depth_compare_op));
-		vkb::hash_combine(result, pipeline_state.get_depth_stencil_state().depth_test_enable);
-		vkb::hash_combine(result, pipeline_state.get_depth_stencil_state().depth_write_enable);
-		vkb::hash_combine(result, pipeline_state.get_depth_stencil_state().front);
-		vkb::hash_combine(result, pipeline_state.get_depth_stencil_state().stencil_test_enable);
-
-		// VkPipelineColorBlendStateCreateInfo
-		vkb::hash_combine(result, static_cast<std::underlying_type<VkLogicOp>::type>(pipeline_state.get_color_blend_state().logic_op));
-		vkb::hash_combine(result, pipeline_state.get_color_blend_state().logic_op_enable);
-
-		for (auto &attachment : pipeline_state.get_color_blend_state().attachments)
-		{
-			vkb::hash_combine(result, attachment);
-		}
-
-		return result;
+		return static_cast<std::size_t>(pipeline_state.get_hash());
 	}
 };
 }        // namespace std
@@ -20,13 +20,14 @@
 
 #include "resource_record.h"
 
+#include "common/logging.h"
 #include "resource_cache.h"
 
 namespace vkb
 {
 namespace
 {
-inline void write_subpass_info(std::ostringstream &os, const std::vector<SubpassInfo> &value)
+inline void write_subpass_info(std::ostream &os, const std::vector<SubpassInfo> &value)
 {
 	write(os, value.size());
 	for (const SubpassInfo &item : value)
@@ -36,7 +37,7 @@ inline void write_subpass_info(std::ostringstream &os, const std::vector<Subpass
 	}
 }
 
-inline void write_processes(std::ostringstream &os, const std::vector<std::string> &value)
+inline void write_processes(std::ostream &os, const std::vector<std::string> &value)
 {
 	write(os, value.size());
 	for (const std::string &item : value)
@@ -46,31 +47,108 @@ inline void write_processes(std::ostringstream &os, const std::vector<std::strin
 }
 }        // namespace
 
-void ResourceRecord::set_data(const std::vector<uint8_t> &data)
+std::vector<uint8_t> ResourceRecord::get_data(const uint8_t *pipeline_cache_uuid) const
 {
-	stream.str(std::string{data.begin(), data.end()});
+	size_t toc_size = entries.size() * sizeof(ResourceRecordEntry);
+
+	std::vector<uint8_t> data(sizeof(ResourceRecordHeader) + toc_size + payload.size());
+
+	uint8_t *toc_data = data.data() + sizeof(ResourceRecordHeader);
+
+	std::memcpy(toc_data, entries.data(), toc_size);
+	std::memcpy(toc_data + toc_size, payload.data(), payload.size());
+
+	ResourceRecordHeader header{};
+	header.magic        = ResourceRecordHeader::MAGIC;
+	header.version      = ResourceRecordHeader::VERSION;
+	header.entry_count  = to_u32(entries.size());
+	header.payload_size = payload.size();
+	header.checksum     = hash_bytes(toc_data, toc_size + payload.size());
+	std::memcpy(header.pipeline_cache_uuid, pipeline_cache_uuid, VK_UUID_SIZE);
+
+	std::memcpy(data.data(), &header, sizeof(header));
+
+	return data;
 }
 
-std::vector<uint8_t> ResourceRecord::get_data()
+bool ResourceRecord::validate(const uint8_t *data, size_t size, const uint8_t *pipeline_cache_uuid)
 {
-	std::string str = stream.str();
+	if (size < sizeof(ResourceRecordHeader))
+	{
+		LOGW("Resource record rejected: truncated header");
+		return false;
+	}
+
+	// The data may not be aligned, e.g. when read from a file
+	ResourceRecordHeader header;
+	std::memcpy(&header, data, sizeof(header));
+
+	if (header.magic != ResourceRecordHeader::MAGIC || header.version != ResourceRecordHeader::VERSION)
+	{
+		LOGW("Resource record rejected: unknown format or version {}", header.version);
+		return false;
+	}
 
-	return std::vector<uint8_t>{str.begin(), str.end()};
+	if (std::memcmp(header.pipeline_cache_uuid, pipeline_cache_uuid, VK_UUID_SIZE) != 0)
+	{
+		LOGW("Resource record rejected: recorded with a different device or driver");
+		return false;
+	}
+
+	uint64_t toc_size  = static_cast<uint64_t>(header.entry_count) * sizeof(ResourceRecordEntry);
+	uint64_t data_size = size - sizeof(ResourceRecordHeader);
+
+	if (toc_size > data_size || header.payload_size != data_size - toc_size)
+	{
+		LOGW("Resource record rejected: size mismatch");
+		return false;
+	}
+
+	const uint8_t *toc_data = data + sizeof(ResourceRecordHeader);
+
+	if (hash_bytes(toc_data, static_cast<size_t>(toc_size + header.payload_size)) != header.checksum)
+	{
+		LOGW("Resource record rejected: checksum mismatch");
+		return false;
+	}
+
+	for (uint32_t i = 0; i < header.entry_count; ++i)
+	{
+		ResourceRecordEntry entry;
+		std::memcpy(&entry, toc_data + i * sizeof(ResourceRecordEntry), sizeof(entry));
+
+		if (entry.type > ResourceType::GraphicsPipeline || entry.offset > header.payload_size || entry.size > header.payload_size - entry.offset)
+		{
+			LOGW("Resource record rejected: invalid entry {}", i);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void ResourceRecord::begin_entry(ResourceType type)
+{
+	entries.push_back({type, 0, payload.size(), 0});
 }
 
-const std::ostringstream &ResourceRecord::get_stream()
+void ResourceRecord::end_entry()
 {
-	return stream;
+	entries.back().size = payload.size() - entries.back().offset;
 }
 
 size_t ResourceRecord::register_shader_module(VkShaderStageFlagBits stage, const ShaderSource &glsl_source, const std::string &entry_point, const ShaderVariant &shader_variant)
 {
 	shader_module_indices.push_back(shader_module_indices.size());
 
-	write(stream, ResourceType::ShaderModule, stage, glsl_source.get_data(), entry_point, shader_variant.get_preamble());
+	begin_entry(ResourceType::ShaderModule);
+
+	write(stream, stage, glsl_source.get_data(), entry_point, shader_variant.get_preamble());
 
 	write_processes(stream, shader_variant.get_processes());
 
+	end_entry();
+
 	return shader_module_indices.back();
 }
 
@@ -81,10 +159,13 @@ size_t ResourceRecord::register_pipeline_layout(const std::vector<ShaderModule *
 	std::vector<size_t> shader_indices(shader_modules.size());
 	std::transform(shader_modules.begin(), shader_modules.end(), shader_indices.begin(),
 	               [this](ShaderModule *shader_module) { return shader_module_to_index.at(shader_module); });
+	begin_entry(ResourceType::PipelineLayout);
+
 	write(stream,
-	      ResourceType::PipelineLayout,
 	      shader_indices);
 
+	end_entry();
+
 	return pipeline_layout_indices.back();
 }
 
@@ -92,13 +173,16 @@ size_t ResourceRecord::register_render_pass(const std::vector<Attachment> &attac
 {
 	render_pass_indices.push_back(render_pass_indices.size());
 
+	begin_entry(ResourceType::RenderPass);
+
 	write(stream,
-	      ResourceType::RenderPass,
 	      attachments,
 	      load_store_infos);
 
 	write_subpass_info(stream, subpasses);
 
+	end_entry();
+
 	return render_pass_indices.back();
 }
 
@@ -109,8 +193,9 @@ size_t ResourceRecord::register_graphics_pipeline(VkPipelineCache /*pipeline_cac
 	auto &pipeline_layout = pipeline_state.get_pipeline_layout();
 	auto  render_pass     = pipeline_state.get_render_pass();
 
+	begin_entry(ResourceType::GraphicsPipeline);
+
 	write(stream,
-	      ResourceType::GraphicsPipeline,
 	      pipeline_layout_to_index.at(&pipeline_layout),
 	      render_pass_to_index.at(render_pass),
 	      pipeline_state.get_subpass_index());
@@ -140,6 +225,8 @@ size_t ResourceRecord::register_graphics_pipeline(VkPipelineCache /*pipeline_cac
 	      color_blend_state.logic_op_enable,
 	      color_blend_state.attachments);
 
+	end_entry();
+
 	return graphics_pipeline_indices.back();
 }
 
@@ -163,4 +250,23 @@ void ResourceRecord::set_graphics_pipeline(size_t index, const GraphicsPipeline
 	graphics_pipeline_to_index[&graphics_pipeline] = index;
 }
 
+size_t ResourceRecord::get_pipeline_layout_index(VkPipelineLayout handle) const
+{
+	// Only used when capturing a frame, so a linear search is enough
+	auto it = std::find_if(pipeline_layout_to_index.begin(), pipeline_layout_to_index.end(),
+	                       [handle](const std::pair<const PipelineLayout *const, size_t> &item) { return item.first->get_handle() == handle; });
+
+	if (it == pipeline_layout_to_index.end())
+	{
+		throw std::out_of_range{"Pipeline layout was not recorded"};
+	}
+
+	return it->second;
+}
+
+size_t ResourceRecord::get_graphics_pipeline_index(const GraphicsPipeline &graphics_pipeline) const
+{
+	return graphics_pipeline_to_index.at(&graphics_pipeline);
+}
+
 }        // namespace vkb
@@ -30,7 +30,7 @@ namespace vkb
 {
 class ResourceCache;
 
-enum class ResourceType
+enum class ResourceType : uint32_t
 {
 	ShaderModule,
 	PipelineLayout,
@@ -39,16 +39,72 @@ enum class ResourceType
 };
 
 /**
- * @brief Writes Vulkan objects in a memory stream.
+ * @brief Header of a serialized resource record.
+ * The header is followed by a table of contents of entry_count ResourceRecordEntry,
+ * then by payload_size bytes of resource data. The checksum covers both.
  */
-class ResourceRecord
+struct ResourceRecordHeader
 {
-  public:
-	void set_data(const std::vector<uint8_t> &data);
+	static const uint32_t MAGIC = 0x52424B56;        // "VKBR"
+
+	/// Bump whenever the serialization of any resource changes
+	static const uint32_t VERSION = 1;
+
+	uint32_t magic;
+
+	uint32_t version;
+
+	/// Device and driver the resources were recorded with
+	uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+
+	uint32_t entry_count;
+
+	uint32_t reserved;
 
-	std::vector<uint8_t> get_data();
+	uint64_t payload_size;
 
-	const std::ostringstream &get_stream();
+	uint64_t checksum;
+};
+
+/**
+ * @brief Location of a resource in the payload of a serialized resource record
+ */
+struct ResourceRecordEntry
+{
+	ResourceType type;
+
+	uint32_t reserved;
+
+	uint64_t offset;
+
+	uint64_t size;
+};
+
+static_assert(sizeof(ResourceRecordHeader) == 32 + VK_UUID_SIZE, "ResourceRecordHeader must not have padding");
+static_assert(sizeof(ResourceRecordEntry) == 24, "ResourceRecordEntry must not have padding");
+
+/**
+ * @brief Writes Vulkan objects in a memory buffer, which can be serialized
+ *        into a versioned and checksummed binary file.
+ */
+class ResourceRecord
+{
+  public:
+	/**
+	 * @brief Serializes the recorded resources
+	 * @param pipeline_cache_uuid The pipelineCacheUUID of the device the resources were created on
+	 * @return Header, table of contents and payload, in a single allocation
+	 */
+	std::vector<uint8_t> get_data(const uint8_t *pipeline_cache_uuid) const;
+
+	/**
+	 * @brief Checks that serialized resources can be replayed on a device, without replaying them
+	 * @param data Serialized resources, as returned by get_data
+	 * @param size Size of the data in bytes
+	 * @param pipeline_cache_uuid The pipelineCacheUUID of the device
+	 * @return True if the header, the table of contents and the checksum are valid
+	 */
+	static bool validate(const uint8_t *data, size_t size, const uint8_t *pipeline_cache_uuid);
 
 	size_t register_shader_module(VkShaderStageFlagBits stage, const ShaderSource &glsl_source, const std::string &entry_point, const ShaderVariant &shader_variant);
 
@@ -69,8 +125,36 @@ class ResourceRecord
 
 	void set_graphics_pipeline(size_t index, const GraphicsPipeline &graphics_pipeline);
 
+	/**
+	 * @return Index of a pipeline layout among the recorded pipeline layouts, as used by ResourceReplay
+	 * @throws std::out_of_range if the pipeline layout was not recorded
+	 */
+	size_t get_pipeline_layout_index(VkPipelineLayout handle) const;
+
+	/**
+	 * @return Index of a graphics pipeline among the recorded graphics pipelines, as used by ResourceReplay
+	 * @throws std::out_of_range if the pipeline was not recorded
+	 */
+	size_t get_graphics_pipeline_index(const GraphicsPipeline &graphics_pipeline) const;
+
   private:
-	std::ostringstream stream;
+	/**
+	 * @brief Starts writing a resource to the payload
+	 */
+	void begin_entry(ResourceType type);
+
+	/**
+	 * @brief Finishes writing the resource started by begin_entry
+	 */
+	void end_entry();
+
+	std::vector<ResourceRecordEntry> entries;
+
+	std::vector<uint8_t> payload;
+
+	VectorStreamBuffer payload_buffer{payload};
+
+	std::ostream stream{&payload_buffer};
 
 	std::vector<size_t> shader_module_indices;
 
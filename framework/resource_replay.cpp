@@ -20,16 +20,24 @@
 
 #include "resource_replay.h"
 
+#include <algorithm>
+#include <cassert>
+#include <future>
+#include <thread>
+
+#include <ctpl_stl.h>
+
 #include "common/logging.h"
 #include "common/vk_common.h"
 #include "resource_cache.h"
 #include "resource_record.h"
+#include "timer.h"
 
 namespace vkb
 {
 namespace
 {
-inline void read_subpass_info(std::istringstream &is, std::vector<SubpassInfo> &value)
+inline void read_subpass_info(std::istream &is, std::vector<SubpassInfo> &value)
 {
 	std::size_t size;
 	read(is, size);
@@ -41,7 +49,7 @@ inline void read_subpass_info(std::istringstream &is, std::vector<SubpassInfo> &
 	}
 }
 
-inline void read_processes(std::istringstream &is, std::vector<std::string> &value)
+inline void read_processes(std::istream &is, std::vector<std::string> &value)
 {
 	std::size_t size;
 	read(is, size);
@@ -51,48 +59,130 @@ inline void read_processes(std::istringstream &is, std::vector<std::string> &val
 		read(is, item);
 	}
 }
+
+const char *get_level_name(size_t level)
+{
+	switch (level)
+	{
+		case 0:
+			return "shader modules";
+		case 1:
+			return "pipeline layouts and render passes";
+		case 2:
+			return "pipelines";
+		default:
+			return "unknown";
+	}
+}
 }        // namespace
 
 ResourceReplay::ResourceReplay()
 {
-	stream_resources[ResourceType::ShaderModule]     = std::bind(&ResourceReplay::create_shader_module, this, std::placeholders::_1, std::placeholders::_2);
-	stream_resources[ResourceType::PipelineLayout]   = std::bind(&ResourceReplay::create_pipeline_layout, this, std::placeholders::_1, std::placeholders::_2);
-	stream_resources[ResourceType::RenderPass]       = std::bind(&ResourceReplay::create_render_pass, this, std::placeholders::_1, std::placeholders::_2);
-	stream_resources[ResourceType::GraphicsPipeline] = std::bind(&ResourceReplay::create_graphics_pipeline, this, std::placeholders::_1, std::placeholders::_2);
+	stream_resources[ResourceType::ShaderModule]     = std::bind(&ResourceReplay::create_shader_module, this, std::placeholders::_1);
+	stream_resources[ResourceType::PipelineLayout]   = std::bind(&ResourceReplay::create_pipeline_layout, this, std::placeholders::_1);
+	stream_resources[ResourceType::RenderPass]       = std::bind(&ResourceReplay::create_render_pass, this, std::placeholders::_1);
+	stream_resources[ResourceType::GraphicsPipeline] = std::bind(&ResourceReplay::create_graphics_pipeline, this, std::placeholders::_1);
 }
 
-void ResourceReplay::play(ResourceCache &resource_cache, ResourceRecord &recorder)
+void ResourceReplay::play(ResourceCache &resource_cache, const uint8_t *data, size_t size)
 {
-	std::istringstream stream{recorder.get_stream().str()};
+	for (auto &tasks : levels)
+	{
+		tasks.clear();
+	}
+
+	shader_modules.clear();
+	pipeline_layouts.clear();
+	render_passes.clear();
+	graphics_pipelines.clear();
+
+	ResourceRecordHeader header;
+	std::memcpy(&header, data, sizeof(header));
+
+	const uint8_t *toc_data     = data + sizeof(ResourceRecordHeader);
+	const uint8_t *payload_data = toc_data + header.entry_count * sizeof(ResourceRecordEntry);
 
-	while (true)
+	assert(payload_data + header.payload_size == data + size && "Resource record must be validated before replay");
+
+	// Read every entry first, sorting resource creation by dependency level
+	for (uint32_t i = 0; i < header.entry_count; ++i)
 	{
-		// Read command id
-		ResourceType resource_type;
-		read(stream, resource_type);
+		ResourceRecordEntry entry;
+		std::memcpy(&entry, toc_data + i * sizeof(ResourceRecordEntry), sizeof(entry));
 
-		if (stream.eof())
-		{
-			break;
-		}
+		// Read the resource in place, without copying it
+		MemoryStreamBuffer buffer{payload_data + entry.offset, static_cast<size_t>(entry.size)};
+		std::istream       stream{&buffer};
 
 		// Find command function for the given command id
-		auto cmd_it = stream_resources.find(resource_type);
+		auto cmd_it = stream_resources.find(entry.type);
 
 		// Check if command replayer supports the given command
 		if (cmd_it != stream_resources.end())
 		{
 			// Run command function
-			cmd_it->second(resource_cache, stream);
+			cmd_it->second(stream);
 		}
 		else
 		{
 			LOGE("Replay command not supported.");
 		}
 	}
+
+	// Resources within a level only depend on resources of previous levels, so each level is created in parallel
+	ctpl::thread_pool thread_pool{static_cast<int>(std::max(1u, std::thread::hardware_concurrency()))};
+
+	Timer timer;
+
+	for (size_t level = 0; level < levels.size(); ++level)
+	{
+		auto &tasks = levels[level];
+
+		if (tasks.empty())
+		{
+			continue;
+		}
+
+		timer.start();
+
+		std::vector<std::future<void>> results;
+		results.reserve(tasks.size());
+
+		for (auto &task : tasks)
+		{
+			results.push_back(thread_pool.push([&resource_cache, &task](size_t) { task(resource_cache); }));
+		}
+
+		for (auto &result : results)
+		{
+			result.wait();
+		}
+
+		auto elapsed = timer.stop<Timer::Milliseconds>();
+
+		LOGI("Warmup of {} {} took {:.2f} ms", tasks.size(), get_level_name(level), elapsed);
+
+		// Rethrow the first failure once every task of the level has finished
+		for (auto &result : results)
+		{
+			result.get();
+		}
+
+		tasks.clear();
+	}
+}
+
+const std::vector<PipelineLayout *> &ResourceReplay::get_pipeline_layouts() const
+{
+	return pipeline_layouts;
 }
 
-void ResourceReplay::create_shader_module(ResourceCache &resource_cache, std::istringstream &stream)
+const std::vector<const GraphicsPipeline *> &ResourceReplay::get_graphics_pipelines() const
+{
+	return graphics_pipelines;
+}
+
+void ResourceReplay::create_shader_module(std::istream &stream)
 {
 	VkShaderStageFlagBits    stage{};
 	std::vector<uint8_t>     glsl_code;
@@ -108,30 +198,37 @@ void ResourceReplay::create_shader_module(ResourceCache &resource_cache, std::is
 
 	read_processes(stream, processes);
 
-	ShaderSource  shader_source(std::move(glsl_code));
-	ShaderVariant shader_variant(std::move(preamble), std::move(processes));
+	auto index = shader_modules.size();
+	shader_modules.push_back(nullptr);
 
-	auto &shader_module = resource_cache.request_shader_module(stage, shader_source, shader_variant);
+	auto shader_source  = std::make_shared<ShaderSource>(std::move(glsl_code));
+	auto shader_variant = std::make_shared<ShaderVariant>(std::move(preamble), std::move(processes));
 
-	shader_modules.push_back(&shader_module);
+	levels[0].push_back([this, index, stage, shader_source, shader_variant](ResourceCache &resource_cache) {
+		shader_modules[index] = &resource_cache.request_shader_module(stage, *shader_source, *shader_variant);
+	});
 }
 
-void ResourceReplay::create_pipeline_layout(ResourceCache &resource_cache, std::istringstream &stream)
+void ResourceReplay::create_pipeline_layout(std::istream &stream)
 {
 	std::vector<size_t> shader_indices;
 
 	read(stream,
 	     shader_indices);
 
-	std::vector<ShaderModule *> shader_stages(shader_indices.size());
-	std::transform(shader_indices.begin(), shader_indices.end(), shader_stages.begin(),
-	               [&](size_t shader_index) { return shader_modules.at(shader_index); });
-	auto &pipeline_layout = resource_cache.request_pipeline_layout(shader_stages);
+	auto index = pipeline_layouts.size();
+	pipeline_layouts.push_back(nullptr);
 
-	pipeline_layouts.push_back(&pipeline_layout);
+	levels[1].push_back([this, index, shader_indices](ResourceCache &resource_cache) {
+		std::vector<ShaderModule *> shader_stages(shader_indices.size());
+		std::transform(shader_indices.begin(), shader_indices.end(), shader_stages.begin(),
+		               [&](size_t shader_index) { return shader_modules.at(shader_index); });
+
+		pipeline_layouts[index] = &resource_cache.request_pipeline_layout(shader_stages);
+	});
 }
 
-void ResourceReplay::create_render_pass(ResourceCache &resource_cache, std::istringstream &stream)
+void ResourceReplay::create_render_pass(std::istream &stream)
 {
 	std::vector<Attachment>    attachments;
 	std::vector<LoadStoreInfo> load_store_infos;
@@ -143,12 +240,15 @@ void ResourceReplay::create_render_pass(ResourceCache &resource_cache, std::istr
 
 	read_subpass_info(stream, subpasses);
 
-	auto &render_pass = resource_cache.request_render_pass(attachments, load_store_infos, subpasses);
+	auto index = render_passes.size();
+	render_passes.push_back(nullptr);
 
-	render_passes.push_back(&render_pass);
+	levels[1].push_back([this, index, attachments, load_store_infos, subpasses](ResourceCache &resource_cache) {
+		render_passes[index] = &resource_cache.request_render_pass(attachments, load_store_infos, subpasses);
+	});
 }
 
-void ResourceReplay::create_graphics_pipeline(ResourceCache &resource_cache, std::istringstream &stream)
+void ResourceReplay::create_graphics_pipeline(std::istream &stream)
 {
 	size_t   pipeline_layout_index{};
 	size_t   render_pass_index{};
@@ -190,8 +290,6 @@ void ResourceReplay::create_graphics_pipeline(ResourceCache &resource_cache, std
 	     color_blend_state.attachments);
 
 	PipelineState pipeline_state{};
-	pipeline_state.set_pipeline_layout(*pipeline_layouts.at(pipeline_layout_index));
-	pipeline_state.set_render_pass(*render_passes.at(render_pass_index));
 
 	for (auto &item : specialization_constant_state)
 	{
@@ -207,8 +305,15 @@ void ResourceReplay::create_graphics_pipeline(ResourceCache &resource_cache, std
 	pipeline_state.set_depth_stencil_state(depth_stencil_state);
 	pipeline_state.set_color_blend_state(color_blend_state);
 
-	auto &graphics_pipeline = resource_cache.request_graphics_pipeline(pipeline_state);
+	auto index = graphics_pipelines.size();
+	graphics_pipelines.push_back(nullptr);
+
+	levels[2].push_back([this, index, pipeline_layout_index, render_pass_index, pipeline_state](ResourceCache &resource_cache) mutable {
+		// Layouts and render passes are only known once the previous level has been created
+		pipeline_state.set_pipeline_layout(*pipeline_layouts.at(pipeline_layout_index));
+		pipeline_state.set_render_pass(*render_passes.at(render_pass_index));
 
-	graphics_pipelines.push_back(&graphics_pipeline);
+		graphics_pipelines[index] = &resource_cache.request_graphics_pipeline(pipeline_state);
+	});
 }
 }        // namespace vkb
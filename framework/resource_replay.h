@@ -20,6 +20,8 @@
 
 #pragma once
 
+#include <array>
+
 #include "resource_record.h"
 
 namespace vkb
@@ -27,29 +29,53 @@ namespace vkb
 class ResourceCache;
 
 /**
- * @brief Reads Vulkan objects from a memory stream and creates them in the resource cache.
+ * @brief Reads Vulkan objects from a serialized resource record and creates them in the resource cache.
+ *
+ * The table of contents is read up front and resources are grouped by dependency level: shader modules,
+ * then pipeline layouts and render passes, then pipelines. Each level is created in parallel.
  */
 class ResourceReplay
 {
   public:
 	ResourceReplay();
 
-	void play(ResourceCache &resource_cache, ResourceRecord &recorder);
+	/**
+	 * @brief Creates the resources of a serialized resource record in the cache
+	 * @param resource_cache The cache to create the resources in
+	 * @param data Serialized resources, which must have been validated with ResourceRecord::validate
+	 * @param size Size of the data in bytes
+	 */
+	void play(ResourceCache &resource_cache, const uint8_t *data, size_t size);
+
+	/**
+	 * @brief Gets the pipeline layouts created by the last play, in the order they were serialized
+	 */
+	const std::vector<PipelineLayout *> &get_pipeline_layouts() const;
+
+	/**
+	 * @brief Gets the graphics pipelines created by the last play, in the order they were serialized
+	 */
+	const std::vector<const GraphicsPipeline *> &get_graphics_pipelines() const;
 
   protected:
-	void create_shader_module(ResourceCache &resource_cache, std::istringstream &stream);
+	void create_shader_module(std::istream &stream);
 
-	void create_pipeline_layout(ResourceCache &resource_cache, std::istringstream &stream);
+	void create_pipeline_layout(std::istream &stream);
 
-	void create_render_pass(ResourceCache &resource_cache, std::istringstream &stream);
+	void create_render_pass(std::istream &stream);
 
-	void create_graphics_pipeline(ResourceCache &resource_cache, std::istringstream &stream);
+	void create_graphics_pipeline(std::istream &stream);
 
   private:
-	using ResourceFunc = std::function<void(ResourceCache &, std::istringstream &)>;
+	using ResourceFunc = std::function<void(std::istream &)>;
+
+	using CreateFunc = std::function<void(ResourceCache &)>;
 
 	std::unordered_map<ResourceType, ResourceFunc> stream_resources;
 
+	/// Resource creation tasks, one list per dependency level
+	std::array<std::vector<CreateFunc>, 3> levels;
+
 	std::vector<ShaderModule *> shader_modules;
 
 	std::vector<PipelineLayout *> pipeline_layouts;
@@ -0,0 +1,294 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "bvh.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "common/helpers.h"
+#include "scene_graph/components/mesh.h"
+#include "scene_graph/components/transform.h"
+#include "scene_graph/node.h"
+
+namespace vkb
+{
+namespace sg
+{
+BVH::BVH(const std::vector<Mesh *> &meshes) :
+    world_revision{Transform::get_world_revision()}
+{
+	for (size_t mesh_index = 0; mesh_index < meshes.size(); ++mesh_index)
+	{
+		auto &mesh_bounds = meshes[mesh_index]->get_bounds();
+
+		for (auto node : meshes[mesh_index]->get_nodes())
+		{
+			auto &transform = node->get_transform();
+
+			Leaf leaf{meshes[mesh_index], mesh_index, node};
+			transform_bounds(mesh_bounds.get_min(), mesh_bounds.get_max(), transform.get_world_matrix(), leaf.center, leaf.extent);
+			leaf.transform_revision = transform.get_revision();
+
+			leaves.push_back(leaf);
+		}
+	}
+
+	if (leaves.empty())
+	{
+		return;
+	}
+
+	// A binary tree over n leaves has less than 2n nodes
+	tree_nodes.reserve(2 * leaves.size());
+	tree_nodes.emplace_back();
+
+	build(0, 0, to_u32(leaves.size()));
+}
+
+std::type_index BVH::get_type()
+{
+	return typeid(BVH);
+}
+
+void BVH::refit()
+{
+	// Static scenes skip the walk over the leaves
+	auto current_world_revision = Transform::get_world_revision();
+
+	if (current_world_revision == world_revision)
+	{
+		return;
+	}
+
+	world_revision = current_world_revision;
+
+	bool changed = false;
+
+	for (auto &leaf : leaves)
+	{
+		auto &transform = leaf.node->get_transform();
+
+		if (transform.get_revision() != leaf.transform_revision)
+		{
+			auto &mesh_bounds = leaf.mesh->get_bounds();
+
+			transform_bounds(mesh_bounds.get_min(), mesh_bounds.get_max(), transform.get_world_matrix(), leaf.center, leaf.extent);
+			leaf.transform_revision = transform.get_revision();
+
+			changed = true;
+		}
+	}
+
+	if (!changed)
+	{
+		return;
+	}
+
+	++revision;
+
+	// Children follow their parent, so the tree is updated bottom up in reverse order
+	for (auto tree_node_it = tree_nodes.rbegin(); tree_node_it != tree_nodes.rend(); ++tree_node_it)
+	{
+		update_bounds(*tree_node_it);
+	}
+}
+
+void BVH::cull(const Frustum &frustum, std::vector<uint32_t> &visible)
+{
+	visible.clear();
+
+	if (tree_nodes.empty())
+	{
+		return;
+	}
+
+	boundary_culler.clear();
+	boundary_leaves.clear();
+
+	auto &planes = frustum.get_planes();
+
+	// Each tree node carries the planes its parent was not entirely inside of
+	uint32_t all_planes = (1u << planes.size()) - 1;
+
+	cull_stack.clear();
+	cull_stack.emplace_back(0, all_planes);
+
+	while (!cull_stack.empty())
+	{
+		auto tree_node_index = cull_stack.back().first;
+		auto plane_mask      = cull_stack.back().second;
+
+		cull_stack.pop_back();
+
+		auto &tree_node = tree_nodes[tree_node_index];
+
+		glm::vec3 center = (tree_node.min + tree_node.max) * 0.5f;
+		glm::vec3 extent = (tree_node.max - tree_node.min) * 0.5f;
+
+		bool outside = false;
+
+		for (uint32_t p = 0; p < planes.size() && !outside; ++p)
+		{
+			if ((plane_mask & (1u << p)) == 0)
+			{
+				continue;
+			}
+
+			float distance = glm::dot(glm::vec3(planes[p]), center) + planes[p].w;
+			float radius   = glm::dot(glm::abs(glm::vec3(planes[p])), extent);
+
+			if (distance + radius < 0.0f)
+			{
+				outside = true;
+			}
+			else if (distance - radius >= 0.0f)
+			{
+				plane_mask &= ~(1u << p);
+			}
+		}
+
+		if (outside)
+		{
+			continue;
+		}
+
+		if (plane_mask == 0)
+		{
+			// Entirely inside of the frustum, no need to test the leaves
+			for (uint32_t i = 0; i < tree_node.leaf_count; ++i)
+			{
+				visible.push_back(tree_node.first_leaf + i);
+			}
+		}
+		else if (tree_node.first_child != 0)
+		{
+			cull_stack.emplace_back(tree_node.first_child, plane_mask);
+			cull_stack.emplace_back(tree_node.first_child + 1, plane_mask);
+		}
+		else
+		{
+			for (uint32_t i = tree_node.first_leaf; i < tree_node.first_leaf + tree_node.leaf_count; ++i)
+			{
+				boundary_culler.add(leaves[i].center, leaves[i].extent);
+				boundary_leaves.push_back(i);
+			}
+		}
+	}
+
+	boundary_culler.cull(frustum, boundary_visible);
+
+	for (size_t i = 0; i < boundary_leaves.size(); ++i)
+	{
+		if (boundary_visible[i])
+		{
+			visible.push_back(boundary_leaves[i]);
+		}
+	}
+}
+
+const std::vector<BVH::Leaf> &BVH::get_leaves() const
+{
+	return leaves;
+}
+
+uint32_t BVH::get_revision() const
+{
+	return revision;
+}
+
+void BVH::build(uint32_t tree_node_index, uint32_t first_leaf, uint32_t leaf_count)
+{
+	tree_nodes[tree_node_index].first_leaf  = first_leaf;
+	tree_nodes[tree_node_index].leaf_count  = leaf_count;
+	tree_nodes[tree_node_index].first_child = 0;
+
+	if (leaf_count > MAX_LEAVES_PER_NODE)
+	{
+		auto begin = leaves.begin() + first_leaf;
+		auto end   = begin + leaf_count;
+
+		glm::vec3 centers_min{std::numeric_limits<float>::max()};
+		glm::vec3 centers_max{std::numeric_limits<float>::lowest()};
+
+		for (auto leaf_it = begin; leaf_it != end; ++leaf_it)
+		{
+			centers_min = glm::min(centers_min, leaf_it->center);
+			centers_max = glm::max(centers_max, leaf_it->center);
+		}
+
+		glm::vec3 centers_size = centers_max - centers_min;
+
+		glm::length_t axis = 0;
+
+		if (centers_size.y > centers_size[axis])
+		{
+			axis = 1;
+		}
+
+		if (centers_size.z > centers_size[axis])
+		{
+			axis = 2;
+		}
+
+		uint32_t half_count = leaf_count / 2;
+
+		std::nth_element(begin, begin + half_count, end, [axis](const Leaf &lhs, const Leaf &rhs) {
+			return lhs.center[axis] < rhs.center[axis];
+		});
+
+		auto first_child = to_u32(tree_nodes.size());
+
+		tree_nodes[tree_node_index].first_child = first_child;
+
+		tree_nodes.emplace_back();
+		tree_nodes.emplace_back();
+
+		build(first_child, first_leaf, half_count);
+		build(first_child + 1, first_leaf + half_count, leaf_count - half_count);
+	}
+
+	update_bounds(tree_nodes[tree_node_index]);
+}
+
+void BVH::update_bounds(TreeNode &tree_node)
+{
+	if (tree_node.first_child != 0)
+	{
+		auto &first_child  = tree_nodes[tree_node.first_child];
+		auto &second_child = tree_nodes[tree_node.first_child + 1];
+
+		tree_node.min = glm::min(first_child.min, second_child.min);
+		tree_node.max = glm::max(first_child.max, second_child.max);
+
+		return;
+	}
+
+	tree_node.min = glm::vec3{std::numeric_limits<float>::max()};
+	tree_node.max = glm::vec3{std::numeric_limits<float>::lowest()};
+
+	for (uint32_t i = tree_node.first_leaf; i < tree_node.first_leaf + tree_node.leaf_count; ++i)
+	{
+		tree_node.min = glm::min(tree_node.min, leaves[i].center - leaves[i].extent);
+		tree_node.max = glm::max(tree_node.max, leaves[i].center + leaves[i].extent);
+	}
+}
+}        // namespace sg
+}        // namespace vkb
@@ -0,0 +1,154 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "common/error.h"
+
+VKBP_DISABLE_WARNINGS()
+#include <glm/glm.hpp>
+VKBP_ENABLE_WARNINGS()
+
+#include "rendering/frustum_culling.h"
+#include "scene_graph/component.h"
+
+namespace vkb
+{
+namespace sg
+{
+class Mesh;
+class Node;
+
+/**
+ * @brief Bounding volume hierarchy over the world bounds of the nodes of the meshes of a scene.
+ *        Culling visits the subtrees intersecting the frustum only, so its cost follows the visible nodes.
+ */
+class BVH : public Component
+{
+  public:
+	/**
+	 * @brief A node of a mesh, with its world bounds
+	 */
+	struct Leaf
+	{
+		Mesh *mesh;
+
+		/// Index of the mesh in the list the hierarchy was built from
+		size_t mesh_index;
+
+		Node *node;
+
+		glm::vec3 center;
+
+		glm::vec3 extent;
+
+		/// Revision of the node transform the bounds were computed from
+		uint32_t transform_revision;
+	};
+
+	/**
+	 * @brief Builds the hierarchy over the nodes of the meshes
+	 * @param meshes Meshes of the scene, usually Scene::get_components<Mesh>()
+	 */
+	BVH(const std::vector<Mesh *> &meshes);
+
+	virtual ~BVH() = default;
+
+	virtual std::type_index get_type() override;
+
+	/**
+	 * @brief Updates the bounds of the leaves whose transform changed since the last refit, then the bounds of the tree
+	 *        The tree keeps its topology, which degrades if nodes move far from where they were at build time
+	 *        The leaves are not visited at all if no world transform was invalidated since the last refit
+	 */
+	void refit();
+
+	/**
+	 * @brief Collects the leaves intersecting the frustum
+	 * @param frustum Frustum to test the leaves against
+	 * @param visible Filled with the indices of the visible leaves
+	 */
+	void cull(const Frustum &frustum, std::vector<uint32_t> &visible);
+
+	const std::vector<Leaf> &get_leaves() const;
+
+	/**
+	 * @return Number of refits which changed the bounds of a leaf, to detect changes of the leaves
+	 */
+	uint32_t get_revision() const;
+
+  private:
+	/// Largest number of leaves of a tree node which has no children
+	static constexpr uint32_t MAX_LEAVES_PER_NODE = 4;
+
+	/**
+	 * @brief A node of the tree, covering a contiguous range of leaves
+	 */
+	struct TreeNode
+	{
+		glm::vec3 min;
+
+		glm::vec3 max;
+
+		uint32_t first_leaf;
+
+		uint32_t leaf_count;
+
+		/// Index of the first of the two children, which follow each other, or 0 for a node without children
+		uint32_t first_child;
+	};
+
+	/**
+	 * @brief Splits a range of leaves at the median of the longest axis of their centers, recursively
+	 */
+	void build(uint32_t tree_node_index, uint32_t first_leaf, uint32_t leaf_count);
+
+	/**
+	 * @brief Computes the bounds of a tree node from its leaves or children
+	 */
+	void update_bounds(TreeNode &tree_node);
+
+	std::vector<Leaf> leaves;
+
+	uint32_t revision{0};
+
+	/// Transform::get_world_revision at the last refit
+	uint32_t world_revision;
+
+	/// Tree nodes, the root first and every child after its parent
+	std::vector<TreeNode> tree_nodes;
+
+	/// Tree nodes left to visit while culling
+	std::vector<std::pair<uint32_t, uint32_t>> cull_stack;
+
+	/// Leaves of the tree nodes crossing the frustum boundary, tested one by one
+	BoundsCuller boundary_culler;
+
+	std::vector<uint32_t> boundary_leaves;
+
+	std::vector<uint8_t> boundary_visible;
+};
+}        // namespace sg
+}        // namespace vkb
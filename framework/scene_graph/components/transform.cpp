@@ -33,6 +33,8 @@ namespace vkb
 {
 namespace sg
 {
+std::atomic<uint32_t> Transform::world_revision{0};
+
 Transform::Transform(Node &n) :
     node{n}
 {
@@ -110,6 +112,24 @@ glm::mat4 Transform::get_world_matrix()
 void Transform::invalidate_world_matrix()
 {
 	update_world_matrix = true;
+
+	++revision;
+	++world_revision;
+
+	for (auto child : node.get_children())
+	{
+		child->get_transform().invalidate_world_matrix();
+	}
+}
+
+uint32_t Transform::get_revision() const
+{
+	return revision;
+}
+
+uint32_t Transform::get_world_revision()
+{
+	return world_revision;
 }
 
 void Transform::update_world_transform()
@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <typeinfo>
@@ -73,10 +74,25 @@ class Transform : public Component
 	 * @brief Marks the world transform invalid if any of
 	 *        the local transform are changed or the parent
 	 *        world transform has changed.
+	 *        The world transforms of the children are invalidated too.
 	 */
 	void invalidate_world_matrix();
 
+	/**
+	 * @return Number of times the world transform was invalidated,
+	 *         to detect changes without comparing matrices
+	 */
+	uint32_t get_revision() const;
+
+	/**
+	 * @return Number of times any world transform was invalidated,
+	 *         to detect that none changed without visiting them
+	 */
+	static uint32_t get_world_revision();
+
   private:
+	static std::atomic<uint32_t> world_revision;
+
 	Node &node;
 
 	glm::vec3 translation = glm::vec3(0.0, 0.0, 0.0);
@@ -89,6 +105,8 @@ class Transform : public Component
 
 	bool update_world_matrix = false;
 
+	uint32_t revision{0};
+
 	void update_world_transform();
 };
 
@@ -0,0 +1,232 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "shader_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <thread>
+
+#include "common/logging.h"
+#include "glsl_compiler.h"
+#include "platform/filesystem.h"
+
+namespace vkb
+{
+namespace
+{
+/// Bump whenever the file layout or the reflection output changes
+constexpr uint32_t SHADER_CACHE_VERSION = 1;
+
+constexpr uint32_t SHADER_CACHE_MAGIC = 0x43535356;        // "VSSC"
+
+const std::string SHADER_CACHE_DIRECTORY = "shader_cache/";
+
+std::string get_filename(const std::string &key)
+{
+	auto hash = hash_bytes(reinterpret_cast<const uint8_t *>(key.data()), key.size());
+
+	std::ostringstream filename;
+	filename << SHADER_CACHE_DIRECTORY << std::hex << hash << ".bin";
+
+	return filename.str();
+}
+
+uint64_t get_checksum(const std::string &data)
+{
+	return hash_bytes(reinterpret_cast<const uint8_t *>(data.data()), data.size(), SHADER_CACHE_VERSION);
+}
+
+void write_resource(std::ostringstream &os, const ShaderResource &resource)
+{
+	write(os,
+	      resource.stages,
+	      resource.type,
+	      resource.set,
+	      resource.binding,
+	      resource.location,
+	      resource.input_attachment_index,
+	      resource.vec_size,
+	      resource.columns,
+	      resource.array_size,
+	      resource.offset,
+	      resource.size,
+	      resource.constant_id,
+	      resource.dynamic,
+	      resource.name);
+}
+
+void read_resource(std::istringstream &is, ShaderResource &resource)
+{
+	read(is,
+	     resource.stages,
+	     resource.type,
+	     resource.set,
+	     resource.binding,
+	     resource.location,
+	     resource.input_attachment_index,
+	     resource.vec_size,
+	     resource.columns,
+	     resource.array_size,
+	     resource.offset,
+	     resource.size,
+	     resource.constant_id,
+	     resource.dynamic,
+	     resource.name);
+}
+}        // namespace
+
+std::string ShaderCache::get_key(VkShaderStageFlagBits       stage,
+                                 const std::vector<uint8_t> &glsl_source,
+                                 const std::string &         entry_point,
+                                 const ShaderVariant &       shader_variant)
+{
+	std::ostringstream os;
+
+	write(os,
+	      SHADER_CACHE_VERSION,
+	      GLSLCompiler::get_version(),
+	      stage,
+	      entry_point,
+	      glsl_source,
+	      shader_variant.get_preamble(),
+	      shader_variant.get_processes().size());
+
+	for (auto &process : shader_variant.get_processes())
+	{
+		write(os, process);
+	}
+
+	// Runtime array sizes change reflected resource sizes, sort them for a stable key
+	std::vector<std::pair<std::string, size_t>> runtime_array_sizes{shader_variant.get_runtime_array_sizes().begin(),
+	                                                                 shader_variant.get_runtime_array_sizes().end()};
+	std::sort(runtime_array_sizes.begin(), runtime_array_sizes.end());
+
+	write(os, runtime_array_sizes.size());
+
+	for (auto &runtime_array_size : runtime_array_sizes)
+	{
+		write(os, runtime_array_size.first, runtime_array_size.second);
+	}
+
+	return os.str();
+}
+
+bool ShaderCache::load(const std::string &key, std::vector<uint32_t> &spirv, std::vector<ShaderResource> &resources)
+{
+	std::vector<uint8_t> data;
+
+	try
+	{
+		data = fs::read_temp(get_filename(key));
+	}
+	catch (const std::runtime_error &)
+	{
+		return false;
+	}
+
+	std::istringstream is{std::string{data.begin(), data.end()}};
+
+	uint32_t magic{0};
+	uint32_t version{0};
+	uint64_t checksum{0};
+	read(is, magic, version, checksum);
+
+	if (!is || magic != SHADER_CACHE_MAGIC || version != SHADER_CACHE_VERSION)
+	{
+		return false;
+	}
+
+	std::string payload{data.begin() + static_cast<size_t>(is.tellg()), data.end()};
+
+	if (checksum != get_checksum(payload))
+	{
+		LOGW("Shader cache entry {} is corrupt, recompiling", get_filename(key));
+		return false;
+	}
+
+	is.str(payload);
+
+	// Guard against hash collisions by comparing the full key
+	std::string stored_key;
+	read(is, stored_key);
+
+	if (stored_key != key)
+	{
+		return false;
+	}
+
+	size_t resource_count{0};
+	read(is, spirv, resource_count);
+
+	resources.resize(resource_count);
+
+	for (auto &resource : resources)
+	{
+		read_resource(is, resource);
+	}
+
+	return static_cast<bool>(is);
+}
+
+void ShaderCache::store(const std::string &key, const std::vector<uint32_t> &spirv, const std::vector<ShaderResource> &resources)
+{
+	std::ostringstream payload;
+
+	write(payload, key, spirv, resources.size());
+
+	for (auto &resource : resources)
+	{
+		write_resource(payload, resource);
+	}
+
+	std::ostringstream os;
+	write(os, SHADER_CACHE_MAGIC, SHADER_CACHE_VERSION, get_checksum(payload.str()));
+	os << payload.str();
+
+	auto data = os.str();
+
+	auto filename = get_filename(key);
+
+	// Write to a per-thread file first and rename it, so concurrent builds never expose a partial entry
+	auto temp_filename = filename + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+
+	try
+	{
+		fs::create_path(fs::path::get(fs::path::Type::Temp), SHADER_CACHE_DIRECTORY);
+
+		fs::write_temp({data.begin(), data.end()}, temp_filename);
+
+		auto temp_directory = fs::path::get(fs::path::Type::Temp);
+
+		std::remove((temp_directory + filename).c_str());
+
+		if (std::rename((temp_directory + temp_filename).c_str(), (temp_directory + filename).c_str()) != 0)
+		{
+			std::remove((temp_directory + temp_filename).c_str());
+		}
+	}
+	catch (const std::runtime_error &e)
+	{
+		LOGW("Failed to store shader cache entry: {}", e.what());
+	}
+}
+}        // namespace vkb
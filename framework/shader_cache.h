@@ -0,0 +1,71 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "common/vk_common.h"
+#include "core/shader_module.h"
+
+namespace vkb
+{
+/**
+ * @brief Persistent cache of compiled SPIRV code and its reflected shader resources
+ *
+ * Entries are stored in the temporary storage directory, one file per shader, named after a hash of
+ * everything that influences compilation and reflection: stage, entry point, GLSL source,
+ * shader variant and compiler version. A hit lets a ShaderModule skip glslang and spirv-cross entirely.
+ */
+class ShaderCache
+{
+  public:
+	/**
+	 * @brief Computes the key which identifies a compiled shader in the cache
+	 * @param stage The Vulkan shader stage flag
+	 * @param glsl_source The GLSL source code
+	 * @param entry_point The entrypoint function name of the shader stage
+	 * @param shader_variant The shader variant
+	 * @return Serialized key data
+	 */
+	std::string get_key(VkShaderStageFlagBits       stage,
+	                    const std::vector<uint8_t> &glsl_source,
+	                    const std::string &         entry_point,
+	                    const ShaderVariant &       shader_variant);
+
+	/**
+	 * @brief Loads a cached shader from disk
+	 * @param key The key returned by get_key
+	 * @param[out] spirv The cached SPIRV code
+	 * @param[out] resources The cached shader resources
+	 * @return True if a valid entry was found, false otherwise
+	 */
+	bool load(const std::string &key, std::vector<uint32_t> &spirv, std::vector<ShaderResource> &resources);
+
+	/**
+	 * @brief Stores a compiled shader to disk, failures are logged and ignored
+	 * @param key The key returned by get_key
+	 * @param spirv The SPIRV code
+	 * @param resources The reflected shader resources
+	 */
+	void store(const std::string &key, const std::vector<uint32_t> &spirv, const std::vector<ShaderResource> &resources);
+};
+}        // namespace vkb
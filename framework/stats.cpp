@@ -57,6 +57,11 @@ Stats::Stats(const std::set<StatIndex> &enabled_stats, CounterSamplingConfig sam
 	    {StatIndex::l2_ext_read_bytes, {hwcpipe::GpuCounter::ExternalMemoryReadBytes}},
 	    {StatIndex::l2_ext_write_bytes, {hwcpipe::GpuCounter::ExternalMemoryWriteBytes}},
 	    {StatIndex::tex_instr, {hwcpipe::GpuCounter::ShaderTextureCycles}},
+	    {StatIndex::removed_state_calls, {StatScaling::None}},
+	    {StatIndex::pipeline_binds, {StatScaling::None}},
+	    {StatIndex::descriptor_set_switches, {StatScaling::None}},
+	    {StatIndex::visible_draws, {StatScaling::None}},
+	    {StatIndex::culled_draws, {StatScaling::None}},
 	};
 
 	hwcpipe::CpuCounterSet enabled_cpu_counters{};
@@ -234,6 +239,16 @@ void Stats::update()
 		add_smoothed_value(delta_time_counter->second, delta_time, alpha_smoothing);
 	}
 
+	// Handle stats measured by the framework
+	for (auto &value : framework_values)
+	{
+		auto counter = counters.find(value.first);
+		if (counter != counters.end())
+		{
+			add_smoothed_value(counter->second, value.second, alpha_smoothing);
+		}
+	}
+
 	if (pending_samples.size() == 0)
 	{
 		return;
@@ -252,6 +267,11 @@ void Stats::update()
 	pending_samples.erase(pending_samples.end() - sample_count, pending_samples.end());
 }
 
+void Stats::set_value(StatIndex index, float value)
+{
+	framework_values[index] = value;
+}
+
 void Stats::continuous_sampling_worker(std::future<void> should_terminate)
 {
 	worker_timer.tick();
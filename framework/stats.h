@@ -60,7 +60,12 @@ enum class StatIndex
 	l2_ext_write_stalls,
 	l2_ext_read_bytes,
 	l2_ext_write_bytes,
-	tex_instr
+	tex_instr,
+	removed_state_calls,
+	pipeline_binds,
+	descriptor_set_switches,
+	visible_draws,
+	culled_draws
 };
 
 struct StatIndexHash
@@ -217,6 +222,13 @@ class Stats
 	 */
 	void update();
 
+	/**
+	 * @brief Sets the value of a stat measured by the framework, which is added to its graph on the next update
+	 * @param index The stat index
+	 * @param value The value measured during the last frame
+	 */
+	void set_value(StatIndex index, float value);
+
   private:
 	struct MeasurementSample
 	{
@@ -246,6 +258,9 @@ class Stats
 	/// Circular buffers for counter data
 	std::map<StatIndex, std::vector<float>> counters{};
 
+	/// Latest values of the stats measured by the framework
+	std::map<StatIndex, float> framework_values{};
+
 	/// Profiler to gather CPU and GPU performance data
 	std::unique_ptr<hwcpipe::HWCPipe> hwcpipe{};
 
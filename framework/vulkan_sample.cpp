@@ -30,8 +30,11 @@ VKBP_ENABLE_WARNINGS()
 #include "common/helpers.h"
 #include "common/logging.h"
 #include "common/vk_common.h"
+#include "frame_capture.h"
 #include "gltf_loader.h"
+#include "platform/filesystem.h"
 #include "platform/platform.h"
+#include "rendering/subpasses/scene_subpass.h"
 #include "scene_graph/script.h"
 #include "scene_graph/scripts/free_camera.h"
 #if defined(VK_USE_PLATFORM_ANDROID_KHR)
@@ -315,6 +318,40 @@ void VulkanSample::update(float delta_time)
 
 	command_buffer.end();
 
+	if (frame_capture_requested)
+	{
+		capture_frame(command_buffer);
+
+		frame_capture_requested = false;
+	}
+
+	if (stats)
+	{
+		auto &replayer = command_buffer.get_replayer();
+
+		stats->set_value(StatIndex::removed_state_calls, static_cast<float>(replayer.get_removed_call_count()));
+		stats->set_value(StatIndex::pipeline_binds, static_cast<float>(replayer.get_pipeline_bind_count()));
+		stats->set_value(StatIndex::descriptor_set_switches, static_cast<float>(replayer.get_descriptor_set_switch_count()));
+
+		if (render_pipeline)
+		{
+			size_t visible_draw_count = 0;
+			size_t culled_draw_count  = 0;
+
+			for (auto &subpass : render_pipeline->get_subpasses())
+			{
+				if (auto scene_subpass = dynamic_cast<SceneSubpass *>(subpass.get()))
+				{
+					visible_draw_count += scene_subpass->get_visible_draw_count();
+					culled_draw_count += scene_subpass->get_culled_draw_count();
+				}
+			}
+
+			stats->set_value(StatIndex::visible_draws, static_cast<float>(visible_draw_count));
+			stats->set_value(StatIndex::culled_draws, static_cast<float>(culled_draw_count));
+		}
+	}
+
 	auto render_semaphore = render_context->submit(queue, command_buffer, acquired_semaphore, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
 
 	render_context->end_frame(render_semaphore);
@@ -376,6 +413,10 @@ void VulkanSample::input_event(const InputEvent &input_event)
 		{
 			screenshot(*render_context, "screenshot-" + get_name());
 		}
+		else if (key_event.get_action() == KeyAction::Down && key_event.get_code() == KeyCode::F12)
+		{
+			request_frame_capture();
+		}
 	}
 }
 
@@ -446,6 +487,55 @@ void VulkanSample::update_debug_window()
 			get_debug_info().insert<field::Vector, float>("camera_pos", pos.x, pos.y, pos.z);
 		}
 	}
+
+	auto cache_counters = device->get_resource_cache().get_counters();
+
+	auto insert_cache_usage = [this](const std::string &label, const ResourceCacheUsage &usage) {
+		std::string histogram;
+
+		for (auto count : usage.creation_time_histogram)
+		{
+			histogram += (histogram.empty() ? "" : "/") + to_string(count);
+		}
+
+		get_debug_info().insert<field::Static, std::string>(label,
+		                                                    fmt::format("live: {} hit: {} miss: {} (+{}) mem: {:.1f} KiB build: {:.1f} ms [{}]",
+		                                                                usage.resident,
+		                                                                usage.hits,
+		                                                                usage.misses,
+		                                                                usage.frame_misses,
+		                                                                usage.memory / 1024.0f,
+		                                                                usage.creation_time,
+		                                                                histogram));
+	};
+
+	insert_cache_usage("cache_shader_modules", cache_counters.shader_modules);
+	insert_cache_usage("cache_pipeline_layouts", cache_counters.pipeline_layouts);
+	insert_cache_usage("cache_descriptor_set_layouts", cache_counters.descriptor_set_layouts);
+	insert_cache_usage("cache_render_passes", cache_counters.render_passes);
+	insert_cache_usage("cache_descriptor_sets", cache_counters.descriptor_sets);
+	insert_cache_usage("cache_graphics_pipelines", cache_counters.graphics_pipelines);
+	insert_cache_usage("cache_compute_pipelines", cache_counters.compute_pipelines);
+	insert_cache_usage("cache_framebuffers", cache_counters.framebuffers);
+}
+
+void VulkanSample::request_frame_capture()
+{
+	frame_capture_requested = true;
+}
+
+void VulkanSample::capture_frame(CommandBuffer &command_buffer)
+{
+	try
+	{
+		fs::write_temp(FrameCapture{}.capture(command_buffer), "capture-" + get_name());
+
+		LOGI("Frame captured to capture-{}", get_name());
+	}
+	catch (const std::exception &e)
+	{
+		LOGE("Frame capture failed: {}", e.what());
+	}
 }
 
 sg::Node &VulkanSample::add_free_camera(const std::string &node_name)
@@ -619,7 +709,33 @@ void VulkanSample::draw_swapchain_renderpass(CommandBuffer &command_buffer, Rend
 
 	if (gui)
 	{
-		gui->draw(command_buffer);
+		auto &subpass = command_buffer.get_recorder().get_render_pass_bindings().back().subpasses.back();
+
+		if (subpass.contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS)
+		{
+			// A subpass which executes secondary command buffers cannot record draws inline, e.g. with multithreaded scene recording
+			const auto &queue = device->get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT, 0);
+
+			auto &gui_command_buffer = render_context->request_frame_command_buffer(queue, command_buffer.get_reset_mode(), VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+
+			gui_command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &command_buffer);
+
+			gui_command_buffer.set_viewport(0, {viewport});
+
+			gui_command_buffer.set_scissor(0, {scissor});
+
+			gui->draw(gui_command_buffer);
+
+			gui_command_buffer.end();
+
+			std::vector<CommandBuffer *> secondary_command_buffers{&gui_command_buffer};
+
+			command_buffer.execute_commands(secondary_command_buffers);
+		}
+		else
+		{
+			gui->draw(command_buffer);
+		}
 	}
 
 	command_buffer.resolve_subpasses();
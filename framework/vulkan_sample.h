@@ -235,6 +235,12 @@ class VulkanSample : public Application
 	 */
 	sg::Node &add_free_camera(const std::string &node_name);
 
+	/**
+	 * @brief Captures the commands of the next frame to a temporary file named after the sample,
+	 *        which FrameReplay can replay without the scene. F12 requests a capture too.
+	 */
+	void request_frame_capture();
+
 	/**
 	 * @brief Pipeline used for rendering, it should be set up by the concrete sample
 	 */
@@ -268,6 +274,14 @@ class VulkanSample : public Application
 	 */
 	Configuration configuration{};
 
+	/// Set when the next frame is to be captured, see request_frame_capture
+	bool frame_capture_requested{false};
+
+	/**
+	 * @brief Captures an ended frame command buffer and writes it to a temporary file
+	 */
+	void capture_frame(CommandBuffer &command_buffer);
+
 	/**
 	 * @brief Create a Vulkan instance
 	 *
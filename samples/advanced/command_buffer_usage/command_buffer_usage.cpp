@@ -31,21 +31,41 @@
 
 #include "rendering/pipeline_state.h"
 
+#include <thread>
+
 CommandBufferUsage::CommandBufferUsage()
 {
 	auto &config = get_configuration();
 
 	config.insert<vkb::BoolSetting>(0, use_secondary_command_buffers, false);
 	config.insert<vkb::IntSetting>(0, reuse_selection, 0);
+	config.insert<vkb::BoolSetting>(0, freeze_scene_commands, false);
+	config.insert<vkb::BoolSetting>(0, parallel_recording, false);
 
 	config.insert<vkb::BoolSetting>(1, use_secondary_command_buffers, true);
 	config.insert<vkb::IntSetting>(1, reuse_selection, 0);
+	config.insert<vkb::BoolSetting>(1, freeze_scene_commands, false);
+	config.insert<vkb::BoolSetting>(1, parallel_recording, false);
 
 	config.insert<vkb::BoolSetting>(2, use_secondary_command_buffers, true);
 	config.insert<vkb::IntSetting>(2, reuse_selection, 1);
+	config.insert<vkb::BoolSetting>(2, freeze_scene_commands, false);
+	config.insert<vkb::BoolSetting>(2, parallel_recording, false);
 
 	config.insert<vkb::BoolSetting>(3, use_secondary_command_buffers, true);
 	config.insert<vkb::IntSetting>(3, reuse_selection, 2);
+	config.insert<vkb::BoolSetting>(3, freeze_scene_commands, false);
+	config.insert<vkb::BoolSetting>(3, parallel_recording, false);
+
+	config.insert<vkb::BoolSetting>(4, use_secondary_command_buffers, false);
+	config.insert<vkb::IntSetting>(4, reuse_selection, 2);
+	config.insert<vkb::BoolSetting>(4, freeze_scene_commands, true);
+	config.insert<vkb::BoolSetting>(4, parallel_recording, false);
+
+	config.insert<vkb::BoolSetting>(5, use_secondary_command_buffers, false);
+	config.insert<vkb::IntSetting>(5, reuse_selection, 2);
+	config.insert<vkb::BoolSetting>(5, freeze_scene_commands, false);
+	config.insert<vkb::BoolSetting>(5, parallel_recording, true);
 }
 
 bool CommandBufferUsage::prepare(vkb::Platform &platform)
@@ -83,6 +103,8 @@ bool CommandBufferUsage::prepare(vkb::Platform &platform)
 
 	gui = std::make_unique<vkb::Gui>(*render_context, platform.get_dpi_factor());
 
+	recording_thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+
 	return true;
 }
 
@@ -107,6 +129,8 @@ void CommandBufferUsage::update(float delta_time)
 
 	scene_subpass_ptr->set_command_buffer_reset_mode(static_cast<vkb::CommandBuffer::ResetMode>(reuse_selection));
 
+	update_recording_threads();
+
 	auto &primary_command_buffer = render_context->request_frame_command_buffer(queue, static_cast<vkb::CommandBuffer::ResetMode>(reuse_selection));
 
 	primary_command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
@@ -124,11 +148,17 @@ void CommandBufferUsage::draw_gui()
 {
 	auto     extent    = render_context->get_swapchain().get_extent();
 	bool     landscape = (extent.width / extent.height) > 1.0f;
-	uint32_t lines     = landscape ? 2 : 4;
+	uint32_t lines     = landscape ? 2 : 6;
 
 	gui->show_options_window(
 	    /* body = */ [&]() {
 		    ImGui::Checkbox("Secondary command buffers", &use_secondary_command_buffers);
+		    if (landscape)
+			    ImGui::SameLine();
+		    ImGui::Checkbox("Freeze scene commands", &freeze_scene_commands);
+		    if (landscape)
+			    ImGui::SameLine();
+		    ImGui::Checkbox("Multithreaded recording", &parallel_recording);
 		    ImGui::RadioButton("Allocate and free", &reuse_selection, static_cast<int>(vkb::CommandBuffer::ResetMode::AlwaysAllocate));
 		    if (landscape)
 			    ImGui::SameLine();
@@ -140,13 +170,35 @@ void CommandBufferUsage::draw_gui()
 	    /* lines = */ lines);
 }
 
+void CommandBufferUsage::update_recording_threads()
+{
+	auto thread_count = parallel_recording ? recording_thread_count : 1;
+
+	// Both thread pools are re-created when the count changes
+	if (scene_subpass_ptr->get_thread_count() != thread_count)
+	{
+		scene_subpass_ptr->set_thread_count(thread_count);
+
+		// The secondary command buffers recorded by each thread are also replayed concurrently
+		device->set_replay_thread_count(thread_count - 1);
+	}
+}
+
+bool CommandBufferUsage::uses_secondary_contents() const
+{
+	// Frozen and multithreaded scene commands are recorded into secondary command buffers
+	return use_secondary_command_buffers || freeze_scene_commands || scene_subpass_ptr->get_thread_count() > 1;
+}
+
 void CommandBufferUsage::render(vkb::CommandBuffer &primary_command_buffer)
 {
 	if (render_pipeline)
 	{
 		scene_subpass_ptr->set_use_secondary_command_buffers(use_secondary_command_buffers);
 
-		if (use_secondary_command_buffers)
+		scene_subpass_ptr->set_command_freezing(freeze_scene_commands);
+
+		if (uses_secondary_contents())
 		{
 			// Record a secondary command buffer for each object in the scene, and the GUI
 			// This is definitely not recommended. This sample offers this option to make
@@ -183,12 +235,14 @@ void CommandBufferUsage::draw_swapchain_renderpass(vkb::CommandBuffer &primary_c
 
 	vkb::CommandBuffer *command_buffer = &primary_command_buffer;
 
+	bool secondary_contents = uses_secondary_contents();
+
 	render(primary_command_buffer);
 
 	// Draw gui
 	if (gui)
 	{
-		if (use_secondary_command_buffers)
+		if (secondary_contents)
 		{
 			vkb::CommandBuffer &secondary_command_buffer = render_context->request_frame_command_buffer(queue, static_cast<vkb::CommandBuffer::ResetMode>(reuse_selection), VK_COMMAND_BUFFER_LEVEL_SECONDARY);
 
@@ -203,7 +257,7 @@ void CommandBufferUsage::draw_swapchain_renderpass(vkb::CommandBuffer &primary_c
 
 		gui->draw(*command_buffer);
 
-		if (use_secondary_command_buffers)
+		if (secondary_contents)
 		{
 			command_buffer->end();
 
@@ -211,9 +265,12 @@ void CommandBufferUsage::draw_swapchain_renderpass(vkb::CommandBuffer &primary_c
 		}
 	}
 
-	if (use_secondary_command_buffers)
+	if (secondary_contents)
 	{
-		primary_command_buffer.execute_commands(secondary_command_buffers);
+		if (!secondary_command_buffers.empty())
+		{
+			primary_command_buffer.execute_commands(secondary_command_buffers);
+		}
 	}
 	else
 	{
@@ -231,6 +288,14 @@ CommandBufferUsage::SceneSubpassSecondary::SceneSubpassSecondary(vkb::RenderCont
 
 void CommandBufferUsage::SceneSubpassSecondary::draw(vkb::CommandBuffer &primary_command_buffer)
 {
+	// Frozen draws are recorded once and replayed, and multithreaded draws are split into ranges, by the base subpass
+	if (is_command_freezing() || get_thread_count() > 1)
+	{
+		vkb::SceneSubpass::draw(primary_command_buffer);
+
+		return;
+	}
+
 	std::multimap<float, std::pair<vkb::sg::Node *, vkb::sg::SubMesh *>> opaque_nodes;
 	std::multimap<float, std::pair<vkb::sg::Node *, vkb::sg::SubMesh *>> transparent_nodes;
 
@@ -76,10 +76,27 @@ class CommandBufferUsage : public vkb::VulkanSample
 
 	void draw_gui() override;
 
+	/**
+	 * @brief Applies the recording thread count of the scene, which is only changed between frames
+	 */
+	void update_recording_threads();
+
+	/**
+	 * @return Whether the scene subpass executes secondary command buffers instead of recording draws inline
+	 */
+	bool uses_secondary_contents() const;
+
 	std::unique_ptr<vkb::CommandPool> command_pool{nullptr};
 
 	bool use_secondary_command_buffers{false};
 
+	bool freeze_scene_commands{false};
+
+	bool parallel_recording{false};
+
+	/// Threads recording the scene when parallel recording is enabled
+	size_t recording_thread_count{1};
+
 	int reuse_selection{0};
 };
 
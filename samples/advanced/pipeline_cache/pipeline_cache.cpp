@@ -36,28 +36,16 @@ PipelineCache::PipelineCache()
 	auto &config = get_configuration();
 
 	config.insert<vkb::BoolSetting>(0, enable_pipeline_cache, true);
+	config.insert<vkb::BoolSetting>(0, async_pipeline_compilation, false);
 	config.insert<vkb::BoolSetting>(1, enable_pipeline_cache, false);
+	config.insert<vkb::BoolSetting>(1, async_pipeline_compilation, false);
+	config.insert<vkb::BoolSetting>(2, enable_pipeline_cache, true);
+	config.insert<vkb::BoolSetting>(2, async_pipeline_compilation, true);
 }
 
 PipelineCache::~PipelineCache()
 {
-	if (pipeline_cache != VK_NULL_HANDLE)
-	{
-		/* Get size of pipeline cache */
-		size_t size{};
-		VK_CHECK(vkGetPipelineCacheData(device->get_handle(), pipeline_cache, &size, nullptr));
-
-		/* Get data of pipeline cache */
-		std::vector<uint8_t> data(size);
-		VK_CHECK(vkGetPipelineCacheData(device->get_handle(), pipeline_cache, &size, data.data()));
-
-		/* Write pipeline cache data to a file in binary format */
-		vkb::fs::write_temp(data, "pipeline_cache.data");
-
-		/* Destroy Vulkan pipeline cache */
-		vkDestroyPipelineCache(device->get_handle(), pipeline_cache, nullptr);
-	}
-
+	// The Vulkan pipeline cache is saved by the resource cache itself
 	vkb::fs::write_temp(device->get_resource_cache().serialize(), "cache.data");
 }
 
@@ -68,40 +56,23 @@ bool PipelineCache::prepare(vkb::Platform &platform)
 		return false;
 	}
 
-	/* Try to read pipeline cache file if exists */
-	std::vector<uint8_t> pipeline_data;
-
-	try
-	{
-		pipeline_data = vkb::fs::read_temp("pipeline_cache.data");
-	}
-	catch (std::runtime_error &ex)
-	{
-		LOGW("No pipeline cache found. {}", ex.what());
-	}
-
 	std::vector<const char *> extensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 
 	device = std::make_unique<vkb::Device>(get_gpu(), get_surface(), extensions);
 
-	/* Add initial pipeline cache data from the cached file */
-	VkPipelineCacheCreateInfo create_info{VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
-	create_info.initialDataSize = pipeline_data.size();
-	create_info.pInitialData    = pipeline_data.data();
-
-	/* Create Vulkan pipeline cache */
-	VK_CHECK(vkCreatePipelineCache(device->get_handle(), &create_info, nullptr, &pipeline_cache));
-
 	vkb::ResourceCache &resource_cache = device->get_resource_cache();
 
-	// Use pipeline cache to store pipelines
-	resource_cache.set_pipeline_cache(pipeline_cache);
+	// The resource cache loads its Vulkan pipeline cache from the previous run
+	resource_cache.set_pipeline_cache_enabled(enable_pipeline_cache);
 
-	std::vector<uint8_t> data_cache;
+	// Draws are skipped until their pipeline is compiled by a worker thread
+	resource_cache.set_async_pipeline_compilation(async_pipeline_compilation);
+
+	std::unique_ptr<vkb::fs::MappedFile> data_cache;
 
 	try
 	{
-		data_cache = vkb::fs::read_temp("cache.data");
+		data_cache = vkb::fs::map_temp("cache.data");
 	}
 	catch (std::runtime_error &ex)
 	{
@@ -109,7 +80,10 @@ bool PipelineCache::prepare(vkb::Platform &platform)
 	}
 
 	// Build all pipelines from a previous run
-	resource_cache.warmup(data_cache);
+	if (data_cache && !resource_cache.warmup(data_cache->get_data(), data_cache->get_size()))
+	{
+		LOGW("Data cache is not valid for this device, it will be recreated");
+	}
 
 	auto swapchain = std::make_unique<vkb::Swapchain>(*device, get_surface());
 
@@ -146,26 +120,27 @@ void PipelineCache::draw_gui()
 	    /* body = */ [this]() {
 		    if (ImGui::Checkbox("Pipeline cache", &enable_pipeline_cache))
 		    {
-			    vkb::ResourceCache &resource_cache = device->get_resource_cache();
-
-			    if (enable_pipeline_cache)
-			    {
-				    // Use pipeline cache to store pipelines
-				    resource_cache.set_pipeline_cache(pipeline_cache);
-			    }
-			    else
-			    {
-				    // Don't use a pipeline cache
-				    resource_cache.set_pipeline_cache(VK_NULL_HANDLE);
-			    }
+			    // Use pipeline cache to store pipelines, or don't use one
+			    device->get_resource_cache().set_pipeline_cache_enabled(enable_pipeline_cache);
 		    }
 
 		    ImGui::SameLine();
 
+		    if (ImGui::Checkbox("Async compilation", &async_pipeline_compilation))
+		    {
+			    // Build missing pipelines on worker threads, or stall recording until they are built
+			    device->get_resource_cache().set_async_pipeline_compilation(async_pipeline_compilation);
+		    }
+
 		    if (ImGui::Button("Destroy Pipelines", button_size))
 		    {
+			    auto &resource_cache = device->get_resource_cache();
+
+			    // A pipeline still being compiled would be added back after the clear
+			    resource_cache.wait_pending_pipelines();
+
 			    device->wait_idle();
-			    device->get_resource_cache().clear_pipelines();
+			    resource_cache.clear_pipelines();
 			    record_frame_time_next_frame = true;
 		    }
 
@@ -178,7 +153,7 @@ void PipelineCache::draw_gui()
 			    ImGui::Text("Pipeline rebuild frame time: N/A");
 		    }
 	    },
-	    /* lines = */ 2);
+	    /* lines = */ 3);
 }
 
 void PipelineCache::update(float delta_time)
@@ -190,6 +165,13 @@ void PipelineCache::update(float delta_time)
 	}
 
 	VulkanSample::update(delta_time);
+
+	if (wait_pipelines_after_frame)
+	{
+		// The first frame queued the pipelines of the scene, the next ones draw it entirely
+		device->get_resource_cache().wait_pending_pipelines();
+		wait_pipelines_after_frame = false;
+	}
 }
 
 std::unique_ptr<vkb::VulkanSample> create_pipeline_cache()
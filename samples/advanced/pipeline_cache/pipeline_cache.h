@@ -43,12 +43,15 @@ class PipelineCache : public vkb::VulkanSample
   private:
 	vkb::sg::Camera *camera{nullptr};
 
-	VkPipelineCache pipeline_cache{VK_NULL_HANDLE};
-
 	ImVec2 button_size{150, 30};
 
 	bool enable_pipeline_cache{true};
 
+	bool async_pipeline_compilation{false};
+
+	/// Pipelines queued by the first frame are waited for, as a loading screen would
+	bool wait_pipelines_after_frame{true};
+
 	bool record_frame_time_next_frame{false};
 
 	float rebuild_pipelines_frame_time_ms{0.0f};
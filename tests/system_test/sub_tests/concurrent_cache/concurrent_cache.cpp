@@ -0,0 +1,260 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "concurrent_cache.h"
+
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include <ctpl_stl.h>
+
+#include "common/helpers.h"
+#include "common/logging.h"
+#include "core/device.h"
+#include "platform/filesystem.h"
+#include "platform/platform.h"
+#include "resource_cache.h"
+#include "timer.h"
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+#	include "platform/android/android_platform.h"
+#endif
+
+namespace
+{
+// Number of times each worker requests the whole set of resources
+constexpr uint32_t REQUESTS_PER_TASK = 8;
+
+// Number of tasks queued for each worker thread
+constexpr uint32_t TASKS_PER_THREAD = 4;
+
+// Number of cache hits timed to measure the lookup cost
+constexpr uint32_t TIMED_LOOKUPS = 100000;
+
+const std::vector<std::string> DEFINES{"HAS_BASE_COLOR_TEXTURE", "HAS_NORMAL", "HAS_TEXCOORD_0", "HAS_TANGENT"};
+
+struct RequestedResources
+{
+	std::vector<vkb::PipelineLayout *> pipeline_layouts;
+
+	std::vector<vkb::DescriptorSet *> descriptor_sets;
+};
+
+/**
+ * @brief Hash of a pipeline layout request as the resource cache computed it before keys were packed,
+ *        combining the ids of the shader modules into a size_t which was the only key of the map
+ */
+size_t legacy_pipeline_layout_hash(const std::vector<vkb::ShaderModule *> &shader_modules)
+{
+	size_t seed{0U};
+
+	for (auto &shader_module : shader_modules)
+	{
+		vkb::hash_combine(seed, shader_module->get_id());
+	}
+
+	return seed;
+}
+}        // namespace
+
+ConcurrentCacheTest::ConcurrentCacheTest() :
+    vkbtest::GLTFLoaderTest("scenes/sponza/Sponza01.gltf")
+{
+}
+
+bool ConcurrentCacheTest::prepare(vkb::Platform &platform)
+{
+	if (!GLTFLoaderTest::prepare(platform))
+	{
+		return false;
+	}
+
+	auto &resource_cache = device->get_resource_cache();
+
+	vkb::ShaderSource vert_shader(vkb::fs::read_asset("shaders/base.vert"));
+	vkb::ShaderSource frag_shader(vkb::fs::read_asset("shaders/base.frag"));
+
+	// Every combination of defines makes a different shader variant
+	std::vector<vkb::ShaderVariant> variants(size_t{1} << DEFINES.size());
+
+	for (size_t variant_index = 0; variant_index < variants.size(); ++variant_index)
+	{
+		for (size_t define_index = 0; define_index < DEFINES.size(); ++define_index)
+		{
+			if (variant_index & (size_t{1} << define_index))
+			{
+				variants[variant_index].add_define(DEFINES[define_index]);
+			}
+		}
+	}
+
+	auto thread_count = std::thread::hardware_concurrency();
+	thread_count      = thread_count < 2 ? 2 : thread_count;
+	ctpl::thread_pool thread_pool(thread_count);
+
+	std::vector<std::future<RequestedResources>> futures;
+
+	for (uint32_t task_index = 0; task_index < thread_count * TASKS_PER_THREAD; ++task_index)
+	{
+		auto fut = thread_pool.push(
+		    [&, task_index](size_t) {
+			    RequestedResources requested;
+			    requested.pipeline_layouts.resize(variants.size());
+			    requested.descriptor_sets.resize(variants.size());
+
+			    for (uint32_t request = 0; request < REQUESTS_PER_TASK; ++request)
+			    {
+				    // Each task walks the variants from a different starting point to maximize contention
+				    for (size_t i = 0; i < variants.size(); ++i)
+				    {
+					    size_t variant_index = (i + task_index) % variants.size();
+
+					    auto &vert_module = resource_cache.request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, vert_shader, variants[variant_index]);
+					    auto &frag_module = resource_cache.request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, frag_shader, variants[variant_index]);
+
+					    std::vector<vkb::ShaderModule *> shader_modules{&vert_module, &frag_module};
+
+					    auto &pipeline_layout = resource_cache.request_pipeline_layout(shader_modules);
+
+					    auto &descriptor_set = resource_cache.request_descriptor_set(pipeline_layout.get_set_layout(0), {}, {});
+
+					    requested.pipeline_layouts[variant_index] = &pipeline_layout;
+					    requested.descriptor_sets[variant_index]  = &descriptor_set;
+				    }
+			    }
+
+			    return requested;
+		    });
+
+		futures.push_back(std::move(fut));
+	}
+
+	std::vector<RequestedResources> results;
+	for (auto &fut : futures)
+	{
+		results.push_back(fut.get());
+	}
+
+	// All threads must have been handed the very same objects
+	for (auto &result : results)
+	{
+		if (result.pipeline_layouts != results.front().pipeline_layouts ||
+		    result.descriptor_sets != results.front().descriptor_sets)
+		{
+			LOGE("Resource cache returned different objects for the same request");
+			return false;
+		}
+	}
+
+	LOGI("Resource cache served {} concurrent tasks on {} threads", results.size(), thread_count);
+
+	// Measure the cost of a cache hit, which is what every draw pays when requesting its resources
+	std::vector<vkb::ShaderModule *> shader_modules{&resource_cache.request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, vert_shader, variants.back()),
+	                                                &resource_cache.request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, frag_shader, variants.back())};
+
+	auto &set_layout = resource_cache.request_pipeline_layout(shader_modules).get_set_layout(0);
+
+	vkb::Timer timer;
+	timer.start();
+
+	for (uint32_t i = 0; i < TIMED_LOOKUPS; ++i)
+	{
+		resource_cache.request_pipeline_layout(shader_modules);
+	}
+
+	auto pipeline_layout_time = timer.stop<vkb::Timer::Nanoseconds>();
+
+	timer.start();
+
+	for (uint32_t i = 0; i < TIMED_LOOKUPS; ++i)
+	{
+		resource_cache.request_descriptor_set(set_layout, {}, {});
+	}
+
+	auto descriptor_set_time = timer.stop<vkb::Timer::Nanoseconds>();
+
+	LOGI("Resource cache hit cost: pipeline layout {:.1f} ns, descriptor set {:.1f} ns",
+	     pipeline_layout_time / TIMED_LOOKUPS, descriptor_set_time / TIMED_LOOKUPS);
+
+	// Compare the packed keys with the previous lookup scheme over the same requests,
+	// a hash_combine over the parameters indexing a locked map without comparing keys
+	std::vector<std::vector<vkb::ShaderModule *>> variant_shader_modules;
+
+	std::unordered_map<size_t, vkb::PipelineLayout *> legacy_pipeline_layouts;
+
+	std::mutex legacy_mutex;
+
+	for (auto &variant : variants)
+	{
+		variant_shader_modules.push_back({&resource_cache.request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, vert_shader, variant),
+		                                  &resource_cache.request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, frag_shader, variant)});
+
+		auto &variant_modules = variant_shader_modules.back();
+
+		legacy_pipeline_layouts[legacy_pipeline_layout_hash(variant_modules)] = &resource_cache.request_pipeline_layout(variant_modules);
+	}
+
+	size_t packed_found = 0;
+
+	timer.start();
+
+	for (uint32_t i = 0; i < TIMED_LOOKUPS; ++i)
+	{
+		auto &pipeline_layout = resource_cache.request_pipeline_layout(variant_shader_modules[i % variant_shader_modules.size()]);
+
+		packed_found += pipeline_layout.get_handle() != VK_NULL_HANDLE;
+	}
+
+	auto packed_time = timer.stop<vkb::Timer::Nanoseconds>();
+
+	size_t legacy_found = 0;
+
+	timer.start();
+
+	for (uint32_t i = 0; i < TIMED_LOOKUPS; ++i)
+	{
+		size_t hash = legacy_pipeline_layout_hash(variant_shader_modules[i % variant_shader_modules.size()]);
+
+		std::lock_guard<std::mutex> guard{legacy_mutex};
+
+		auto it = legacy_pipeline_layouts.find(hash);
+
+		legacy_found += it != legacy_pipeline_layouts.end() && it->second->get_handle() != VK_NULL_HANDLE;
+	}
+
+	auto legacy_time = timer.stop<vkb::Timer::Nanoseconds>();
+
+	// Also keeps the compiler from dropping the timed loops
+	if (packed_found != TIMED_LOOKUPS || legacy_found != TIMED_LOOKUPS)
+	{
+		LOGE("Pipeline layout lookups missed: {} packed, {} legacy", TIMED_LOOKUPS - packed_found, TIMED_LOOKUPS - legacy_found);
+		return false;
+	}
+
+	LOGI("Pipeline layout lookup over {} variants: packed key {:.1f} ns, legacy hash {:.1f} ns",
+	     variant_shader_modules.size(), packed_time / TIMED_LOOKUPS, legacy_time / TIMED_LOOKUPS);
+
+	return true;
+}
+
+std::unique_ptr<vkb::VulkanSample> create_concurrent_cache_test()
+{
+	return std::make_unique<ConcurrentCacheTest>();
+}
@@ -0,0 +1,97 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "frame_benchmark.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "common/logging.h"
+#include "core/device.h"
+#include "frame_replay.h"
+#include "platform/filesystem.h"
+
+namespace
+{
+// Number of times the captured frame is replayed, the first replay is not timed
+constexpr uint32_t BENCHMARK_REPLAY_COUNT = 100;
+}        // namespace
+
+FrameBenchmarkTest::FrameBenchmarkTest() :
+    vkbtest::GLTFLoaderTest("scenes/sponza/Sponza01.gltf")
+{
+}
+
+bool FrameBenchmarkTest::prepare(vkb::Platform &platform)
+{
+	if (!GLTFLoaderTest::prepare(platform))
+	{
+		return false;
+	}
+
+	request_frame_capture();
+
+	return true;
+}
+
+void FrameBenchmarkTest::update(float delta_time)
+{
+	// Renders, captures and takes the screenshot of the frame
+	GLTFLoaderTest::update(delta_time);
+
+	benchmark();
+}
+
+void FrameBenchmarkTest::benchmark()
+{
+	// Only the file is used from here on, as a standalone replay would
+	auto data = vkb::fs::read_temp("capture-" + get_name());
+
+	vkb::FrameReplay frame_replay{*device};
+
+	if (!frame_replay.load(data.data(), data.size()))
+	{
+		LOGE("Failed to load the captured frame");
+		return;
+	}
+
+	frame_replay.play();
+
+	double total_time = 0.0;
+	double min_time   = std::numeric_limits<double>::max();
+
+	for (uint32_t i = 0; i < BENCHMARK_REPLAY_COUNT; ++i)
+	{
+		double replay_time = frame_replay.play();
+
+		total_time += replay_time;
+		min_time = std::min(min_time, replay_time);
+	}
+
+	double average_time = total_time / BENCHMARK_REPLAY_COUNT;
+
+	LOGI("Replayed {} commands {} times: {:.3f} ms average, {:.3f} ms min, {:.1f} ns/command",
+	     frame_replay.get_command_count(), BENCHMARK_REPLAY_COUNT, average_time * 1e3, min_time * 1e3, average_time * 1e9 / frame_replay.get_command_count());
+}
+
+std::unique_ptr<vkb::VulkanSample> create_frame_benchmark_test()
+{
+	return std::make_unique<FrameBenchmarkTest>();
+}
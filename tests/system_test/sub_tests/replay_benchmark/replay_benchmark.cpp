@@ -0,0 +1,113 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "replay_benchmark.h"
+
+#include "common/logging.h"
+#include "core/command_buffer.h"
+#include "core/device.h"
+#include "rendering/render_target.h"
+#include "scene_graph/components/mesh.h"
+#include "scene_graph/scene.h"
+#include "timer.h"
+
+namespace
+{
+// Number of draws appended to the scene to make up the replayed stream
+constexpr uint32_t BENCHMARK_DRAW_COUNT = 50000;
+}        // namespace
+
+ReplayBenchmarkTest::ReplayBenchmarkTest() :
+    vkbtest::GLTFLoaderTest("scenes/sponza/Sponza01.gltf")
+{
+}
+
+void ReplayBenchmarkTest::draw_swapchain_renderpass(vkb::CommandBuffer &command_buffer, vkb::RenderTarget &render_target)
+{
+	if (!benchmark_done)
+	{
+		benchmark(render_target);
+
+		benchmark_done = true;
+	}
+
+	GLTFLoaderTest::draw_swapchain_renderpass(command_buffer, render_target);
+}
+
+void ReplayBenchmarkTest::benchmark(vkb::RenderTarget &render_target)
+{
+	// The benchmark command buffer is recorded and replayed but never submitted
+	auto &command_buffer = device->request_command_buffer();
+
+	command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+	auto &extent = render_target.get_extent();
+
+	VkViewport viewport{};
+	viewport.width    = static_cast<float>(extent.width);
+	viewport.height   = static_cast<float>(extent.height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	command_buffer.set_viewport(0, {viewport});
+
+	VkRect2D scissor{};
+	scissor.extent = extent;
+	command_buffer.set_scissor(0, {scissor});
+
+	// Record the scene once, which leaves the state of its last draw bound
+	render(command_buffer);
+
+	// Repeat a draw with that state, so the stream is dominated by draw packets
+	for (uint32_t i = 0; i < BENCHMARK_DRAW_COUNT; ++i)
+	{
+		command_buffer.draw(3, 1, 0, 0);
+	}
+
+	command_buffer.resolve_subpasses();
+
+	command_buffer.end_render_pass();
+
+	// One draw per submesh of every node, an upper bound if the scene subpass culls some of them
+	size_t scene_draw_count = 0;
+
+	for (auto mesh : scene->get_components<vkb::sg::Mesh>())
+	{
+		scene_draw_count += mesh->get_nodes().size() * mesh->get_submeshes().size();
+	}
+
+	// The bind and state packets are left out, the stream is dominated by the draws
+	auto command_count = scene_draw_count + BENCHMARK_DRAW_COUNT;
+
+	vkb::Timer timer;
+	timer.start();
+
+	// Ending a primary command buffer replays its whole stream
+	command_buffer.end();
+
+	auto replay_time = timer.stop<vkb::Timer::Nanoseconds>();
+
+	LOGI("Replayed {} draws ({} from the scene) in {:.2f} ms, {:.1f} ns/draw",
+	     command_count, scene_draw_count, replay_time / 1e6, replay_time / command_count);
+}
+
+std::unique_ptr<vkb::VulkanSample> create_replay_benchmark_test()
+{
+	return std::make_unique<ReplayBenchmarkTest>();
+}
@@ -0,0 +1,266 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "scene_features.h"
+
+#include <thread>
+
+#include "common/logging.h"
+#include "core/device.h"
+#include "rendering/subpasses/scene_subpass.h"
+#include "resource_cache.h"
+#include "stats.h"
+
+SceneFeaturesTest::SceneFeaturesTest() :
+    vkbtest::GLTFLoaderTest("scenes/sponza/Sponza01.gltf")
+{
+}
+
+bool SceneFeaturesTest::prepare(vkb::Platform &platform)
+{
+	if (!GLTFLoaderTest::prepare(platform))
+	{
+		return false;
+	}
+
+	for (auto &subpass : get_render_pipeline().get_subpasses())
+	{
+		if (auto subpass_it = dynamic_cast<vkb::SceneSubpass *>(subpass.get()))
+		{
+			scene_subpass = subpass_it;
+		}
+	}
+
+	if (scene_subpass == nullptr)
+	{
+		return false;
+	}
+
+	stats = std::make_unique<vkb::Stats>(std::set<vkb::StatIndex>{vkb::StatIndex::removed_state_calls});
+
+	add_option_cases();
+
+	add_feature_cases();
+
+	return true;
+}
+
+void SceneFeaturesTest::add_option_cases()
+{
+	// Every combination of the options which change how the draws are recorded, but not what they render
+	for (uint32_t options = 0; options < 8; ++options)
+	{
+		bool instancing      = (options & 1) != 0;
+		bool state_sorting   = (options & 2) != 0;
+		bool frustum_culling = (options & 4) != 0;
+
+		Case options_case;
+
+		options_case.name = fmt::format("instancing {}, state sorting {}, frustum culling {}", instancing, state_sorting, frustum_culling);
+
+		options_case.frame_count = 1;
+
+		options_case.enable = [this, instancing, state_sorting, frustum_culling]() {
+			scene_subpass->set_instancing(instancing);
+			scene_subpass->set_state_sorting(state_sorting);
+			scene_subpass->set_frustum_culling(frustum_culling);
+		};
+
+		options_case.check = [this, frustum_culling]() {
+			auto visible_count = scene_subpass->get_visible_draw_count();
+			auto culled_count  = scene_subpass->get_culled_draw_count();
+
+			LOGI("{} visible draws, {} culled draws", visible_count, culled_count);
+
+			if (visible_count + culled_count != visible_draw_count + culled_draw_count || (!frustum_culling && culled_count != 0))
+			{
+				LOGE("Unexpected draw counts");
+				return false;
+			}
+
+			return true;
+		};
+
+		options_case.disable = [this]() {
+			scene_subpass->set_instancing(true);
+			scene_subpass->set_state_sorting(true);
+			scene_subpass->set_frustum_culling(true);
+		};
+
+		cases.push_back(std::move(options_case));
+	}
+}
+
+void SceneFeaturesTest::add_feature_cases()
+{
+	// The value measured by a frame is added to the stat when the next one starts
+	cases.push_back({"state filter", 2,
+	                 [this]() { device->set_state_filter_enabled(true); },
+	                 [this]() {
+		                 auto removed_call_count = stats->get_data(vkb::StatIndex::removed_state_calls).back();
+
+		                 LOGI("Removed state calls: {}", removed_call_count);
+
+		                 if (removed_call_count <= 0.0f)
+		                 {
+			                 LOGE("The state filter did not remove any call");
+			                 return false;
+		                 }
+
+		                 return true;
+	                 },
+	                 [this]() { device->set_state_filter_enabled(false); }});
+
+	auto frames_in_flight = render_context->get_swapchain().get_images().size();
+
+	// The GPU counts are read back when a culled frame is rendered again, so every frame in flight is culled once first
+	cases.push_back({"GPU culling", frames_in_flight + 1,
+	                 [this]() { scene_subpass->set_gpu_culling(true); },
+	                 [this]() {
+		                 auto gpu_visible_count = scene_subpass->get_visible_draw_count();
+		                 auto gpu_culled_count  = scene_subpass->get_culled_draw_count();
+
+		                 LOGI("Visible draws: {} on the CPU, {} on the GPU. Culled draws: {} on the CPU, {} on the GPU",
+		                      visible_draw_count, gpu_visible_count, culled_draw_count, gpu_culled_count);
+
+		                 if (gpu_visible_count != visible_draw_count || gpu_culled_count != culled_draw_count)
+		                 {
+			                 LOGE("The draws culled on the GPU do not match the CPU culling");
+			                 return false;
+		                 }
+
+		                 return true;
+	                 },
+	                 [this]() { scene_subpass->set_gpu_culling(false); }});
+
+	// Every frame in flight records its frozen commands once, then replays them for the same view
+	cases.push_back({"frozen commands", frames_in_flight + 2,
+	                 [this]() { scene_subpass->set_command_freezing(true); },
+	                 [this]() {
+		                 auto replay_count = scene_subpass->get_frozen_replay_count();
+
+		                 LOGI("Frozen scene commands replayed {} times", replay_count);
+
+		                 if (replay_count == 0)
+		                 {
+			                 LOGE("The frozen scene commands were re-recorded every frame");
+			                 return false;
+		                 }
+
+		                 return true;
+	                 },
+	                 [this]() { scene_subpass->set_command_freezing(false); }});
+
+	auto thread_count = std::max(std::thread::hardware_concurrency(), 2u);
+
+	// The secondary command buffers recorded by each thread are also replayed concurrently
+	cases.push_back({fmt::format("parallel recording on {} threads", thread_count), 1,
+	                 [this, thread_count]() {
+		                 scene_subpass->set_thread_count(thread_count);
+		                 device->set_replay_thread_count(thread_count - 1);
+	                 },
+	                 [this]() {
+		                 auto visible_count = scene_subpass->get_visible_draw_count();
+
+		                 if (visible_count != visible_draw_count)
+		                 {
+			                 LOGE("{} draws recorded on several threads instead of {}", visible_count, visible_draw_count);
+			                 return false;
+		                 }
+
+		                 return true;
+	                 },
+	                 [this]() {
+		                 scene_subpass->set_thread_count(1);
+		                 device->set_replay_thread_count(0);
+	                 }});
+
+	// The previous cases left pipelines and descriptor sets which the defaults do not use, and frozen
+	// commands which pin theirs. The budget is kept for the screenshot, which checks that nothing the
+	// frames in flight use is evicted.
+	cases.push_back({"resource cache budget", frames_in_flight + 2,
+	                 [this]() {
+		                 vkb::ResourceCacheBudget budget;
+		                 budget.shader_modules     = 1;
+		                 budget.descriptor_sets    = 1;
+		                 budget.graphics_pipelines = 1;
+		                 budget.compute_pipelines  = 1;
+
+		                 device->get_resource_cache().set_budget(budget);
+	                 },
+	                 [this]() {
+		                 auto counters = device->get_resource_cache().get_counters();
+
+		                 LOGI("Evicted {} shader modules, {} descriptor sets, {} graphics pipelines, {} compute pipelines",
+		                      counters.shader_modules.evicted, counters.descriptor_sets.evicted, counters.graphics_pipelines.evicted, counters.compute_pipelines.evicted);
+
+		                 if (counters.descriptor_sets.evicted == 0 || counters.graphics_pipelines.evicted == 0)
+		                 {
+			                 LOGE("The resource cache evicted nothing over its budget");
+			                 return false;
+		                 }
+
+		                 return true;
+	                 },
+	                 []() {}});
+}
+
+void SceneFeaturesTest::update(float delta_time)
+{
+	// A frame with the defaults gives the expected draw counts
+	VulkanSample::update(delta_time);
+
+	visible_draw_count = scene_subpass->get_visible_draw_count();
+	culled_draw_count  = scene_subpass->get_culled_draw_count();
+
+	for (auto &feature_case : cases)
+	{
+		LOGI("Case: {}", feature_case.name);
+
+		feature_case.enable();
+
+		for (size_t i = 0; i < feature_case.frame_count; ++i)
+		{
+			VulkanSample::update(delta_time);
+		}
+
+		bool passed = feature_case.check();
+
+		feature_case.disable();
+
+		if (!passed)
+		{
+			LOGE("Case failed: {}", feature_case.name);
+
+			// Without a screenshot the test fails
+			end();
+
+			return;
+		}
+	}
+
+	// Renders once more with the defaults and takes the screenshot
+	GLTFLoaderTest::update(delta_time);
+}
+
+std::unique_ptr<vkb::VulkanSample> create_scene_features_test()
+{
+	return std::make_unique<SceneFeaturesTest>();
+}
@@ -0,0 +1,80 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <functional>
+
+#include "gltf_loader_test.h"
+
+namespace vkb
+{
+class SceneSubpass;
+}        // namespace vkb
+
+/**
+ * @brief Renders Sponza with each optional feature of the scene subpass and of the command replay
+ *        in turn, checking what each of them reports, then takes the screenshot with the defaults and
+ *        a small resource cache budget. A feature is only enabled for its own case, except for the budget,
+ *        and none of them changes the rendered image.
+ */
+class SceneFeaturesTest : public vkbtest::GLTFLoaderTest
+{
+  public:
+	SceneFeaturesTest();
+
+	virtual ~SceneFeaturesTest() = default;
+
+	virtual bool prepare(vkb::Platform &platform) override;
+
+	virtual void update(float delta_time) override;
+
+  private:
+	struct Case
+	{
+		std::string name;
+
+		/// Number of frames rendered with the feature before it is checked
+		size_t frame_count;
+
+		std::function<void()> enable;
+
+		/// Logs the error and returns false if the feature did not behave as expected
+		std::function<bool()> check;
+
+		/// Restores the defaults
+		std::function<void()> disable;
+	};
+
+	void add_option_cases();
+
+	void add_feature_cases();
+
+	vkb::SceneSubpass *scene_subpass{nullptr};
+
+	std::vector<Case> cases;
+
+	/// Draws rendered with the defaults, visible or culled on the CPU
+	size_t visible_draw_count{0};
+
+	size_t culled_draw_count{0};
+};
+
+std::unique_ptr<vkb::VulkanSample> create_scene_features_test();
@@ -42,6 +42,13 @@ image_ext         = ".png"
 android_timeout   = 60 # How long in seconds should we wait before timing out on Android
 check_step        = 5
 threshold         = 0.9998 # How similar the images are allowed to be before they pass
+# Tests rendering the same view as another test are compared with its gold images
+gold_references   = {
+    "scene_features":   "sponza",
+    "frame_benchmark":  "sponza",
+    "replay_benchmark": "sponza",
+    "concurrent_cache": "sponza"
+}
 
 class Subtest:
     result = False
@@ -188,7 +195,8 @@ def test(test_name, screenshot_path):
     result = False
     image = test_name + image_ext
     base_image = screenshot_path + image
-    test_image = script_path + "/gold/{0}/{1}.png".format(test_name, get_resolution(base_image))
+    gold_name = gold_references.get(test_name, test_name)
+    test_image = script_path + "/gold/{0}/{1}.png".format(gold_name, get_resolution(base_image))
     if not os.path.isfile(test_image):
         print("\t\t\t(Error) Resolution not supported, gold image not found ({})".format(test_image))
         return False